@@ -0,0 +1,281 @@
+#include <string.h>
+
+#include "blockCodec.h"
+
+/* differences are taken modulo 2^32 so that any two ints have one */
+static inline uint32_t delta(const int *values, int i)
+{
+    return (uint32_t)values[i] - (uint32_t)values[i - 1];
+}
+
+static inline uint32_t zigzag(uint32_t d)
+{
+    return (d << 1) ^ (uint32_t)-(int32_t)(d >> 31);
+}
+
+static inline uint32_t unzigzag(uint32_t z)
+{
+    return (z >> 1) ^ (uint32_t)-(int32_t)(z & 1);
+}
+
+static inline int varintSize(uint32_t v)
+{
+    /* 7 bits per byte */
+    return v < (1u << 7) ? 1 : v < (1u << 14) ? 2 : v < (1u << 21) ? 3 : v < (1u << 28) ? 4 : 5;
+}
+
+static inline unsigned char *putVarint(unsigned char *p, uint32_t v)
+{
+    while (v >= 0x80)
+    {
+        *p++ = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (unsigned char)v;
+    return p;
+}
+
+/* returns NULL if the varint runs past end or is too long */
+static inline const unsigned char *getVarint(const unsigned char *p, const unsigned char *end,
+                                             uint32_t *v)
+{
+    uint32_t result = 0;
+    int shift;
+    for (shift = 0; shift < 35 && p < end; shift += 7)
+    {
+        result |= (uint32_t)(*p & 0x7f) << shift;
+        if (*p++ < 0x80)
+        {
+            *v = result;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static inline void put32(unsigned char *p, uint32_t v)
+{
+    memcpy(p, &v, sizeof(v));
+}
+
+static inline uint32_t get32(const unsigned char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/* FOR payload: first value, base, width, packed offsets */
+#define FOR_PREFIX 9
+
+/* encode algorithm
+   one pass over the differences finds the smallest and largest one
+   (the bit width frame of reference needs) and adds up the varint
+   sizes, then the smallest of the three codecs is written */
+int BlockCodec_encode(const int *values, int count, unsigned char *out)
+{
+    BlockHeader h;
+    unsigned char *payload = out + BLOCKCODEC_HEADER_SIZE;
+    unsigned char *p = payload;
+    int32_t lo = 0, hi = 0, d;
+    uint32_t range, offset;
+    int i, width = 0;
+    long varBytes, forBytes, rawBytes = 4L * count;
+    uint64_t acc;
+    int bits;
+
+    varBytes = varintSize(zigzag((uint32_t)values[0]));
+    for (i = 1; i < count; i++)
+    {
+        d = (int32_t)delta(values, i);
+        if (i == 1 || d < lo)
+            lo = d;
+        if (i == 1 || d > hi)
+            hi = d;
+        varBytes += varintSize(zigzag((uint32_t)d));
+    }
+    range = (uint32_t)hi - (uint32_t)lo;
+    if (range != 0)
+        width = 32 - __builtin_clz(range);
+    forBytes = FOR_PREFIX + ((long)(count - 1) * width + 7) / 8;
+
+    if (forBytes <= varBytes && forBytes < rawBytes)
+    {
+        h.codec = BLOCKCODEC_FOR;
+        put32(p, (uint32_t)values[0]);
+        put32(p + 4, (uint32_t)lo);
+        p[8] = (unsigned char)width;
+        p += FOR_PREFIX;
+        acc = 0;
+        bits = 0;
+        for (i = 1; i < count && width > 0; i++)
+        {
+            offset = delta(values, i) - (uint32_t)lo;
+            acc |= (uint64_t)offset << bits;
+            bits += width;
+            while (bits >= 8)
+            {
+                *p++ = (unsigned char)acc;
+                acc >>= 8;
+                bits -= 8;
+            }
+        }
+        if (bits > 0)
+            *p++ = (unsigned char)acc;
+    }
+    else if (varBytes < rawBytes)
+    {
+        h.codec = BLOCKCODEC_VARINT;
+        p = putVarint(p, zigzag((uint32_t)values[0]));
+        for (i = 1; i < count; i++)
+            p = putVarint(p, zigzag(delta(values, i)));
+    }
+    else
+    {
+        h.codec = BLOCKCODEC_RAW;
+        memcpy(p, values, (size_t)rawBytes);
+        p += rawBytes;
+    }
+
+    h.count = (uint32_t)count;
+    h.bytes = (uint32_t)(p - payload);
+    memset(h.reserved, 0, sizeof(h.reserved));
+    h.checksum = 0;
+    h.checksum = BlockCodec_checksum(BlockCodec_checksum(0, &h, sizeof(h)), payload, h.bytes);
+    memcpy(out, &h, sizeof(h));
+    return BLOCKCODEC_HEADER_SIZE + (int)h.bytes;
+}
+
+int BlockCodec_frameSize(const unsigned char *frame, int max)
+{
+    BlockHeader h;
+    memcpy(&h, frame, sizeof(h));
+    /* the encoder only picks a codec that beats the raw size */
+    if (h.count == 0 || h.count > (uint32_t)max || h.codec > BLOCKCODEC_FOR ||
+        h.bytes > 4u * h.count)
+        return -1;
+    return BLOCKCODEC_HEADER_SIZE + (int)h.bytes;
+}
+
+int BlockCodec_count(const unsigned char *frame)
+{
+    BlockHeader h;
+    memcpy(&h, frame, sizeof(h));
+    return (int)h.count;
+}
+
+int BlockCodec_check(const unsigned char *frame)
+{
+    BlockHeader h;
+    uint32_t sum;
+    memcpy(&h, frame, sizeof(h));
+    sum = h.checksum;
+    h.checksum = 0;
+    return sum == BlockCodec_checksum(BlockCodec_checksum(0, &h, sizeof(h)),
+                                      frame + BLOCKCODEC_HEADER_SIZE, h.bytes);
+}
+
+int BlockCodec_decode(const unsigned char *frame, int *values)
+{
+    BlockHeader h;
+    const unsigned char *p = frame + BLOCKCODEC_HEADER_SIZE;
+    const unsigned char *end;
+    uint32_t v, z, base, mask;
+    uint64_t acc;
+    int i, n, width, bits;
+
+    if (!BlockCodec_check(frame))
+        return -1;
+    memcpy(&h, frame, sizeof(h));
+    n = (int)h.count;
+    end = p + h.bytes;
+    switch (h.codec)
+    {
+    case BLOCKCODEC_RAW:
+        if (h.bytes != 4u * h.count)
+            return -1;
+        memcpy(values, p, h.bytes);
+        break;
+    case BLOCKCODEC_VARINT:
+        v = 0;
+        for (i = 0; i < n; i++)
+        {
+            /* one-byte steps are the common case for slow signals */
+            if (p < end && *p < 0x80)
+                z = *p++;
+            else if ((p = getVarint(p, end, &z)) == NULL)
+                return -1;
+            v += unzigzag(z);
+            values[i] = (int)v;
+        }
+        if (p != end)
+            return -1;
+        break;
+    case BLOCKCODEC_FOR:
+        if (h.bytes < FOR_PREFIX)
+            return -1;
+        v = get32(p);
+        base = get32(p + 4);
+        width = p[8];
+        if (width > 32 || h.bytes != FOR_PREFIX + ((uint32_t)(n - 1) * width + 7) / 8)
+            return -1;
+        p += FOR_PREFIX;
+        values[0] = (int)v;
+        if (width == 0)
+        {
+            /* constant step, e.g. a counter or a flat signal */
+            for (i = 1; i < n; i++)
+                values[i] = (int)(v += base);
+            break;
+        }
+        mask = (uint32_t)((1ull << width) - 1);
+        /* while 8 bytes can be loaded, every offset is read straight from
+           its bit position, so the loop has no carried state but v */
+        for (i = 1, bits = 0; i < n && (bits >> 3) + 8 <= end - p; i++, bits += width)
+        {
+            memcpy(&acc, p + (bits >> 3), sizeof(acc));
+            v += base + ((uint32_t)(acc >> (bits & 7)) & mask);
+            values[i] = (int)v;
+        }
+        p += bits >> 3;
+        bits &= 7;
+        acc = bits ? (uint64_t)*p++ >> bits : 0;
+        bits = bits ? 8 - bits : 0;
+        for (; i < n; i++)
+        {
+            while (bits < width)
+            {
+                acc |= (uint64_t)*p++ << bits;
+                bits += 8;
+            }
+            v += base + ((uint32_t)acc & mask);
+            acc >>= width;
+            bits -= width;
+            values[i] = (int)v;
+        }
+        break;
+    default:
+        return -1;
+    }
+    return n;
+}
+
+/* FNV-1a over 32-bit words (then the odd bytes), with a final mix so
+   that every input bit reaches every output bit */
+uint32_t BlockCodec_checksum(uint32_t seed, const void *data, size_t bytes)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    uint32_t h = seed ^ 2166136261u;
+    uint32_t w;
+    for (; bytes >= 4; bytes -= 4, p += 4)
+    {
+        memcpy(&w, p, sizeof(w));
+        h = (h ^ w) * 16777619u;
+    }
+    for (; bytes > 0; bytes--)
+        h = (h ^ *p++) * 16777619u;
+    h ^= h >> 15;
+    h *= 0x2c1b3c6du;
+    h ^= h >> 12;
+    return h;
+}
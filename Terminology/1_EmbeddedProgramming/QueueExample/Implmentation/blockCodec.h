@@ -0,0 +1,70 @@
+#ifndef BLOCKCODEC_H_
+
+#define BLOCKCODEC_H_
+
+#include <stddef.h>
+
+#include <stdint.h>
+
+/* Compressed block format used for the CachedQueue spill file.
+
+   Every block is framed by a BlockHeader followed by bytes of payload
+   in one of three codecs:
+
+   BLOCKCODEC_RAW     the elements as they are
+   BLOCKCODEC_VARINT  the first element, then the difference to the
+                      previous element, each zig-zag mapped (small
+                      negative and positive steps both become small
+                      numbers) and written as a LEB128 varint
+   BLOCKCODEC_FOR     frame of reference: the first element, the
+                      smallest difference (the base), a bit width, then
+                      every difference minus the base packed in that
+                      many bits
+
+   The encoder picks whichever codec gives the smallest block, so
+   slowly varying sensor values take a few bits per element while noisy
+   data never grows beyond the raw size.
+
+   The header carries a checksum over itself and the payload, so a block
+   that was torn by a crash or damaged on disk is never decoded. */
+
+#define BLOCKCODEC_RAW 0
+#define BLOCKCODEC_VARINT 1
+#define BLOCKCODEC_FOR 2
+
+typedef struct BlockHeader BlockHeader;
+struct BlockHeader
+{
+    uint32_t count; /* elements in the block */
+    uint32_t bytes; /* payload bytes following the header */
+    uint8_t codec;
+    uint8_t reserved[3];
+    uint32_t checksum; /* of the header (with checksum 0) and payload */
+};
+
+#define BLOCKCODEC_HEADER_SIZE ((int)sizeof(BlockHeader))
+/* largest frame encode() can produce for count elements */
+#define BLOCKCODEC_MAX_FRAME(count) (BLOCKCODEC_HEADER_SIZE + 4 * (count))
+
+/* encodes count (> 0) values as one frame at out, which must have room
+   for BLOCKCODEC_MAX_FRAME(count) bytes; returns the frame size */
+int BlockCodec_encode(const int *values, int count, unsigned char *out);
+
+/* size of the frame starting with the header at frame, or -1 if the
+   header is not a valid one for frames of up to max elements */
+int BlockCodec_frameSize(const unsigned char *frame, int max);
+
+/* number of elements in the frame at frame */
+int BlockCodec_count(const unsigned char *frame);
+
+/* 1 if the checksum of the whole frame at frame matches */
+int BlockCodec_check(const unsigned char *frame);
+
+/* decodes a whole frame into values (room for its count); returns the
+   count, or -1 if the frame is corrupt */
+int BlockCodec_decode(const unsigned char *frame, int *values);
+
+/* 32-bit checksum of bytes at data, continuing from seed (0 to start) */
+uint32_t BlockCodec_checksum(uint32_t seed, const void *data, size_t bytes);
+
+#endif /*BLOCKCODEC_H_*/
@@ -1,62 +1,159 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 
 #include <stdlib.h>
 
 #include <string.h>
 
+#include <errno.h>
+
+#include <time.h>
+
+#include <fcntl.h>
+
+#include <unistd.h>
+
+#include <sys/mman.h>
+
+#include <sys/stat.h>
+
+#include <sys/resource.h>
+
 #include "cachedQueue.h"
 
-void CachedQueue_Init(CachedQueue *const me, char *fName,
-                      int (*isFullfunction)(CachedQueue *const me),
-                      int (*isEmptyfunction)(CachedQueue *const me),
-                      int (*getSizefunction)(CachedQueue *const me),
-                      void (*insertfunction)(CachedQueue *const me, int k),
-                      int (*removefunction)(CachedQueue *const me),
-                      void (*flushfunction)(CachedQueue *const me),
-                      void (*loadfunction)(CachedQueue *const me))
+/* The block file starts with a checkpoint: where loading resumes after
+   a restart, and up to where the blocks were known to be complete. It
+   is rewritten (in place, without fsync) once per flush and per load,
+   and by the async writer once per spill. */
+typedef struct Checkpoint Checkpoint;
+struct Checkpoint
+{
+    uint32_t magic;
+    uint32_t skip; /* elements of the head block already loaded */
+    int64_t head;  /* first block not completely loaded */
+    int64_t tail;  /* end of the complete blocks */
+    uint32_t checksum;
+    uint32_t reserved;
+};
+#define CHECKPOINT_MAGIC 0x504b4351u /* "QCKP" */
+
+static int writeBlock(CachedQueue *const me);
+static int writeAt(CachedQueue *const me, const void *data, size_t bytes, off_t *offset);
+static int readChunk(CachedQueue *const me);
+static int readFrame(CachedQueue *const me, off_t end);
+static int isDrained(CachedQueue *const me, off_t end);
+static void dropRest(CachedQueue *const me, off_t end);
+static int readStranded(CachedQueue *const me);
+static void resetFile(CachedQueue *const me);
+static int growMap(CachedQueue *const me);
+static int roomOnDisk(CachedQueue *const me, int n);
+static int openFile(CachedQueue *const me);
+static int openSpill(CachedQueue *const me);
+static void markLoaded(CachedQueue *const me);
+static void writeCheckpoint(CachedQueue *const me);
+static void makeCheckpoint(CachedQueue *const me, Checkpoint *c);
+static void storeCheckpoint(CachedQueue *const me, const Checkpoint *c);
+static void writeCheckpointAsync(CachedQueue *const me, int loaded);
+static void *writerThread(void *arg);
+static int waitToRetry(CachedQueue *const me);
+static int startWriter(CachedQueue *const me);
+static void stopWriter(CachedQueue *const me);
+
+const CachedQueueVtbl CachedQueue_vtbl = {
+    CachedQueue_isFull, CachedQueue_isEmpty, CachedQueue_getSize,
+    CachedQueue_insert, CachedQueue_remove, CachedQueue_flush, CachedQueue_load};
+const CachedQueueVtbl CachedQueue_vtblMapped = {
+    CachedQueue_isFull, CachedQueue_isEmpty, CachedQueue_getSize,
+    CachedQueue_insert, CachedQueue_remove, CachedQueue_flushMapped,
+    CachedQueue_loadMapped};
+const CachedQueueVtbl CachedQueue_vtblAsync = {
+    CachedQueue_isFull, CachedQueue_isEmpty, CachedQueue_getSize,
+    CachedQueue_insert, CachedQueue_remove, CachedQueue_flushAsync,
+    CachedQueue_loadAsync};
+
+void CachedQueue_Init(CachedQueue *const me, const char *fName,
+                      const CachedQueueVtbl *vtbl)
 {
 
     /* initialize base class */
-    me->queue = Queue_Create(); /* queue member must use its original functions */
+    me->queue = Queue_CreateWithCapacity(CACHEDQUEUE_QUEUE_SIZE); /* queue member uses its original (inline) functions */
     /* initialize subclass attributes */
     me->numberElementsOnDisk = 0;
+    me->diskFull = 0;
+    me->fd = -1;
+    me->readOffset = 0;
+    me->writeOffset = 0;
+    me->writeCount = 0;
+    me->readAheadPos = 0;
+    me->readAheadCount = 0;
+    me->readBufferPos = 0;
+    me->readBufferLen = 0;
+    me->readAheadFrame = -1;
+    me->skipOnLoad = 0;
+    me->checkpointHead = 0;
+    me->checkpointSkip = 0;
+    me->map = NULL;
+    me->mapSize = 0;
+    me->mapStart = 0;
+    me->spare = NULL;
+    me->inFlight = NULL;
+    me->writerRunning = 0;
+    me->stopWriter = 0;
+    me->resetting = 0;
+    me->writeFailed = 0;
+    me->stranded = NULL;
+    me->spillWaits = 0;
 
-    strcpy(me->filename, fName);
+    strncpy(me->filename, fName, sizeof(me->filename) - 1);
+    me->filename[sizeof(me->filename) - 1] = '\0';
     /* initialize aggregates */
-    me->outputQueue = Queue_Create();
+    me->outputQueue = Queue_CreateWithCapacity(CACHEDQUEUE_QUEUE_SIZE);
 
-    /* initialize subclass virtual operations ptrs */
-    me->isFull = isFullfunction;
-    me->isEmpty = isEmptyfunction;
-    me->getSize = getSizefunction;
-    me->insert = insertfunction;
-    me->remove = removefunction;
-    me->flush = flushfunction;
-    me->load = loadfunction;
+    /* initialize subclass virtual operations */
+    me->vtbl = vtbl;
 }
 /* operation Cleanup() */
+/* the spill file goes with the queue; only a file left behind by a
+   process that never got here can be picked up by CachedQueue_recover() */
 void CachedQueue_Cleanup(CachedQueue *const me)
 {
-    Queue_Cleanup(me->queue);
+    if (me->writerRunning)
+        stopWriter(me);
+    if (me->map != NULL)
+    {
+        munmap(me->map, (size_t)me->mapSize * sizeof(int));
+        me->map = NULL;
+    }
+    if (me->fd >= 0)
+    {
+        close(me->fd);
+        unlink(me->filename);
+        me->fd = -1;
+    }
+    Queue_Destroy(me->queue);
+    Queue_Destroy(me->outputQueue);
+    Queue_Destroy(me->spare);
+    Queue_Destroy(me->stranded);
 }
 /* operation isFull() */
 int CachedQueue_isFull(CachedQueue *const me)
 {
-    return me->queue->isFull(me->queue) &&
-           me->outputQueue->isFull(me->outputQueue);
+    return Queue_isFull(me->queue) &&
+           Queue_isFull(me->outputQueue);
 }
 /* operation isEmpty() */
 int CachedQueue_isEmpty(CachedQueue *const me)
 {
-    return me->queue->isEmpty(me->queue) &&
-           me->outputQueue->isEmpty(me->outputQueue) &&
+    return Queue_isEmpty(me->queue) &&
+           Queue_isEmpty(me->outputQueue) &&
            (me->numberElementsOnDisk == 0);
 }
 /* operation getSize() */
 int CachedQueue_getSize(CachedQueue *const me)
 {
-    return me->queue->getSize(me->queue) +
-           me->outputQueue->getSize(me->outputQueue) +
+    return Queue_getSize(me->queue) +
+           Queue_getSize(me->outputQueue) +
            me->numberElementsOnDisk;
 }
 /* operation insert(int) */
@@ -67,9 +164,9 @@ int CachedQueue_getSize(CachedQueue *const me)
 // insert the data into the queue
 void CachedQueue_insert(CachedQueue *const me, int k)
 {
-    if (me->queue->isFull(me->queue))
-        me->flush(me);
-    me->queue->insert(me->queue, k);
+    if (Queue_isFull(me->queue))
+        me->vtbl->flush(me);
+    Queue_insert(me->queue, k);
 }
 
 /* operation remove */
@@ -83,38 +180,101 @@ void CachedQueue_insert(CachedQueue *const me, int k)
 // else if there is data on disk
 // call load to bring it into the outputQueue
 // remove it from the outputQueue
+// (unless all of it was unreadable and has been dropped)
 // else if there is data in the queue
 // remove it from there
 // (if there is no data to remove then return sentinel value)
 int CachedQueue_remove(CachedQueue *const me)
 {
-    if (!me->outputQueue->isEmpty(me->outputQueue))
+    if (Queue_isEmpty(me->outputQueue) && me->numberElementsOnDisk > 0)
 
-        return me->outputQueue->remove(me->outputQueue);
+        me->vtbl->load(me);
 
-    else if (me->numberElementsOnDisk > 0)
-    {
+    if (!Queue_isEmpty(me->outputQueue))
+
+        return Queue_remove(me->outputQueue);
 
-        me->load(me);
+    else if (me->numberElementsOnDisk == 0)
 
-        return me->queue->remove(me->queue);
+        return Queue_remove(me->queue);
+
+    return -9999; /* sentinel value: the disk could not be read yet */
+}
+/* operation insertN(const int*, int) */
+// insertN algorithm:
+// copy as much as fits into the queue in one span
+// while values are left over
+// call flush to write out the queue and copy the next span
+// end while
+// returns the number of values accepted (n unless flush cannot make room)
+int CachedQueue_insertN(CachedQueue *const me, const int *values, int n)
+{
+    int done = Queue_insertN(me->queue, values, n);
+    while (done < n)
+    {
+        me->vtbl->flush(me);
+        if (Queue_isFull(me->queue))
+            break;
+        done += Queue_insertN(me->queue, values + done, n - done);
     }
-    else
-        return me->queue->remove(me->queue);
+    return done;
 }
+
+/* operation removeN(int*, int) */
+// removeN algorithm:
+// take a span from the outputQueue
+// while more is wanted and there is data on disk
+// call load to refill the outputQueue and take another span
+// end while
+// only once the disk is drained take the rest from the queue
+// returns the number of values copied to values
+int CachedQueue_removeN(CachedQueue *const me, int *values, int max)
+{
+    int n;
+    int done = Queue_removeN(me->outputQueue, values, max);
+    while (done < max && me->numberElementsOnDisk > 0)
+    {
+        me->vtbl->load(me);
+        n = Queue_removeN(me->outputQueue, values + done, max - done);
+        if (n == 0)
+            break;
+        done += n;
+    }
+    if (done < max && me->numberElementsOnDisk == 0)
+        done += Queue_removeN(me->queue, values + done, max - done);
+    return done;
+}
+
 /* operation flush */
 // Precondition: this is called only when queue is full
 // and filename is valid
 // flush algorithm
+// if the queue would take numberElementsOnDisk past its limit, stop
 // if file is not open, then open file
 // while not queue->isEmpty()
-// queue->remove()
-// write data to disk
-// numberElementsOnDisk++
+// move a span of the queue into the writeBuffer
+// numberElementsOnDisk += span
+// if the writeBuffer holds a whole block, write it to disk
 // end while
+// (if a block cannot be written the rest stays in the queue)
+// update the checkpoint
 void CachedQueue_flush(CachedQueue *const me)
 {
-    // write file I/O statements here ...
+    int n;
+    if (!roomOnDisk(me, Queue_getSize(me->queue)) || !openSpill(me))
+        return;
+    while (!Queue_isEmpty(me->queue))
+    {
+        if (me->writeCount == CACHEDQUEUE_BLOCK_ELEMENTS && !writeBlock(me))
+            return;
+        n = Queue_removeN(me->queue, me->writeBuffer + me->writeCount,
+                          CACHEDQUEUE_BLOCK_ELEMENTS - me->writeCount);
+        me->writeCount += n;
+        me->numberElementsOnDisk += n;
+    }
+    if (me->writeCount == CACHEDQUEUE_BLOCK_ELEMENTS)
+        writeBlock(me);
+    writeCheckpoint(me);
 }
 
 /* operation load */
@@ -127,28 +287,809 @@ void CachedQueue_flush(CachedQueue *const me)
 
 // while (!outputQueue->isFull() && (numberElementsOnDisk>0)
 
-// read from start of file (i.e., oldest datum)
+// if the readAhead buffer is used up, decode the next block of the
+// file into it (or, once the file is drained, take the writeBuffer);
+// a block that cannot be read is dropped, see readFrame()
+
+// move a span of the readAhead buffer to the outputQueue
 
-// numberElementsOnDisk– –;
-// outputQueue->insert()
+// numberElementsOnDisk -= span
 
 // end while
 
+// update the checkpoint, unless a block was dropped
+
 void CachedQueue_load(CachedQueue *const me)
 {
+    int n, failed = 0;
+    while (!Queue_isFull(me->outputQueue) &&
+           (me->numberElementsOnDisk > 0))
+    {
+        if (me->readAheadPos == me->readAheadCount && !readChunk(me))
+        {
+            failed = 1;
+            continue;
+        }
+        n = Queue_insertN(me->outputQueue, me->readAhead + me->readAheadPos,
+                          me->readAheadCount - me->readAheadPos);
+        me->readAheadPos += n;
+        me->numberElementsOnDisk -= n;
+    }
+    if (failed)
+        return;
+    markLoaded(me);
+    writeCheckpoint(me);
+}
+
+/* operation recover */
+// Elements still in memory (the queue, the outputQueue and a part
+// block in the writeBuffer) are lost in a crash; everything that was
+// written to the file and not loaded yet is recovered.
+// recover algorithm
+// if the file exists and starts with a valid checkpoint
+// walk the block headers from the checkpoint head to the end of the
+// file and add up their counts - one small read per block, the
+// elements themselves are not read
+// blocks past the checkpoint tail may have been torn by the crash, so
+// these are read whole and their checksums checked as well
+// cut the file off after the last good block
+// numberElementsOnDisk = sum of the counts - elements of the head
+// block that were already loaded
+// end if
+// a checkpoint that does not fit the file (or says more of the head
+// block was loaded than it holds) would replay elements that were
+// already consumed, so then nothing is recovered
+int CachedQueue_recover(CachedQueue *const me)
+{
+    Checkpoint c;
+    struct stat st;
+    unsigned char *frame = me->encodeBuffer;
+    off_t off;
+    long count = 0;
+    int fd, bytes, first = 0;
+    uint32_t sum;
 
-    // write file I/O statements here ...
+    if (me->fd >= 0)
+        return 0;
+    fd = open(me->filename, O_RDWR);
+    if (fd < 0)
+        return 0;
+    if (fstat(fd, &st) != 0 || pread(fd, &c, sizeof(c), 0) != (ssize_t)sizeof(c))
+    {
+        close(fd);
+        return 0;
+    }
+    sum = c.checksum;
+    c.checksum = 0;
+    if (c.magic != CHECKPOINT_MAGIC || sum != BlockCodec_checksum(0, &c, sizeof(c)))
+    {
+        printf("CachedQueue: no checkpoint in %s, starting empty\n", me->filename);
+        close(fd);
+        return 0;
+    }
+    if (c.head < CACHEDQUEUE_DATA_START || c.head > st.st_size || c.tail < c.head ||
+        c.tail > st.st_size)
+    {
+        printf("CachedQueue: inconsistent checkpoint in %s, starting empty\n", me->filename);
+        close(fd);
+        return 0;
+    }
+
+    for (off = c.head; off + BLOCKCODEC_HEADER_SIZE <= st.st_size; off += bytes)
+    {
+        if (pread(fd, frame, BLOCKCODEC_HEADER_SIZE, off) != BLOCKCODEC_HEADER_SIZE)
+            break;
+        bytes = BlockCodec_frameSize(frame, CACHEDQUEUE_BLOCK_ELEMENTS);
+        if (bytes < 0 || off + bytes > st.st_size)
+            break;
+        if (off >= c.tail &&
+            (pread(fd, frame, (size_t)bytes, off) != bytes || !BlockCodec_check(frame)))
+            break;
+        if (count == 0)
+            first = BlockCodec_count(frame);
+        count += BlockCodec_count(frame);
+    }
+    if (c.skip > 0 && c.skip >= (uint32_t)first)
+    {
+        printf("CachedQueue: inconsistent checkpoint in %s, starting empty\n", me->filename);
+        close(fd);
+        return 0;
+    }
+    if (count - (long)c.skip > CACHEDQUEUE_MAX_ON_DISK)
+    {
+        printf("CachedQueue: %s holds more elements than a queue can, starting empty\n",
+               me->filename);
+        close(fd);
+        return 0;
+    }
+    if (off < st.st_size)
+    {
+        printf("CachedQueue: dropping %ld damaged bytes at the end of %s\n",
+               (long)(st.st_size - off), me->filename);
+        if (ftruncate(fd, off) != 0)
+            printf("CachedQueue: cannot truncate %s: %s\n", me->filename, strerror(errno));
+    }
+
+    me->fd = fd;
+    me->readOffset = c.head;
+    me->writeOffset = off;
+    me->readBufferPos = 0;
+    me->readBufferLen = 0;
+    me->skipOnLoad = (int)c.skip;
+    me->checkpointHead = c.head;
+    me->checkpointSkip = (int)c.skip;
+    me->numberElementsOnDisk = (int)(count - c.skip);
+    writeCheckpoint(me);
+    return me->numberElementsOnDisk;
+}
+
+/* operation flushMapped */
+// Precondition: this is called only when queue is full
+// flushMapped algorithm
+// if the queue would take numberElementsOnDisk past its limit, stop
+// if the ring file is not mapped yet, create and map it
+// while not queue->isEmpty()
+// if the ring is full, double it
+// move a span of the queue straight into the free part of the ring
+// numberElementsOnDisk += span
+// end while
+void CachedQueue_flushMapped(CachedQueue *const me)
+{
+    int end, span, n;
+    if (!roomOnDisk(me, Queue_getSize(me->queue)))
+        return;
+    while (!Queue_isEmpty(me->queue))
+    {
+        if (me->numberElementsOnDisk == me->mapSize && !growMap(me))
+            return;
+        end = (me->mapStart + me->numberElementsOnDisk) & (me->mapSize - 1);
+        span = me->mapSize - me->numberElementsOnDisk;
+        if (span > me->mapSize - end)
+            span = me->mapSize - end;
+        n = Queue_removeN(me->queue, me->map + end, span);
+        me->numberElementsOnDisk += n;
+    }
+}
+
+/* operation loadMapped */
+// Precondition: this is called only when outputQueue is empty
+// loadMapped algorithm
+// while (!outputQueue->isFull() && (numberElementsOnDisk>0)
+// move a span of the oldest data in the ring to the outputQueue
+// numberElementsOnDisk -= span
+// end while
+// once the ring is empty start over at the beginning, so the same
+// (still cached) pages are reused
+void CachedQueue_loadMapped(CachedQueue *const me)
+{
+    int span, n;
+    while (!Queue_isFull(me->outputQueue) &&
+           (me->numberElementsOnDisk > 0))
+    {
+        span = me->mapSize - me->mapStart;
+        if (span > me->numberElementsOnDisk)
+            span = me->numberElementsOnDisk;
+        n = Queue_insertN(me->outputQueue, me->map + me->mapStart, span);
+        me->mapStart = (me->mapStart + n) & (me->mapSize - 1);
+        me->numberElementsOnDisk -= n;
+    }
+    if (me->numberElementsOnDisk == 0)
+        me->mapStart = 0;
+}
+
+/* operation flushAsync */
+// Precondition: this is called only when queue is full
+// flushAsync algorithm
+// wait until the writer has finished the previous spill (if any)
+// if the writer has given up on the disk, stop (like flush() after a
+// failed write, the full queue then drops new elements)
+// if the queue would take numberElementsOnDisk past its limit, stop
+// hand the full queue to the writer and continue with the spare
+// numberElementsOnDisk += size of the handed-over queue
+void CachedQueue_flushAsync(CachedQueue *const me)
+{
+    pthread_mutex_lock(&me->writerLock);
+    if (me->inFlight != NULL)
+        me->spillWaits++;
+    while (me->inFlight != NULL)
+        pthread_cond_wait(&me->writerCond, &me->writerLock);
+    if (me->writeFailed || !roomOnDisk(me, Queue_getSize(me->queue)))
+    {
+        pthread_mutex_unlock(&me->writerLock);
+        return;
+    }
+    me->numberElementsOnDisk += Queue_getSize(me->queue);
+    me->inFlight = me->queue;
+    me->queue = me->spare;
+    me->spare = NULL;
+    pthread_cond_broadcast(&me->writerCond);
+    pthread_mutex_unlock(&me->writerLock);
 }
-CachedQueue *CachedQueue_Create(void)
+
+/* operation loadAsync */
+// Precondition: this is called only when outputQueue is empty
+// loadAsync algorithm
+// while (!outputQueue->isFull() && (numberElementsOnDisk>0)
+// if the readAhead buffer is used up
+// wait until the file holds unread data (the writer may still be
+// writing the newest spill) and decode the next block
+// (a block that cannot be read is dropped, see readFrame(); once the
+// file is drained after the writer gave up, take what it could not
+// write instead)
+// end if
+// move a span of the readAhead buffer to the outputQueue
+// numberElementsOnDisk -= span
+// end while
+// update the checkpoint, unless a block was dropped
+// (the file is only emptied, and the checkpoint only written, without
+// writerLock held, so that flushAsync() never waits for that I/O)
+void CachedQueue_loadAsync(CachedQueue *const me)
+{
+    off_t end;
+    int moved, reset, failed, dropped = 0;
+    while (!Queue_isFull(me->outputQueue) &&
+           (me->numberElementsOnDisk > 0))
+    {
+        if (me->readAheadPos == me->readAheadCount)
+        {
+            pthread_mutex_lock(&me->writerLock);
+            while (isDrained(me, me->writeOffset) && me->inFlight != NULL)
+                pthread_cond_wait(&me->writerCond, &me->writerLock);
+            end = me->writeOffset;
+            failed = me->writeFailed;
+            pthread_mutex_unlock(&me->writerLock);
+            if (isDrained(me, end))
+            {
+                /* everything written has been read (or dropped), and
+                   nothing is in flight: only what the writer could not
+                   write is left, which also puts the count right after
+                   a dropped block whose size was unknown */
+                me->numberElementsOnDisk = failed
+                    ? me->writeCount + Queue_getSize(me->stranded)
+                    : 0;
+                if (!failed || !readStranded(me))
+                    break;
+            }
+            else
+            {
+                /* the writer only appends past end, and only whole blocks */
+                if (!readFrame(me, end))
+                {
+                    dropped = 1;
+                    continue;
+                }
+                /* once everything written is read, and no spill is in
+                   flight to append to it, empty the file; the writer
+                   waits for that before it starts the next spill */
+                pthread_mutex_lock(&me->writerLock);
+                reset = isDrained(me, me->writeOffset) && me->inFlight == NULL;
+                me->resetting = reset;
+                pthread_mutex_unlock(&me->writerLock);
+                if (reset)
+                {
+                    pthread_mutex_lock(&me->checkpointLock);
+                    resetFile(me);
+                    pthread_mutex_unlock(&me->checkpointLock);
+                    pthread_mutex_lock(&me->writerLock);
+                    me->resetting = 0;
+                    pthread_cond_broadcast(&me->writerCond);
+                    pthread_mutex_unlock(&me->writerLock);
+                }
+            }
+        }
+        moved = Queue_insertN(me->outputQueue, me->readAhead + me->readAheadPos,
+                              me->readAheadCount - me->readAheadPos);
+        me->readAheadPos += moved;
+        me->numberElementsOnDisk -= moved;
+    }
+    if (!dropped)
+        writeCheckpointAsync(me, 1);
+}
+
+/* background writer: appends each handed-over queue to the file one
+   block at a time, then returns it as the next spare. The disk is only
+   touched without writerLock held, so flushAsync() never waits for I/O
+   it did not have to. A block that still cannot be written after
+   CACHEDQUEUE_WRITE_RETRIES retries (a full disk, say) ends the
+   spilling for good: the unwritten elements are handed back to the
+   consumer, see writeFailed. */
+static void *writerThread(void *arg)
+{
+    CachedQueue *me = (CachedQueue *)arg;
+    Queue *q;
+    off_t start, offset;
+    int n = 0, bytes, ok, tries;
+#ifdef __linux__
+    /* the nice value is per thread on Linux: below the producer, the
+       writer does not preempt it when woken, it fills the idle time */
+    setpriority(PRIO_PROCESS, 0, CACHEDQUEUE_WRITER_NICE);
+#endif
+    pthread_mutex_lock(&me->writerLock);
+    for (;;)
+    {
+        while ((me->inFlight == NULL && !me->stopWriter) || me->resetting)
+            pthread_cond_wait(&me->writerCond, &me->writerLock);
+        if (me->inFlight == NULL)
+            break;
+        q = me->inFlight;
+        offset = me->writeOffset;
+        pthread_mutex_unlock(&me->writerLock);
+
+        ok = 1;
+        while (ok && (n = Queue_removeN(q, me->writeBuffer, CACHEDQUEUE_BLOCK_ELEMENTS)) > 0)
+        {
+            /* a failed write is retried a few times (the producer and
+               consumer wait on inFlight meanwhile) */
+            bytes = BlockCodec_encode(me->writeBuffer, n, me->encodeBuffer);
+            start = offset;
+            ok = writeAt(me, me->encodeBuffer, (size_t)bytes, &offset);
+            for (tries = 0; !ok && tries < CACHEDQUEUE_WRITE_RETRIES && waitToRetry(me); tries++)
+            {
+                offset = start;
+                ok = writeAt(me, me->encodeBuffer, (size_t)bytes, &offset);
+            }
+            if (!ok)
+                break;
+            /* publish each block so the consumer can start reading it */
+            pthread_mutex_lock(&me->writerLock);
+            me->writeOffset = offset;
+            pthread_cond_broadcast(&me->writerCond);
+            pthread_mutex_unlock(&me->writerLock);
+        }
+
+        pthread_mutex_lock(&me->writerLock);
+        me->inFlight = NULL;
+        if (ok)
+        {
+            me->spare = q;
+        }
+        else
+        {
+            printf("CachedQueue: giving up on %s, dropping new elements when full\n",
+                   me->filename);
+            me->writeCount = n;
+            me->stranded = q;
+            me->writeFailed = 1;
+        }
+        pthread_cond_broadcast(&me->writerCond);
+        pthread_mutex_unlock(&me->writerLock);
+
+        writeCheckpointAsync(me, 0);
+        pthread_mutex_lock(&me->writerLock);
+    }
+    pthread_mutex_unlock(&me->writerLock);
+    return NULL;
+}
+
+/* sleeps CACHEDQUEUE_RETRY_MS before the writer retries a write;
+   returns 0 at once if the queue is being destroyed */
+static int waitToRetry(CachedQueue *const me)
+{
+    struct timespec deadline;
+    int stopping;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += CACHEDQUEUE_RETRY_MS * 1000000L;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+    deadline.tv_nsec %= 1000000000L;
+    pthread_mutex_lock(&me->writerLock);
+    while (!me->stopWriter &&
+           pthread_cond_timedwait(&me->writerCond, &me->writerLock, &deadline) == 0)
+        ;
+    stopping = me->stopWriter;
+    pthread_mutex_unlock(&me->writerLock);
+    return !stopping;
+}
+
+/* sets up the spill-sized queue, its spare and the writer thread;
+   returns 0 on error */
+static int startWriter(CachedQueue *const me)
+{
+    Queue *q;
+    if (!openSpill(me))
+        return 0;
+    q = Queue_CreateWithCapacity(CACHEDQUEUE_ASYNC_QUEUE_SIZE);
+    me->spare = Queue_CreateWithCapacity(CACHEDQUEUE_ASYNC_QUEUE_SIZE);
+    if (q == NULL || me->spare == NULL)
+    {
+        Queue_Destroy(q);
+        return 0;
+    }
+    Queue_Destroy(me->queue);
+    me->queue = q;
+    pthread_mutex_init(&me->writerLock, NULL);
+    pthread_mutex_init(&me->checkpointLock, NULL);
+    pthread_cond_init(&me->writerCond, NULL);
+    if (pthread_create(&me->writer, NULL, writerThread, me) != 0)
+    {
+        pthread_cond_destroy(&me->writerCond);
+        pthread_mutex_destroy(&me->checkpointLock);
+        pthread_mutex_destroy(&me->writerLock);
+        return 0;
+    }
+    me->writerRunning = 1;
+    return 1;
+}
+
+/* lets the writer finish the spill in flight (a write that fails is not
+   retried any more) and joins it */
+static void stopWriter(CachedQueue *const me)
+{
+    pthread_mutex_lock(&me->writerLock);
+    me->stopWriter = 1;
+    pthread_cond_broadcast(&me->writerCond);
+    pthread_mutex_unlock(&me->writerLock);
+    pthread_join(me->writer, NULL);
+    pthread_cond_destroy(&me->writerCond);
+    pthread_mutex_destroy(&me->checkpointLock);
+    pthread_mutex_destroy(&me->writerLock);
+    me->writerRunning = 0;
+}
+
+/* opens and empties the block file on first use (unless recover() found
+   one); returns 0 on error */
+static int openSpill(CachedQueue *const me)
+{
+    if (me->fd >= 0)
+        return 1;
+    if (!openFile(me))
+        return 0;
+    resetFile(me);
+    return 1;
+}
+
+/* records where a restart should resume loading: in the block in
+   readAhead if part of it is still to be handed out, else at the next */
+static void markLoaded(CachedQueue *const me)
+{
+    if (me->readAheadFrame >= 0 && me->readAheadPos < me->readAheadCount)
+    {
+        me->checkpointHead = me->readAheadFrame;
+        me->checkpointSkip = me->readAheadPos;
+    }
+    else
+    {
+        me->checkpointHead = me->readOffset - (me->readBufferLen - me->readBufferPos);
+        me->checkpointSkip = 0;
+    }
+}
+
+static void writeCheckpoint(CachedQueue *const me)
+{
+    Checkpoint c;
+    makeCheckpoint(me, &c);
+    storeCheckpoint(me, &c);
+}
+
+static void makeCheckpoint(CachedQueue *const me, Checkpoint *c)
+{
+    memset(c, 0, sizeof(*c));
+    c->magic = CHECKPOINT_MAGIC;
+    c->skip = (uint32_t)me->checkpointSkip;
+    c->head = me->checkpointHead;
+    c->tail = me->writeOffset;
+    c->checksum = BlockCodec_checksum(0, c, sizeof(*c));
+}
+
+static void storeCheckpoint(CachedQueue *const me, const Checkpoint *c)
+{
+    if (me->fd < 0)
+        return;
+    if (pwrite(me->fd, c, sizeof(*c), 0) != (ssize_t)sizeof(*c))
+        printf("CachedQueue: cannot write the checkpoint of %s\n", me->filename);
+}
+
+/* async mode: the writer and the consumer both update the checkpoint.
+   The record is taken under writerLock (for writeOffset) but written
+   after it is released; checkpointLock keeps the writes in the order the
+   records were taken, so an older one never overwrites a newer one.
+   loaded: called by the consumer, which marks what it has loaded first */
+static void writeCheckpointAsync(CachedQueue *const me, int loaded)
+{
+    Checkpoint c;
+    pthread_mutex_lock(&me->checkpointLock);
+    pthread_mutex_lock(&me->writerLock);
+    if (loaded)
+        markLoaded(me);
+    makeCheckpoint(me, &c);
+    pthread_mutex_unlock(&me->writerLock);
+    storeCheckpoint(me, &c);
+    pthread_mutex_unlock(&me->checkpointLock);
+}
+
+/* opens (and empties) the spill file on first use; returns 0 on error */
+static int openFile(CachedQueue *const me)
+{
+    if (me->fd < 0)
+    {
+        me->fd = open(me->filename, O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (me->fd < 0)
+        {
+            printf("CachedQueue: cannot open %s: %s\n", me->filename, strerror(errno));
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* 1 if n more elements can be spilled without numberElementsOnDisk
+   passing CACHEDQUEUE_MAX_ON_DISK; 0 if not, with a message the first
+   time */
+static int roomOnDisk(CachedQueue *const me, int n)
+{
+    if (n <= CACHEDQUEUE_MAX_ON_DISK - me->numberElementsOnDisk)
+    {
+        me->diskFull = 0;
+        return 1;
+    }
+    if (!me->diskFull)
+        printf("CachedQueue: %s holds as many elements as it can count, dropping new ones\n",
+               me->filename);
+    me->diskFull = 1;
+    return 0;
+}
+
+/* creates the ring file on first use and doubles it when it is full;
+   returns 0 on error */
+static int growMap(CachedQueue *const me)
+{
+    int oldSize = me->mapSize;
+    int newSize;
+    int *map;
+    /* sizes are element counts in an int, and ring positions are masked
+       with mapSize - 1, so the ring stops at the largest power of two
+       that doubling cannot overflow */
+    if (oldSize > INT_MAX / 2)
+    {
+        printf("CachedQueue: %s cannot grow any further\n", me->filename);
+        return 0;
+    }
+    newSize = oldSize ? oldSize * 2 : CACHEDQUEUE_MAP_SIZE / (int)sizeof(int);
+    if (!openFile(me))
+        return 0;
+    if (ftruncate(me->fd, (off_t)newSize * (off_t)sizeof(int)) != 0)
+    {
+        printf("CachedQueue: cannot grow %s: %s\n", me->filename, strerror(errno));
+        return 0;
+    }
+    map = (int *)mmap(NULL, (size_t)newSize * sizeof(int), PROT_READ | PROT_WRITE,
+                      MAP_SHARED, me->fd, 0);
+    if (map == MAP_FAILED)
+    {
+        printf("CachedQueue: cannot map %s: %s\n", me->filename, strerror(errno));
+        return 0;
+    }
+    if (me->map != NULL)
+        munmap(me->map, (size_t)oldSize * sizeof(int));
+    me->map = map;
+    me->mapSize = newSize;
+    /* the ring is full when it grows: if it wrapped, move the part at
+       the front of the file up behind the old end so it is contiguous */
+    if (me->mapStart > 0)
+        memcpy(me->map + oldSize, me->map, (size_t)me->mapStart * sizeof(int));
+    return 1;
+}
+
+/* writes the full writeBuffer at the end of the file; returns 0 on error */
+static int writeBlock(CachedQueue *const me)
+{
+    int bytes = BlockCodec_encode(me->writeBuffer, me->writeCount, me->encodeBuffer);
+    off_t offset = me->writeOffset; /* a block written in part is not there */
+    if (!writeAt(me, me->encodeBuffer, (size_t)bytes, &offset))
+        return 0;
+    me->writeOffset = offset;
+    me->writeCount = 0;
+    return 1;
+}
+
+/* writes bytes of data at *offset and advances it; returns 0 on error */
+static int writeAt(CachedQueue *const me, const void *data, size_t bytes, off_t *offset)
+{
+    const char *p = (const char *)data;
+    ssize_t n;
+    while (bytes > 0)
+    {
+        n = pwrite(me->fd, p, bytes, *offset);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            printf("CachedQueue: cannot write %s: %s\n", me->filename, strerror(errno));
+            return 0;
+        }
+        p += n;
+        bytes -= (size_t)n;
+        *offset += n;
+    }
+    return 1;
+}
+
+/* refills the empty readAhead buffer with the oldest spilled block;
+   returns 0 if nothing could be read (a block was dropped) */
+static int readChunk(CachedQueue *const me)
+{
+    me->readAheadPos = 0;
+    me->readAheadCount = 0;
+    if (isDrained(me, me->writeOffset))
+    {
+        /* the file is drained: the newest data is still in the writeBuffer,
+           and that is all there is left (which also puts the count right
+           after a dropped block whose size was unknown) */
+        memcpy(me->readAhead, me->writeBuffer, (size_t)me->writeCount * sizeof(int));
+        me->readAheadCount = me->writeCount;
+        me->readAheadFrame = -1;
+        me->numberElementsOnDisk = me->writeCount;
+        me->writeCount = 0;
+        resetFile(me);
+        return me->readAheadCount > 0;
+    }
+    if (!readFrame(me, me->writeOffset))
+        return 0;
+    if (isDrained(me, me->writeOffset) && me->writeCount == 0)
+        resetFile(me);
+    return 1;
+}
+
+/* decodes the next block of the file (which ends at end) into the
+   readAhead buffer. The file is read in large chunks into readBuffer;
+   a block cut off at the end of a chunk is moved to the front and
+   completed by the next read. Returns 0 on error, having dropped what
+   could not be read, so the next call moves on: a block that fails its
+   checksum is skipped and its elements taken off numberElementsOnDisk;
+   after a read error or a header that makes no sense the blocks cannot
+   be told apart any more, so the rest of the file up to end goes (the
+   caller puts the count right once the file is drained). */
+static int readFrame(CachedQueue *const me, off_t end)
+{
+    unsigned char *frame;
+    int have = me->readBufferLen - me->readBufferPos;
+    int size = -1, lost;
+    size_t want;
+    ssize_t n;
+    if (have >= BLOCKCODEC_HEADER_SIZE)
+        size = BlockCodec_frameSize(me->readBuffer + me->readBufferPos,
+                                    CACHEDQUEUE_BLOCK_ELEMENTS);
+    if (have < BLOCKCODEC_HEADER_SIZE || size > have)
+    {
+        memmove(me->readBuffer, me->readBuffer + me->readBufferPos, (size_t)have);
+        me->readBufferPos = 0;
+        me->readBufferLen = have;
+        want = sizeof(me->readBuffer) - (size_t)have;
+        if ((off_t)want > end - me->readOffset)
+            want = (size_t)(end - me->readOffset);
+        do
+            n = pread(me->fd, me->readBuffer + have, want, me->readOffset);
+        while (n < 0 && errno == EINTR);
+        if (n <= 0)
+        {
+            printf("CachedQueue: cannot read %s: %s\n", me->filename,
+                   n < 0 ? strerror(errno) : "unexpected end of file");
+            dropRest(me, end);
+            return 0;
+        }
+        me->readOffset += n;
+        me->readBufferLen += (int)n;
+        have += (int)n;
+        if (have >= BLOCKCODEC_HEADER_SIZE)
+            size = BlockCodec_frameSize(me->readBuffer, CACHEDQUEUE_BLOCK_ELEMENTS);
+    }
+    frame = me->readBuffer + me->readBufferPos;
+    if (size < 0 || size > have)
+    {
+        printf("CachedQueue: corrupt block in %s, dropping the rest of it\n", me->filename);
+        dropRest(me, end);
+        return 0;
+    }
+    if (BlockCodec_decode(frame, me->readAhead) < 0)
+    {
+        lost = BlockCodec_count(frame) - me->skipOnLoad;
+        if (lost < 0)
+            lost = 0;
+        if (lost > me->numberElementsOnDisk)
+            lost = me->numberElementsOnDisk;
+        printf("CachedQueue: corrupt block in %s, dropping %d elements\n", me->filename, lost);
+        me->numberElementsOnDisk -= lost;
+        me->skipOnLoad = 0;
+        me->readBufferPos += size;
+        return 0;
+    }
+    me->readAheadFrame = me->readOffset - (me->readBufferLen - me->readBufferPos);
+    me->readAheadPos = me->skipOnLoad; /* only after a restart */
+    me->readAheadCount = BlockCodec_count(frame);
+    me->skipOnLoad = 0;
+    me->readBufferPos += size;
+    return 1;
+}
+
+/* async mode, once the writer has given up: refills the empty readAhead
+   buffer with what it could not write, the block it failed on first,
+   then the rest of that spill; returns 0 if nothing is left */
+static int readStranded(CachedQueue *const me)
+{
+    me->readAheadPos = 0;
+    me->readAheadFrame = -1;
+    if (me->writeCount > 0)
+    {
+        memcpy(me->readAhead, me->writeBuffer, (size_t)me->writeCount * sizeof(int));
+        me->readAheadCount = me->writeCount;
+        me->writeCount = 0;
+    }
+    else
+    {
+        me->readAheadCount = me->stranded != NULL
+            ? Queue_removeN(me->stranded, me->readAhead, CACHEDQUEUE_BLOCK_ELEMENTS)
+            : 0;
+    }
+    return me->readAheadCount > 0;
+}
+
+/* gives up on the file up to end: nothing of it is read any more */
+static void dropRest(CachedQueue *const me, off_t end)
+{
+    me->readOffset = end;
+    me->readBufferPos = 0;
+    me->readBufferLen = 0;
+    me->skipOnLoad = 0;
+}
+
+/* nothing left to read before end, neither in the file nor in readBuffer */
+static int isDrained(CachedQueue *const me, off_t end)
+{
+    return me->readOffset == end && me->readBufferPos == me->readBufferLen;
+}
+
+/* once everything in the file has been read it starts over empty */
+static void resetFile(CachedQueue *const me)
+{
+    me->readOffset = CACHEDQUEUE_DATA_START;
+    me->writeOffset = CACHEDQUEUE_DATA_START;
+    me->readBufferPos = 0;
+    me->readBufferLen = 0;
+    me->checkpointHead = CACHEDQUEUE_DATA_START;
+    me->checkpointSkip = 0;
+    if (me->fd >= 0 && ftruncate(me->fd, CACHEDQUEUE_DATA_START) != 0)
+        printf("CachedQueue: cannot truncate %s: %s\n", me->filename, strerror(errno));
+    writeCheckpoint(me);
+}
+
+CachedQueue *CachedQueue_Create(const char *fName, int recover)
+{
+    CachedQueue *me = (CachedQueue *)
+        malloc(sizeof(CachedQueue));
+    if (me != NULL)
+    {
+        CachedQueue_Init(me, fName, &CachedQueue_vtbl);
+        if (recover)
+            CachedQueue_recover(me);
+    }
+    return me;
+}
+
+CachedQueue *CachedQueue_CreateMapped(const char *fName)
+{
+    CachedQueue *me = (CachedQueue *)
+        malloc(sizeof(CachedQueue));
+    if (me != NULL)
+    {
+        CachedQueue_Init(me, fName, &CachedQueue_vtblMapped);
+    }
+    return me;
+}
+
+CachedQueue *CachedQueue_CreateAsync(const char *fName, int recover)
 {
     CachedQueue *me = (CachedQueue *)
         malloc(sizeof(CachedQueue));
     if (me != NULL)
     {
-        CachedQueue_Init(me, "C:\\queuebuffer.dat",
-                         CachedQueue_isFull, CachedQueue_isEmpty,
-                         CachedQueue_getSize, CachedQueue_insert, CachedQueue_remove,
-                         CachedQueue_flush, CachedQueue_load);
+        CachedQueue_Init(me, fName, &CachedQueue_vtblAsync);
+        if (recover)
+            CachedQueue_recover(me);
+        if (!startWriter(me))
+        {
+            /* no writer thread: spill synchronously instead */
+            printf("CachedQueue: cannot start the writer thread, flushing inline\n");
+            me->vtbl = &CachedQueue_vtbl;
+        }
     }
     return me;
 }
@@ -2,16 +2,48 @@
 
 #define CACHEDQUEUE_H_
 
+#include <limits.h>
+
+#include <sys/types.h>
+
+#include <pthread.h>
+
 #include "queue.h"
+
+#include "blockCodec.h"
+
+/* capacity of the in-memory queue and of the outputQueue */
+#define CACHEDQUEUE_QUEUE_SIZE 1024
+/* the spill file is written one block at a time, each block compressed
+   (see blockCodec.h) */
+#define CACHEDQUEUE_BLOCK_SIZE 4096
+#define CACHEDQUEUE_BLOCK_ELEMENTS (CACHEDQUEUE_BLOCK_SIZE / (int)sizeof(int))
+/* the async writer takes the queue over in spills of several blocks, so
+   the queue and its spare are this large in that mode */
+#define CACHEDQUEUE_SPILL_BLOCKS 8
+#define CACHEDQUEUE_ASYNC_QUEUE_SIZE (CACHEDQUEUE_SPILL_BLOCKS * CACHEDQUEUE_BLOCK_ELEMENTS)
+/* and its writer thread runs at this (lower) priority */
+#define CACHEDQUEUE_WRITER_NICE 10
+/* a block it cannot write is tried this many more times, this far
+   apart, before the writer gives up on the disk */
+#define CACHEDQUEUE_WRITE_RETRIES 5
+#define CACHEDQUEUE_RETRY_MS 200
+/* and read back in large chunks */
+#define CACHEDQUEUE_READAHEAD_SIZE (64 * 1024)
+/* the blocks start after a checkpoint record, see CachedQueue_recover() */
+#define CACHEDQUEUE_DATA_START 64
+/* most elements spilled at once: numberElementsOnDisk is an int, and
+   getSize() adds what the two queues hold to it; beyond this a flush
+   refuses to spill, and the full queue drops new elements */
+#define CACHEDQUEUE_MAX_ON_DISK (INT_MAX - 2 * CACHEDQUEUE_ASYNC_QUEUE_SIZE)
+/* initial size of the memory-mapped ring file; it doubles when full */
+#define CACHEDQUEUE_MAP_SIZE (1024 * 1024)
+
 typedef struct CachedQueue CachedQueue;
-struct CachedQueue
+/* virtual operations, one const table per mode (see queue.h) */
+typedef struct CachedQueueVtbl CachedQueueVtbl;
+struct CachedQueueVtbl
 {
-    Queue *queue; /* base class */
-    /* new attributes */
-    char filename[80];
-    int numberElementsOnDisk;
-    /* aggregation in subclass */
-    Queue *outputQueue;
     /* inherited virtual functions */
     int (*isFull)(CachedQueue *const me);
     int (*isEmpty)(CachedQueue *const me);
@@ -22,14 +54,71 @@ struct CachedQueue
     void (*flush)(CachedQueue *const me);
     void (*load)(CachedQueue *const me);
 };
+struct CachedQueue
+{
+    const CachedQueueVtbl *vtbl;
+    Queue *queue; /* base class */
+    /* new attributes */
+    char filename[80];
+    /* elements spilled and not yet back in the outputQueue: the
+       readAhead buffer, then the file, then the writeBuffer */
+    int numberElementsOnDisk;
+    int diskFull;    /* reached CACHEDQUEUE_MAX_ON_DISK, and said so */
+    int fd;          /* spill file, -1 until the first flush */
+    off_t readOffset;  /* first byte of the file not yet in readBuffer */
+    off_t writeOffset; /* end of the data in the file */
+    int writeCount;    /* elements waiting in writeBuffer */
+    int readAheadPos;  /* next element of readAhead to hand out */
+    int readAheadCount;
+    int readBufferPos; /* next frame in readBuffer */
+    int readBufferLen;
+    off_t readAheadFrame; /* file offset of the block in readAhead, -1 if none */
+    int skipOnLoad;       /* elements of the next block loaded before a restart */
+    /* checkpoint: loading resumes at checkpointSkip elements into the
+       block at checkpointHead */
+    off_t checkpointHead;
+    int checkpointSkip;
+    /* mapped mode: the spill file is a ring of mapSize elements
+       mapped at map, numberElementsOnDisk of them from mapStart on */
+    int *map;
+    int mapSize;
+    int mapStart;
+    /* async mode: a full queue is swapped for the spare and handed to
+       a background writer thread, so insert() never waits for the disk
+       unless the previous spill is still being written */
+    Queue *spare;    /* empty queue to swap in next */
+    Queue *inFlight; /* full queue being written, NULL while idle */
+    int writerRunning;
+    int stopWriter;
+    int resetting;   /* the consumer is emptying the file; the writer waits */
+    /* once the writer has given up, the block it failed on is left in
+       writeBuffer and the rest of that spill in stranded, to be loaded
+       after the file; the queue then drops new elements when full */
+    int writeFailed;
+    Queue *stranded;
+    long spillWaits; /* flushAsync() calls that found the writer still busy */
+    pthread_t writer;
+    pthread_mutex_t writerLock; /* guards inFlight, spare, writeOffset, resetting,
+                                   writeFailed */
+    pthread_cond_t writerCond;  /* broadcast whenever one of those changes */
+    /* keeps checkpoint writes in order; taken before writerLock, and
+       held over the write so that writerLock never is */
+    pthread_mutex_t checkpointLock;
+    int writeBuffer[CACHEDQUEUE_BLOCK_ELEMENTS];
+    unsigned char encodeBuffer[BLOCKCODEC_MAX_FRAME(CACHEDQUEUE_BLOCK_ELEMENTS)];
+    unsigned char readBuffer[CACHEDQUEUE_READAHEAD_SIZE]; /* compressed */
+    int readAhead[CACHEDQUEUE_BLOCK_ELEMENTS];            /* decoded block */
+    /* aggregation in subclass */
+    Queue *outputQueue;
+};
+/* spill file, memory-mapped ring file and background writer modes */
+extern const CachedQueueVtbl CachedQueue_vtbl;
+extern const CachedQueueVtbl CachedQueue_vtblMapped;
+extern const CachedQueueVtbl CachedQueue_vtblAsync;
+
 /* Constructors and destructors:*/
-void CachedQueue_Init(CachedQueue *const me, char *fName,
-                      int (*isFullfunction)(CachedQueue *const me),
-                      int (*isEmptyfunction)(CachedQueue *const me), int (*getSizefunction)(CachedQueue *const me),
-                      void (*insertfunction)(CachedQueue *const me, int k),
-                      int (*removefunction)(CachedQueue *const me),
-                      void (*flushfunction)(CachedQueue *const me),
-                      void (*loadfunction)(CachedQueue *const me));
+void CachedQueue_Init(CachedQueue *const me, const char *fName,
+                      const CachedQueueVtbl *vtbl);
 
 void CachedQueue_Cleanup(CachedQueue *const me);
 /* Operations */
@@ -38,10 +127,31 @@ int CachedQueue_isEmpty(CachedQueue *const me);
 int CachedQueue_getSize(CachedQueue *const me);
 void CachedQueue_insert(CachedQueue *const me, int k);
 int CachedQueue_remove(CachedQueue *const me);
+int CachedQueue_insertN(CachedQueue *const me, const int *values, int n);
+int CachedQueue_removeN(CachedQueue *const me, int *values, int max);
 void CachedQueue_flush(CachedQueue *const me);
 void CachedQueue_load(CachedQueue *const me);
+/* picks up the spill file left behind by a process that ended without
+   Cleanup; returns the number of elements recovered. Only before the
+   first flush, and only for a file of this queue's own: a file whose
+   checkpoint does not agree with its blocks is not replayed, the queue
+   starts empty (and overwrites it). */
+int CachedQueue_recover(CachedQueue *const me);
+/* mapped mode: flush and load copy straight into and out of a
+   memory-mapped ring file, so spilled data that is consumed quickly
+   never leaves the page cache */
+void CachedQueue_flushMapped(CachedQueue *const me);
+void CachedQueue_loadMapped(CachedQueue *const me);
+/* async mode: flush only swaps buffers and wakes the writer thread */
+void CachedQueue_flushAsync(CachedQueue *const me);
+void CachedQueue_loadAsync(CachedQueue *const me);
 
-CachedQueue *CachedQueue_Create(void);
+/* every queue spills to a file of its own, fName; a file left behind
+   there is emptied on the first flush, unless recover is set, in which
+   case the queue starts with what CachedQueue_recover() finds in it */
+CachedQueue *CachedQueue_Create(const char *fName, int recover);
+CachedQueue *CachedQueue_CreateMapped(const char *fName);
+CachedQueue *CachedQueue_CreateAsync(const char *fName, int recover);
 void CachedQueue_Destroy(CachedQueue *const me);
 
 #endif /*CACHEDQUEUE_H_*/
\ No newline at end of file
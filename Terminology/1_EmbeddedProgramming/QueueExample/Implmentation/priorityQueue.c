@@ -0,0 +1,59 @@
+#include <stdlib.h>
+#include <limits.h>
+#include "priorityQueue.h"
+
+void PriorityQueue_Init(PriorityQueue *const me, int levels, int bufferSize)
+{
+    int j;
+    /* initialize attributes */
+    me->levels = levels;
+    me->ready = 0;
+    me->size = 0;
+    for (j = 0; j < levels; j++)
+    {
+        me->level[j].head = 0;
+        me->level[j].tail = 0;
+        me->level[j].bufferSize = bufferSize;
+        me->level[j].buffer = me->storage + (size_t)j * bufferSize;
+    }
+}
+
+/* operation Cleanup() */
+
+void PriorityQueue_Cleanup(PriorityQueue *const me)
+{
+    (void)me;
+}
+
+static PriorityQueue *PriorityQueue_alloc(int levels, int bufferSize)
+{
+    PriorityQueue *me = (PriorityQueue *)malloc(
+        sizeof(PriorityQueue) + (size_t)levels * (size_t)bufferSize * sizeof(int));
+    if (me != NULL)
+    {
+        PriorityQueue_Init(me, levels, bufferSize);
+    }
+    return me;
+}
+
+PriorityQueue *PriorityQueue_Create(void)
+{
+    return PriorityQueue_alloc(PRIORITYQUEUE_LEVELS, PRIORITYQUEUE_LEVEL_SIZE);
+}
+
+PriorityQueue *PriorityQueue_CreateWithCapacity(int levels, int capacity)
+{
+    if (levels < 1 || levels > PRIORITYQUEUE_MAX_LEVELS || capacity < 1 ||
+        capacity > INT_MAX / PRIORITYQUEUE_MAX_LEVELS - 1)
+        return NULL;
+    return PriorityQueue_alloc(levels, capacity + 1);
+}
+
+void PriorityQueue_Destroy(PriorityQueue *const me)
+{
+    if (me != NULL)
+    {
+        PriorityQueue_Cleanup(me);
+    }
+    free(me);
+}
@@ -0,0 +1,107 @@
+#ifndef PRIORITYQUEUE_H_
+
+#define PRIORITYQUEUE_H_
+
+#include "RingBuffer.h"
+
+/* levels and elements per level of PriorityQueue_Create() */
+#define PRIORITYQUEUE_LEVELS 8
+#define PRIORITYQUEUE_LEVEL_SIZE 16
+/* one bit per level in a 32-bit mask */
+#define PRIORITYQUEUE_MAX_LEVELS 32
+
+/* class PriorityQueue */
+/* A fixed number of priority levels, 0 the highest, each a FIFO ring of
+   its own. A bitmap has bit n set while level n holds elements, so the
+   highest non-empty level is its lowest set bit (one find-first-set
+   instruction): insert and remove take constant time whatever the
+   number of levels. Elements of the same priority come out in the
+   order they went in.
+   Like Queue, a PriorityQueue is one allocation, header followed by the
+   rings, so create it with one of the Create functions. */
+typedef struct PriorityQueue PriorityQueue;
+/* one ring per level */
+typedef struct PriorityLevel PriorityLevel;
+struct PriorityLevel
+{
+    int head;
+    int tail;
+    int bufferSize; /* number of slots in buffer, one of them always free */
+    int *buffer;    /* this level's part of the queue's storage */
+};
+struct PriorityQueue
+{
+    int levels;
+    unsigned int ready; /* bit n set while level n is not empty */
+    int size;           /* elements in all levels */
+    PriorityLevel level[PRIORITYQUEUE_MAX_LEVELS];
+    int storage[]; /* levels * bufferSize slots */
+};
+
+RING_BUFFER_DEFINE(PriorityRing, PriorityLevel, int, buffer, me->bufferSize, RING_UNLOCKED)
+
+/* Constructors and destructors:*/
+void PriorityQueue_Init(PriorityQueue *const me, int levels, int bufferSize);
+void PriorityQueue_Cleanup(PriorityQueue *const me);
+
+/* Operations */
+
+/* operation isEmpty() */
+static inline int PriorityQueue_isEmpty(const PriorityQueue *const me)
+{
+    return me->ready == 0;
+}
+/* operation isFull(int): 1 if no element of this priority fits */
+static inline int PriorityQueue_isFull(PriorityQueue *const me, int priority)
+{
+    return PriorityRing_isFull(&me->level[priority]);
+}
+/* operation getSize() */
+static inline int PriorityQueue_getSize(const PriorityQueue *const me)
+{
+    return me->size;
+}
+/* operation getPriority(): the priority remove() takes the next element
+   from, -1 if the queue is empty */
+static inline int PriorityQueue_getPriority(const PriorityQueue *const me)
+{
+    return me->ready != 0 ? __builtin_ctz(me->ready) : -1;
+}
+/* operation insert(int, int): returns 0 if the level of priority is
+   full (k is dropped) or priority is out of range, 1 otherwise */
+static inline int PriorityQueue_insert(PriorityQueue *const me, int k, int priority)
+{
+    if ((unsigned int)priority >= (unsigned int)me->levels ||
+        !PriorityRing_push(&me->level[priority], &k))
+        return 0;
+    me->ready |= 1u << priority;
+    me->size++;
+    return 1;
+}
+/* operation remove(): the oldest element of the highest priority */
+static inline int PriorityQueue_remove(PriorityQueue *const me)
+{
+    int value = -9999; /* sentinel value */
+    int priority;
+    PriorityLevel *level;
+    if (me->ready == 0)
+        return value;
+    priority = __builtin_ctz(me->ready);
+    level = &me->level[priority];
+    PriorityRing_pop(level, &value);
+    if (PriorityRing_isEmpty(level))
+        me->ready &= ~(1u << priority);
+    me->size--;
+    return value;
+}
+
+/* PRIORITYQUEUE_LEVELS levels of PRIORITYQUEUE_LEVEL_SIZE - 1 elements */
+PriorityQueue *PriorityQueue_Create(void);
+
+/* levels (1..PRIORITYQUEUE_MAX_LEVELS) levels of capacity elements each;
+   NULL if an argument is out of range or out of memory */
+PriorityQueue *PriorityQueue_CreateWithCapacity(int levels, int capacity);
+
+void PriorityQueue_Destroy(PriorityQueue *const me);
+
+#endif /*PRIORITYQUEUE_H_*/
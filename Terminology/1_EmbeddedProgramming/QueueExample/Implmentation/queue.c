@@ -1,23 +1,33 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 #include "queue.h"
-void Queue_Init(Queue *const me, int (*isFullfunction)(Queue *const me),
-                int (*isEmptyfunction)(Queue *const me),
-                int (*getSizefunction)(Queue *const me),
-                void (*insertfunction)(Queue *const me, int k),
-                int (*removefunction)(Queue *const me))
+
+/* non-inline copies of the operations for the vtables */
+const QueueVtbl Queue_vtbl = {
+    Queue_isFull, Queue_isEmpty, Queue_getSize, Queue_insert, Queue_remove};
+const QueueVtbl Queue_vtblSPSC = {
+    Queue_isFullSPSC, Queue_isEmptySPSC, Queue_getSizeSPSC, Queue_insertSPSC,
+    Queue_removeSPSC};
+
+void Queue_Init(Queue *const me, const QueueVtbl *vtbl)
 {
     /* initialize attributes */
     me->head = 0;
-    me->size = 0;
     me->tail = 0;
+    me->tailCache = 0;
+    me->headCache = 0;
+    me->emptyWaiters = 0;
+    me->fullWaiters = 0;
 
-    /* initialize member function pointers */
-    me->isFull = isFullfunction;
-    me->isEmpty = isEmptyfunction;
-    me->getSize = getSizefunction;
-    me->insert = insertfunction;
-    me->remove = removefunction;
+    /* initialize the virtual operations */
+    me->vtbl = vtbl;
 }
 
 /* operation Cleanup() */
@@ -26,57 +36,165 @@ void Queue_Cleanup(Queue *const me)
 {
 }
 
-/* operation isFull() */
-int Queue_isFull(Queue *const me)
+/* Blocking waits sleep on a futex: the kernel puts the thread to sleep
+   only if its waiters word is still set, so a wake-up that clears the
+   word between the last look at the queue and the sleep is never
+   missed. */
+
+/* deadline timeoutMs from now on the monotonic clock */
+static void Queue_deadline(struct timespec *deadline, int timeoutMs)
 {
-    return (me->head + 1) % QUEUE_SIZE == me->tail;
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += timeoutMs / 1000;
+    deadline->tv_nsec += (long)(timeoutMs % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L)
+    {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
 }
-/* operation isEmpty() */
-int Queue_isEmpty(Queue *const me)
+
+/* sleeps while *waiters is set, until deadline (NULL: no deadline);
+   returns 0 if the deadline passed */
+static int Queue_sleep(int *waiters, const struct timespec *deadline)
 {
-    return (me->head == me->tail);
+    /* the bitset variant takes an absolute time, so a wake-up that
+       finds nothing to do does not stretch the timeout */
+    if (syscall(SYS_futex, waiters, FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG, 1, deadline,
+                NULL, FUTEX_BITSET_MATCH_ANY) == -1 &&
+        errno == ETIMEDOUT)
+        return 0;
+    return 1;
 }
-/* operation getSize() */
-int Queue_getSize(Queue *const me)
+
+void Queue_wake(int *waiters)
 {
-    return me->size;
+    /* of several signals, only the one that clears the word wakes */
+    if (__atomic_exchange_n(waiters, 0, __ATOMIC_SEQ_CST) != 0)
+        syscall(SYS_futex, waiters, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
 }
-/* operation insert(int) */
-void Queue_insert(Queue *const me, int k)
+
+/* removeWait algorithm
+   set emptyWaiters, then look at the queue once more: an insert that
+   came before the store is seen by the pop, one that came after it
+   sees the store and clears emptyWaiters, so the sleep returns at once */
+int Queue_removeWaitSlow(Queue *const me, int *value, int timeoutMs)
 {
-    if (!me->isFull(me))
+    struct timespec deadline;
+    int awake = 1;
+
+    if (timeoutMs == 0)
+        return 0;
+    if (timeoutMs > 0)
+        Queue_deadline(&deadline, timeoutMs);
+    while (awake)
     {
-        me->buffer[me->head] = k;
-        me->head = (me->head + 1) % QUEUE_SIZE;
-        ++me->size;
+        __atomic_store_n(&me->emptyWaiters, 1, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (QueueSPSCRing_pop(me, value))
+        {
+            __atomic_store_n(&me->emptyWaiters, 0, __ATOMIC_RELAXED);
+            Queue_signal(&me->fullWaiters);
+            return 1;
+        }
+        awake = Queue_sleep(&me->emptyWaiters, timeoutMs < 0 ? NULL : &deadline);
     }
+    __atomic_store_n(&me->emptyWaiters, 0, __ATOMIC_RELAXED);
+    return 0;
 }
 
-/* operation remove */
-int Queue_remove(Queue *const me)
+/* insertWait algorithm
+   the same as removeWait, with the roles swapped */
+int Queue_insertWaitSlow(Queue *const me, int k, int timeoutMs)
 {
-    int value = -9999; /* sentinel value */
-    if (!me->isEmpty(me))
+    struct timespec deadline;
+    int awake = 1;
+
+    if (timeoutMs == 0)
+        return 0;
+    if (timeoutMs > 0)
+        Queue_deadline(&deadline, timeoutMs);
+    while (awake)
     {
-        value = me->buffer[me->tail];
-        me->tail = (me->tail + 1) % QUEUE_SIZE;
-        me->size;
+        __atomic_store_n(&me->fullWaiters, 1, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (QueueSPSCRing_push(me, &k))
+        {
+            __atomic_store_n(&me->fullWaiters, 0, __ATOMIC_RELAXED);
+            Queue_signal(&me->emptyWaiters);
+            return 1;
+        }
+        awake = Queue_sleep(&me->fullWaiters, timeoutMs < 0 ? NULL : &deadline);
     }
-    return value;
+    __atomic_store_n(&me->fullWaiters, 0, __ATOMIC_RELAXED);
+    return 0;
 }
 
-Queue *Queue_Create(void)
+/* Header and buffer come from one cache-line aligned block, so the buffer
+   is reached without a second pointer and the head and tail lines really
+   start on a line boundary. */
+static Queue *Queue_alloc(int bufferSize)
 {
+    size_t bytes;
+    Queue *me;
+    if (bufferSize < 2)
+        return NULL;
+    bytes = sizeof(Queue) + (size_t)bufferSize * sizeof(int);
+    /* aligned_alloc() wants a multiple of the alignment */
+    bytes = (bytes + QUEUE_CACHE_LINE - 1) & ~(size_t)(QUEUE_CACHE_LINE - 1);
+    me = (Queue *)aligned_alloc(QUEUE_CACHE_LINE, bytes);
+    if (me != NULL)
+        me->bufferSize = bufferSize;
+    return me;
+}
 
-    Queue *me = (Queue *)malloc(sizeof(Queue));
+static Queue *Queue_createClassic(int bufferSize)
+{
+    Queue *me = Queue_alloc(bufferSize);
     if (me != NULL)
     {
-        Queue_Init(me, Queue_isFull, Queue_isEmpty, Queue_getSize,
-                   Queue_insert, Queue_remove);
+        Queue_Init(me, &Queue_vtbl);
     }
     return me;
 }
 
+static Queue *Queue_createSPSC(int bufferSize)
+{
+    Queue *me = Queue_alloc(bufferSize);
+    if (me != NULL)
+    {
+        Queue_Init(me, &Queue_vtblSPSC);
+    }
+    return me;
+}
+
+Queue *Queue_Create(void)
+{
+    return Queue_createClassic(QUEUE_SIZE);
+}
+
+Queue *Queue_CreateWithCapacity(int capacity)
+{
+    if (capacity < 1 || capacity == INT_MAX)
+        return NULL;
+    return Queue_createClassic(capacity + 1);
+}
+
+Queue *Queue_CreateSPSC(void)
+{
+    return Queue_createSPSC(QUEUE_SPSC_SIZE);
+}
+
+Queue *Queue_CreateSPSCWithCapacity(int capacity)
+{
+    int bufferSize = 2;
+    if (capacity < 1 || capacity > INT_MAX / 2)
+        return NULL;
+    while (bufferSize - 1 < capacity)
+        bufferSize <<= 1;
+    return Queue_createSPSC(bufferSize);
+}
+
 void Queue_Destroy(Queue *const me)
 {
     if (me != NULL)
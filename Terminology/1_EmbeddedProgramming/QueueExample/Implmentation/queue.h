@@ -3,41 +3,209 @@
 #define QUEUE_H_
 
 #define QUEUE_SIZE 10
+/* default capacity of the lock-free single-producer/single-consumer mode;
+   SPSC buffers are always a power of two so that indices wrap with a mask */
+#define QUEUE_SPSC_SIZE 16
+/* head and tail live on separate cache lines so the producer and the
+   consumer never write to the same line */
+#define QUEUE_CACHE_LINE 64
+#define QUEUE_CACHE_ALIGNED __attribute__((aligned(QUEUE_CACHE_LINE)))
+
+#include "RingBuffer.h"
+
 /* class Queue */
+/* A Queue is a single allocation: the header is followed by its buffer
+   (a flexible array member), so create queues with one of the Create
+   functions rather than declaring them. */
 typedef struct Queue Queue;
-struct Queue {
-int buffer[QUEUE_SIZE]; /* where the data things are */
-int head;
-int size;
-int tail;
+/* virtual operations: one const table per kind of queue, shared by
+   all of its instances. Call them as q->vtbl->insert(q, k) when the
+   kind of queue is not known; code that knows it calls the inline
+   operations below (Queue_insert(), Queue_insertSPSC(), ...) directly
+   and pays no indirect call. */
+typedef struct QueueVtbl QueueVtbl;
+struct QueueVtbl {
 int (*isFull)(Queue* const me);
 int (*isEmpty)(Queue* const me);
 int (*getSize)(Queue* const me);
 void (*insert)(Queue* const me, int k);
 int (*remove)(Queue* const me);
 };
+struct Queue {
+const QueueVtbl* vtbl;
+int bufferSize; /* number of slots in buffer, one of them always free */
+/* producer side: written only by insert() */
+QUEUE_CACHE_ALIGNED int head;
+int tailCache; /* SPSC mode: last tail seen by the producer */
+/* consumer side: written only by remove() */
+QUEUE_CACHE_ALIGNED int tail;
+int headCache; /* SPSC mode: last head seen by the consumer */
+/* blocking waits, see Queue_removeWait(): a side that has to wait
+   marks itself in its waiters word and sleeps on that word; the other
+   side clears the word and wakes it only if it was set, so nobody makes
+   a system call unless someone sleeps, and then only once per sleep */
+QUEUE_CACHE_ALIGNED int emptyWaiters; /* consumers asleep on an empty queue */
+int fullWaiters;                      /* producers asleep on a full queue */
+QUEUE_CACHE_ALIGNED int buffer[]; /* where the data things are */
+};
+/* vtables of the two kinds of queue */
+extern const QueueVtbl Queue_vtbl;
+extern const QueueVtbl Queue_vtblSPSC;
+
 /* Constructors and destructors:*/
-void Queue_Init(Queue* const me,int (*isFullfunction)(Queue* const me),
-int (*isEmptyfunction)(Queue* const me),
-int (*getSizefunction)(Queue* const me),
-void (*insertfunction)(Queue* const me, int k),
-int (*removefunction)(Queue* const me) );
+void Queue_Init(Queue* const me, const QueueVtbl* vtbl);
 
 void Queue_Cleanup(Queue* const me);
 /* Operations */
 
-int Queue_isFull(Queue* const me);
+/* both modes share the same buffer, head and tail */
+RING_BUFFER_DEFINE(QueueRing, Queue, int, buffer, me->bufferSize, RING_UNLOCKED)
+RING_BUFFER_DEFINE(QueueSPSCRing, Queue, int, buffer, me->bufferSize, RING_SPSC)
+
+/* operation isFull() */
+static inline int Queue_isFull(Queue* const me)
+{
+return QueueRing_isFull(me);
+}
+/* operation isEmpty() */
+static inline int Queue_isEmpty(Queue* const me)
+{
+return QueueRing_isEmpty(me);
+}
+/* operation getSize() */
+static inline int Queue_getSize(Queue* const me)
+{
+return QueueRing_count(me);
+}
+/* operation insert(int) */
+static inline void Queue_insert(Queue* const me, int k)
+{
+QueueRing_push(me, &k); /* a full queue drops k */
+}
+/* operation remove */
+static inline int Queue_remove(Queue* const me)
+{
+int value = -9999; /* sentinel value */
+QueueRing_pop(me, &value);
+return value;
+}
 
-int Queue_isEmpty(Queue* const me);
+/* bulk operations: copy whole spans (at most two memcpy's across the
+   wrap point) and return the number of elements actually moved */
 
-int Queue_getSize(Queue* const me);
+/* operation insertN(const int*, int) */
+static inline int Queue_insertN(Queue* const me, const int* values, int n)
+{
+return QueueRing_pushN(me, values, n);
+}
+/* operation removeN(int*, int) */
+static inline int Queue_removeN(Queue* const me, int* values, int max)
+{
+return QueueRing_popN(me, values, max);
+}
 
-void Queue_insert(Queue* const me, int k);
+/* SPSC mode operations: safe without a lock as long as exactly one
+   thread calls insert() and exactly one thread calls remove()
+   The producer owns head and the consumer owns tail. Each side publishes
+   its own index with a release store and reads the other side's index
+   with an acquire load, so a slot is always written before it becomes
+   visible to the consumer and read before it is handed back to the
+   producer. */
 
-int Queue_remove(Queue* const me);
+static inline int Queue_isFullSPSC(Queue* const me)
+{
+return QueueSPSCRing_isFull(me);
+}
+static inline int Queue_isEmptySPSC(Queue* const me)
+{
+return QueueSPSCRing_isEmpty(me);
+}
+static inline int Queue_getSizeSPSC(Queue* const me)
+{
+return QueueSPSCRing_count(me);
+}
+/* producer thread only */
+static inline void Queue_insertSPSC(Queue* const me, int k)
+{
+QueueSPSCRing_push(me, &k); /* a full queue drops k */
+}
+/* consumer thread only */
+static inline int Queue_removeSPSC(Queue* const me)
+{
+int value = -9999; /* sentinel value */
+QueueSPSCRing_pop(me, &value);
+return value;
+}
+/* producer thread only */
+static inline int Queue_insertNSPSC(Queue* const me, const int* values, int n)
+{
+return QueueSPSCRing_pushN(me, values, n);
+}
+/* consumer thread only */
+static inline int Queue_removeNSPSC(Queue* const me, int* values, int max)
+{
+return QueueSPSCRing_popN(me, values, max);
+}
 
+/* blocking operations (SPSC mode): the consumer thread calls
+   removeWait() and the producer thread calls insertWait() instead of
+   polling isEmpty() and isFull(). timeoutMs < 0 waits for as long as
+   it takes, 0 does not wait at all. Both return 1 on success and 0 on
+   a timeout.
+   Only the Wait operations wake the other side, so if one side waits,
+   the other side has to use the Wait operation too (its fast path
+   never sleeps and costs a fence and a load over the plain one). */
+
+/* slow paths and wake-up, in queue.c */
+int Queue_removeWaitSlow(Queue* const me, int* value, int timeoutMs);
+int Queue_insertWaitSlow(Queue* const me, int k, int timeoutMs);
+void Queue_wake(int* waiters);
+
+/* wakes the threads asleep on waiters, if there are any; the fence
+   orders the caller's head or tail store before the waiters load,
+   against the waiter's store to waiters before its own head or tail
+   load, so one of the two always sees the other */
+static inline void Queue_signal(int* waiters)
+{
+__atomic_thread_fence(__ATOMIC_SEQ_CST);
+if (__atomic_load_n(waiters, __ATOMIC_RELAXED) != 0)
+    Queue_wake(waiters);
+}
+/* consumer thread only: removes the oldest element into *value */
+static inline int Queue_removeWait(Queue* const me, int* value, int timeoutMs)
+{
+if (!QueueSPSCRing_pop(me, value))
+    return Queue_removeWaitSlow(me, value, timeoutMs);
+Queue_signal(&me->fullWaiters);
+return 1;
+}
+/* producer thread only */
+static inline int Queue_insertWait(Queue* const me, int k, int timeoutMs)
+{
+if (!QueueSPSCRing_push(me, &k))
+    return Queue_insertWaitSlow(me, k, timeoutMs);
+Queue_signal(&me->emptyWaiters);
+return 1;
+}
+
+/* number of elements the queue can hold */
+static inline int Queue_getCapacity(const Queue* const me)
+{
+return me->bufferSize - 1;
+}
+
+/* holds QUEUE_SIZE - 1 elements */
 Queue * Queue_Create(void);
 
+/* holds at least capacity elements; NULL if capacity < 1 or out of memory */
+Queue * Queue_CreateWithCapacity(int capacity);
+
+/* holds QUEUE_SPSC_SIZE - 1 elements */
+Queue * Queue_CreateSPSC(void);
+
+/* holds at least capacity elements (rounded up to a power of two minus one) */
+Queue * Queue_CreateSPSCWithCapacity(int capacity);
+
 void Queue_Destroy(Queue* const me);
 
 #endif /*QUEUE_H_*/
\ No newline at end of file
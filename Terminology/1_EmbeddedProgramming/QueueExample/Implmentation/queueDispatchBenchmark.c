@@ -0,0 +1,90 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+
+#include <stdlib.h>
+
+#include <time.h>
+
+#include "queue.h"
+
+/* Cost of one insert() + remove() pair on a Queue, called three ways:
+
+   per-object pointers  the old layout, every Queue carrying its own
+                        function pointers
+   shared vtable        q->vtbl->insert(q, k)
+   inline               Queue_insert(q, k), for code that knows the
+                        kind of queue it has */
+
+#define ROUNDS 100000000
+
+/* the old layout: pointers copied into the object */
+typedef struct OldQueue OldQueue;
+struct OldQueue {
+    int (*isFull)(Queue *const me);
+    int (*isEmpty)(Queue *const me);
+    int (*getSize)(Queue *const me);
+    void (*insert)(Queue *const me, int k);
+    int (*remove)(Queue *const me);
+};
+
+static double seconds(const struct timespec *start, const struct timespec *stop)
+{
+    return (stop->tv_sec - start->tv_sec) + (stop->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void report(const char *name, double s, long sum)
+{
+    printf("%-22s %6.2f ns per insert+remove (checksum %ld)\n",
+           name, s / ROUNDS * 1e9, sum);
+}
+
+int main(void)
+{
+    Queue *q = Queue_Create();
+    OldQueue old;
+    OldQueue *volatile oldp = &old; /* keep the compiler from resolving the calls */
+    struct timespec start, stop;
+    long sum;
+    int j;
+
+    old.isFull = q->vtbl->isFull;
+    old.isEmpty = q->vtbl->isEmpty;
+    old.getSize = q->vtbl->getSize;
+    old.insert = q->vtbl->insert;
+    old.remove = q->vtbl->remove;
+
+    sum = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (j = 0; j < ROUNDS; j++)
+    {
+        OldQueue *o = oldp;
+        o->insert(q, j);
+        sum += o->remove(q);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    report("per-object pointers", seconds(&start, &stop), sum);
+
+    sum = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (j = 0; j < ROUNDS; j++)
+    {
+        q->vtbl->insert(q, j);
+        sum += q->vtbl->remove(q);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    report("shared vtable", seconds(&start, &stop), sum);
+
+    sum = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (j = 0; j < ROUNDS; j++)
+    {
+        Queue_insert(q, j);
+        sum += Queue_remove(q);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    report("inline", seconds(&start, &stop), sum);
+
+    Queue_Destroy(q);
+    return EXIT_SUCCESS;
+}
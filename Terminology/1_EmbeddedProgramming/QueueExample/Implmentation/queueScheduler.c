@@ -0,0 +1,156 @@
+#include <stdlib.h>
+#include "queueScheduler.h"
+
+void QueueScheduler_Init(QueueScheduler *const me, int maxStreams)
+{
+    int j;
+    /* initialize attributes */
+    me->maxStreams = maxStreams;
+    me->streams = 0;
+    me->current = -1;
+    me->summary = 0;
+    for (j = 0; j < QUEUESCHEDULER_MAX_STREAMS / 64; j++)
+        me->ready[j] = 0;
+}
+
+/* operation Cleanup() */
+
+void QueueScheduler_Cleanup(QueueScheduler *const me)
+{
+    (void)me;
+}
+
+int QueueScheduler_attach(QueueScheduler *const me, Queue *q, int weight)
+{
+    QueueStream *s;
+    if (me->streams == me->maxStreams || weight < 1)
+        return -1;
+    s = &me->stream[me->streams];
+    s->queue = q;
+    s->spsc = q->vtbl == &Queue_vtblSPSC;
+    s->weight = weight;
+    s->deficit = 0;
+    /* it may have elements already */
+    if (!(s->spsc ? Queue_isEmptySPSC(q) : Queue_isEmpty(q)))
+        QueueScheduler_markReady(me, me->streams);
+    return me->streams++;
+}
+
+static inline int QueueScheduler_pop(QueueStream *s, int *value)
+{
+    return s->spsc ? QueueSPSCRing_pop(s->queue, value) : QueueRing_pop(s->queue, value);
+}
+
+static inline int QueueScheduler_isEmpty(QueueStream *s)
+{
+    return s->spsc ? Queue_isEmptySPSC(s->queue) : Queue_isEmpty(s->queue);
+}
+
+/* clears the ready bit of a stream found empty, then looks again: an
+   insert that the look misses sets the bit after it was cleared */
+static void QueueScheduler_clearReady(QueueScheduler *const me, int stream)
+{
+    int w = stream >> 6;
+    uint64_t left = __atomic_and_fetch(&me->ready[w], ~(1ull << (stream & 63)), __ATOMIC_SEQ_CST);
+    if (!QueueScheduler_isEmpty(&me->stream[stream]))
+    {
+        QueueScheduler_markReady(me, stream);
+        return;
+    }
+    if (left == 0)
+    {
+        /* the same for the summary bit of the word */
+        __atomic_and_fetch(&me->summary, ~(1ull << w), __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&me->ready[w], __ATOMIC_SEQ_CST) != 0)
+            __atomic_fetch_or(&me->summary, 1ull << w, __ATOMIC_SEQ_CST);
+    }
+}
+
+/* first ready stream from stream from on, wrapping around to 0; -1 if
+   there is none */
+static int QueueScheduler_nextReady(QueueScheduler *const me, int from)
+{
+    int w = from >> 6;
+    uint64_t bits = __atomic_load_n(&me->ready[w], __ATOMIC_ACQUIRE) & (~0ull << (from & 63));
+    uint64_t sum;
+    if (bits != 0)
+        return (w << 6) + __builtin_ctzll(bits);
+    for (;;)
+    {
+        /* words after w, else from the first word on */
+        sum = __atomic_load_n(&me->summary, __ATOMIC_ACQUIRE);
+        if (w < 63 && (sum & (~0ull << (w + 1))) != 0)
+            sum &= ~0ull << (w + 1);
+        if (sum == 0)
+            return -1;
+        w = __builtin_ctzll(sum);
+        bits = __atomic_load_n(&me->ready[w], __ATOMIC_ACQUIRE);
+        if (bits != 0)
+            return (w << 6) + __builtin_ctzll(bits);
+        /* the word emptied after its summary bit was read */
+        __atomic_and_fetch(&me->summary, ~(1ull << w), __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&me->ready[w], __ATOMIC_SEQ_CST) != 0)
+            __atomic_fetch_or(&me->summary, 1ull << w, __ATOMIC_SEQ_CST);
+    }
+}
+
+/* remove algorithm (deficit round robin, one unit per element)
+   keep taking from the current stream while its deficit lasts; then
+   move on to the next ready stream after it and credit it its weight.
+   A stream that runs dry loses what is left of its deficit, so an idle
+   stream cannot save up a burst. */
+int QueueScheduler_remove(QueueScheduler *const me, int *value)
+{
+    int current = me->current;
+    QueueStream *s;
+
+    for (;;)
+    {
+        if (current < 0 || me->stream[current].deficit <= 0)
+        {
+            current = QueueScheduler_nextReady(me, current + 1 < me->streams ? current + 1 : 0);
+            if (current < 0)
+            {
+                me->current = -1;
+                return -1;
+            }
+            me->stream[current].deficit += me->stream[current].weight;
+        }
+        s = &me->stream[current];
+        if (QueueScheduler_pop(s, value))
+            break;
+        s->deficit = 0;
+        QueueScheduler_clearReady(me, current);
+    }
+    s->deficit--;
+    if (QueueScheduler_isEmpty(s))
+    {
+        s->deficit = 0;
+        QueueScheduler_clearReady(me, current);
+    }
+    me->current = current;
+    return current;
+}
+
+QueueScheduler *QueueScheduler_Create(int maxStreams)
+{
+    QueueScheduler *me;
+    if (maxStreams < 1 || maxStreams > QUEUESCHEDULER_MAX_STREAMS)
+        return NULL;
+    me = (QueueScheduler *)malloc(sizeof(QueueScheduler) +
+                                  (size_t)maxStreams * sizeof(QueueStream));
+    if (me != NULL)
+    {
+        QueueScheduler_Init(me, maxStreams);
+    }
+    return me;
+}
+
+void QueueScheduler_Destroy(QueueScheduler *const me)
+{
+    if (me != NULL)
+    {
+        QueueScheduler_Cleanup(me);
+    }
+    free(me);
+}
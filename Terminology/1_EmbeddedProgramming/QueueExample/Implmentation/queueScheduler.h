@@ -0,0 +1,90 @@
+#ifndef QUEUESCHEDULER_H_
+
+#define QUEUESCHEDULER_H_
+
+#include <stdint.h>
+
+#include "queue.h"
+
+/* most streams one scheduler serves: 64 words of 64 ready bits */
+#define QUEUESCHEDULER_MAX_STREAMS 4096
+
+/* class QueueScheduler */
+/* One consumer draining many Queues (streams) by weighted deficit round
+   robin: streams are visited in turn, and a visit adds the stream's
+   weight to its deficit and hands out elements while the deficit lasts,
+   so over time stream i gets weight[i] / sum(weight) of the elements
+   among the streams that have any.
+   Which streams have elements is kept in a bitmap, one bit per stream,
+   with a summary word holding one bit per non-zero bitmap word, so the
+   next ready stream is found with two find-first-set instructions and
+   empty streams cost nothing, however many there are.
+   Producers insert through the scheduler (or call markReady() after
+   inserting themselves) so that the bit gets set. A stream whose Queue
+   is in SPSC mode may have its own producer thread; the bitmap is
+   updated atomically and remove() must be called from one thread. */
+typedef struct QueueScheduler QueueScheduler;
+typedef struct QueueStream QueueStream;
+struct QueueStream
+{
+    Queue *queue;
+    int spsc;    /* queue is in SPSC mode */
+    int weight;  /* elements per round */
+    int deficit; /* elements left in the current visit */
+};
+struct QueueScheduler
+{
+    int maxStreams;
+    int streams; /* attached so far */
+    int current; /* stream being visited, -1 before the first remove() */
+    uint64_t summary; /* bit w set while ready[w] may be non-zero */
+    uint64_t ready[QUEUESCHEDULER_MAX_STREAMS / 64]; /* bit s set while stream s has elements */
+    QueueStream stream[]; /* maxStreams of them */
+};
+
+/* Constructors and destructors:*/
+void QueueScheduler_Init(QueueScheduler *const me, int maxStreams);
+void QueueScheduler_Cleanup(QueueScheduler *const me);
+
+/* Operations */
+
+/* adds q with weight (>= 1) and returns its stream number, or -1 if
+   the scheduler is full or weight is out of range; the scheduler does
+   not own q */
+int QueueScheduler_attach(QueueScheduler *const me, Queue *q, int weight);
+
+/* marks stream as having elements */
+static inline void QueueScheduler_markReady(QueueScheduler *const me, int stream)
+{
+    uint64_t bit = 1ull << (stream & 63);
+    int w = stream >> 6;
+    /* the stream bit first, so a consumer that sees the summary bit
+       finds the stream; the read-modify-write orders the caller's
+       insert before it, against the consumer clearing the bit and then
+       looking at the queue again (see QueueScheduler_remove()) */
+    __atomic_fetch_or(&me->ready[w], bit, __ATOMIC_SEQ_CST);
+    if ((__atomic_load_n(&me->summary, __ATOMIC_SEQ_CST) & (1ull << w)) == 0)
+        __atomic_fetch_or(&me->summary, 1ull << w, __ATOMIC_SEQ_CST);
+}
+
+/* producer side: inserts k into stream's queue; 0 if it is full */
+static inline int QueueScheduler_insert(QueueScheduler *const me, int stream, int k)
+{
+    QueueStream *s = &me->stream[stream];
+    if (!(s->spsc ? QueueSPSCRing_push(s->queue, &k) : QueueRing_push(s->queue, &k)))
+        return 0;
+    QueueScheduler_markReady(me, stream);
+    return 1;
+}
+
+/* consumer side: removes the next element into *value and returns the
+   stream it came from, or -1 if every stream is empty */
+int QueueScheduler_remove(QueueScheduler *const me, int *value);
+
+/* stream numbers 0..maxStreams-1 (at most QUEUESCHEDULER_MAX_STREAMS);
+   NULL if maxStreams is out of range or out of memory */
+QueueScheduler *QueueScheduler_Create(int maxStreams);
+
+void QueueScheduler_Destroy(QueueScheduler *const me);
+
+#endif /*QUEUESCHEDULER_H_*/
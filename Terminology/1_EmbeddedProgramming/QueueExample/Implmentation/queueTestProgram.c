@@ -1,9 +1,81 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 
 #include <stdlib.h>
 
+#include <pthread.h>
+
+#include <sched.h>
+
+#include <time.h>
+
+#include <unistd.h>
+
+#include <sys/wait.h>
+
 #include "queue.h"
 
+#include "cachedQueue.h"
+
+#include "priorityQueue.h"
+
+#include "queueScheduler.h"
+
+#define SPSC_TEST_COUNT 20000000
+#define SPSC_TEST_CAPACITY 4096
+#define LARGE_TEST_CAPACITY 1000000
+#define CACHED_TEST_COUNT 1000000
+#define CACHED_TEST_BURST 1024
+#define CACHED_TEST_PAUSE_NS 200000 /* 200 us: about 5M elements/s */
+#define SCHEDULER_TEST_STREAMS 512
+#define SCHEDULER_TEST_ROUNDS 20000
+
+/* producer thread for the SPSC test: pushes 0..SPSC_TEST_COUNT-1 */
+static void *spscProducer(void *arg)
+{
+    Queue *q = (Queue *)arg;
+    int j;
+    for (j = 0; j < SPSC_TEST_COUNT; j++)
+    {
+        while (Queue_isFullSPSC(q))
+            sched_yield(); /* wait for the consumer */
+        Queue_insertSPSC(q, j);
+    }
+    return NULL;
+}
+
+/* the same with the blocking operations */
+static void *spscProducerWait(void *arg)
+{
+    Queue *q = (Queue *)arg;
+    int j;
+    for (j = 0; j < SPSC_TEST_COUNT; j++)
+        Queue_insertWait(q, j, -1);
+    return NULL;
+}
+
+/* cached queue in mode 0 (spill file), 1 (mapped) or 2 (async), on a
+   file of its own that is not recovered */
+static CachedQueue *createCachedQueue(int mode)
+{
+    static const char *fName[] = {"queuebuffer.dat", "queuebuffer.map", "queuebuffer.async"};
+    if (mode == 1)
+        return CachedQueue_CreateMapped(fName[mode]);
+    if (mode == 2)
+        return CachedQueue_CreateAsync(fName[mode], 0);
+    return CachedQueue_Create(fName[mode], 0);
+}
+
+/* inserts one element after a pause, for the idle wait test */
+static void *lateProducer(void *arg)
+{
+    struct timespec pause = {0, 50000000}; /* 50 ms */
+    nanosleep(&pause, NULL);
+    Queue_insertWait((Queue *)arg, 42, -1);
+    return NULL;
+}
+
 int main(void)
 {
     int j, k, h, t;
@@ -14,21 +86,299 @@ int main(void)
     for (j = 0; j < QUEUE_SIZE; j++)
     {
         h = myQ->head;
-        myQ->insert(myQ, k);
-        printf("inserting %d at position %d, size =%d\n", k--, h, myQ->getSize(myQ));
+        myQ->vtbl->insert(myQ, k);
+        printf("inserting %d at position %d, size =%d\n", k--, h, myQ->vtbl->getSize(myQ));
     };
 
-    printf("Inserted %d elements\n", myQ->getSize(myQ));
+    printf("Inserted %d elements\n", myQ->vtbl->getSize(myQ));
 
     for (j = 0; j < QUEUE_SIZE; j++)
     {
         t = myQ->tail;
-        k = myQ->remove(myQ);
-        printf("REMOVING %d at position %d, size =%d\n", k, t, myQ->getSize(myQ));
+        k = myQ->vtbl->remove(myQ);
+        printf("REMOVING %d at position %d, size =%d\n", k, t, myQ->vtbl->getSize(myQ));
     };
     printf("Last item removed = %d\n", k);
-    printf("Current queue size %d\n", myQ->getSize(myQ));
+    printf("Current queue size %d\n", myQ->vtbl->getSize(myQ));
+    Queue_Destroy(myQ);
+
+    /* test bulk operations across the wrap point */
+    {
+        int in[QUEUE_SIZE], out[QUEUE_SIZE];
+        int n, total = 0;
+        myQ = Queue_Create();
+        for (j = 0; j < QUEUE_SIZE; j++)
+            in[j] = j;
+        Queue_insertN(myQ, in, 8);
+        Queue_removeN(myQ, out, 6);
+        n = Queue_insertN(myQ, in, 5); /* wraps around the end of the buffer */
+        printf("Bulk: inserted %d more elements at position 8, size =%d\n", n, myQ->vtbl->getSize(myQ));
+        while ((n = Queue_removeN(myQ, out, QUEUE_SIZE)) > 0)
+        {
+            for (j = 0; j < n; j++)
+                printf("%d ", out[j]);
+            total += n;
+        }
+        printf("\nBulk: removed %d elements, size =%d\n", total, myQ->vtbl->getSize(myQ));
+        Queue_Destroy(myQ);
+    }
+
+    /* test priority queue: alarms (0) overtake commands (3) and telemetry (7) */
+    {
+        PriorityQueue *myPQ = PriorityQueue_Create();
+        static const int priority[] = {7, 3, 7, 0, 3, 0, 7};
+        for (j = 0; j < (int)(sizeof(priority) / sizeof(priority[0])); j++)
+            PriorityQueue_insert(myPQ, 100 * priority[j] + j, priority[j]);
+        printf("Priority: inserted %d elements, highest priority %d\n",
+               PriorityQueue_getSize(myPQ), PriorityQueue_getPriority(myPQ));
+        while (!PriorityQueue_isEmpty(myPQ))
+        {
+            h = PriorityQueue_getPriority(myPQ);
+            printf("%d (priority %d) ", PriorityQueue_remove(myPQ), h);
+        }
+        printf("\nPriority: size =%d\n", PriorityQueue_getSize(myPQ));
+        PriorityQueue_Destroy(myPQ);
+    }
+
+    /* test queue scheduler: 512 streams, three of them busy with
+       weights 1, 2 and 4; compare with polling every stream in turn */
+    {
+        static Queue *streams[SCHEDULER_TEST_STREAMS];
+        static const int busy[] = {5, 200, 450};
+        QueueScheduler *sched = QueueScheduler_Create(SCHEDULER_TEST_STREAMS);
+        struct timespec start, stop;
+        double schedNs, pollNs;
+        int got[3] = {0, 0, 0};
+        int r, s, n;
+
+        for (j = 0; j < SCHEDULER_TEST_STREAMS; j++)
+        {
+            streams[j] = Queue_CreateWithCapacity(64);
+            QueueScheduler_attach(sched, streams[j], j == busy[0] ? 1 : j == busy[1] ? 2 : 4);
+        }
+        for (j = 0; j < 3; j++)
+            for (k = 0; k < 14; k++)
+                QueueScheduler_insert(sched, busy[j], k);
+        for (j = 0; j < 14; j++)
+        {
+            s = QueueScheduler_remove(sched, &k);
+            got[s == busy[0] ? 0 : s == busy[1] ? 1 : 2]++;
+        }
+        printf("Scheduler: first 14 elements by weight 1/2/4: %d/%d/%d\n", got[0], got[1], got[2]);
+        while (QueueScheduler_remove(sched, &k) >= 0)
+            ;
+
+        n = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (r = 0; r < SCHEDULER_TEST_ROUNDS; r++)
+        {
+            for (j = 0; j < 3; j++)
+                QueueScheduler_insert(sched, busy[j], r);
+            while (QueueScheduler_remove(sched, &k) >= 0)
+                n++;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        schedNs = ((stop.tv_sec - start.tv_sec) * 1e9 + (stop.tv_nsec - start.tv_nsec)) / n;
+
+        n = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (r = 0; r < SCHEDULER_TEST_ROUNDS; r++)
+        {
+            for (j = 0; j < 3; j++)
+                Queue_insert(streams[busy[j]], r);
+            for (j = 0; j < SCHEDULER_TEST_STREAMS; j++)
+                while (!Queue_isEmpty(streams[j]))
+                {
+                    Queue_remove(streams[j]);
+                    n++;
+                }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        pollNs = ((stop.tv_sec - start.tv_sec) * 1e9 + (stop.tv_nsec - start.tv_nsec)) / n;
+        printf("Scheduler: %.1f ns per element, polling %d streams: %.1f ns per element\n",
+               schedNs, SCHEDULER_TEST_STREAMS, pollNs);
+
+        for (j = 0; j < SCHEDULER_TEST_STREAMS; j++)
+            Queue_Destroy(streams[j]);
+        QueueScheduler_Destroy(sched);
+    }
+
+    /* test runtime-sized queue */
+    myQ = Queue_CreateWithCapacity(LARGE_TEST_CAPACITY);
+    for (j = 0; !myQ->vtbl->isFull(myQ); j++)
+        myQ->vtbl->insert(myQ, j);
+    printf("Large queue: capacity %d, inserted %d elements\n", Queue_getCapacity(myQ), j);
+    for (j = 0; !myQ->vtbl->isEmpty(myQ) && myQ->vtbl->remove(myQ) == j; j++)
+        ;
+    printf("Large queue: removed %d elements in order, size =%d\n", j, myQ->vtbl->getSize(myQ));
+    Queue_Destroy(myQ);
+
+    /* test cached queues: the overflow goes to disk (a spill file, a
+       memory-mapped ring file, or a spill file written by a background
+       thread) and comes back in order. This producer never pauses, so it
+       outruns the disk and every mode's slowest insert waits for it. */
+    {
+        const char *name[] = {"Cached queue", "Mapped cached queue", "Async cached queue"};
+        struct timespec before, after;
+        long ns, worst;
+        for (h = 0; h < 3; h++)
+        {
+            CachedQueue *myCQ = createCachedQueue(h);
+            worst = 0;
+            for (j = 0; j < CACHED_TEST_COUNT; j++)
+            {
+                clock_gettime(CLOCK_MONOTONIC, &before);
+                myCQ->vtbl->insert(myCQ, j);
+                clock_gettime(CLOCK_MONOTONIC, &after);
+                ns = (after.tv_sec - before.tv_sec) * 1000000000L + (after.tv_nsec - before.tv_nsec);
+                if (ns > worst)
+                    worst = ns;
+            }
+            printf("%s: inserted %d elements, %d of them on disk, slowest insert %ld us\n",
+                   name[h], myCQ->vtbl->getSize(myCQ), myCQ->numberElementsOnDisk, worst / 1000);
+            for (j = 0; !myCQ->vtbl->isEmpty(myCQ) && myCQ->vtbl->remove(myCQ) == j; j++)
+                ;
+            printf("%s: removed %d elements in order, size =%d\n", name[h], j, myCQ->vtbl->getSize(myCQ));
+            CachedQueue_Destroy(myCQ);
+        }
+    }
+
+    /* test producer latency while spilling: with a producer that stays
+       below the disk's rate (bursts of CACHED_TEST_BURST elements, then a
+       pause), an inline flush writes every spill inside insert(), while
+       the async mode only swaps buffers and no spill has to wait for the
+       writer. The slowest insert is wall-clock time, though, and is not
+       bounded by either mode: on a single CPU it includes the producer
+       being preempted (by the writer thread among others), so it varies
+       from run to run and from disk to disk. */
+    {
+        const char *name[] = {"Cached queue", "Async cached queue"};
+        struct timespec before, after, pause = {0, CACHED_TEST_PAUSE_NS};
+        long ns, worst, slow, spills;
+        for (h = 0; h < 2; h++)
+        {
+            CachedQueue *myCQ = createCachedQueue(2 * h);
+            worst = 0;
+            slow = 0;
+            spills = 0;
+            for (j = 0; j < CACHED_TEST_COUNT; j++)
+            {
+                if (j % CACHED_TEST_BURST == 0)
+                    nanosleep(&pause, NULL);
+                if (Queue_isFull(myCQ->queue))
+                    spills++;
+                clock_gettime(CLOCK_MONOTONIC, &before);
+                myCQ->vtbl->insert(myCQ, j);
+                clock_gettime(CLOCK_MONOTONIC, &after);
+                ns = (after.tv_sec - before.tv_sec) * 1000000000L + (after.tv_nsec - before.tv_nsec);
+                if (ns > worst)
+                    worst = ns;
+                if (ns > 10000)
+                    slow++;
+            }
+            printf("%s, paced producer: slowest insert %ld us, %ld inserts over 10 us, "
+                   "%ld of %ld spills waited for the disk\n",
+                   name[h], worst / 1000, slow, h ? myCQ->spillWaits : spills, spills);
+            CachedQueue_Destroy(myCQ);
+        }
+    }
+
+    /* test crash recovery: a child process spills to disk and dies
+       without cleaning up; the next cached queue on that file asks to
+       recover it and picks it up */
+    {
+        CachedQueue *myCQ;
+        struct timespec start, stop;
+        pid_t child;
+        fflush(stdout);
+        child = fork();
+        if (child == 0)
+        {
+            myCQ = CachedQueue_Create("queuecrash.dat", 0);
+            for (j = 0; j < CACHED_TEST_COUNT; j++)
+                myCQ->vtbl->insert(myCQ, j);
+            for (j = 0; j < CACHED_TEST_COUNT / 4; j++)
+                myCQ->vtbl->remove(myCQ);
+            _exit(0); /* "crash": no CachedQueue_Destroy() */
+        }
+        waitpid(child, NULL, 0);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        myCQ = CachedQueue_Create("queuecrash.dat", 1);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        printf("Recovered cached queue: %d elements in %.3f ms\n", myCQ->vtbl->getSize(myCQ),
+               (stop.tv_sec - start.tv_sec) * 1e3 + (stop.tv_nsec - start.tv_nsec) / 1e6);
+        k = myCQ->vtbl->remove(myCQ);
+        for (j = 1; !myCQ->vtbl->isEmpty(myCQ) && myCQ->vtbl->remove(myCQ) == k + j; j++)
+            ;
+        printf("Recovered cached queue: removed %d elements in order from %d on, size =%d\n",
+               j, k, myCQ->vtbl->getSize(myCQ));
+        CachedQueue_Destroy(myCQ);
+    }
+
+    /* test SPSC queue: one producer thread, this thread consumes */
+    {
+        pthread_t producer;
+        struct timespec start, stop;
+        double seconds;
+        int errors = 0;
+
+        myQ = Queue_CreateSPSCWithCapacity(SPSC_TEST_CAPACITY);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        pthread_create(&producer, NULL, spscProducer, myQ);
+        for (j = 0; j < SPSC_TEST_COUNT; j++)
+        {
+            while (Queue_isEmptySPSC(myQ))
+                sched_yield(); /* wait for the producer */
+            k = Queue_removeSPSC(myQ);
+            if (k != j)
+                ++errors;
+        }
+        pthread_join(producer, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+        printf("SPSC: moved %d elements in %.3f s (%.1f Mops/s), %d out of order\n",
+               SPSC_TEST_COUNT, seconds, SPSC_TEST_COUNT / seconds / 1e6, errors);
+        Queue_Destroy(myQ);
+    }
+
+    /* test blocking SPSC operations: the same run, then a consumer that
+       waits for a slow producer, which should cost next to no CPU time */
+    {
+        pthread_t producer;
+        struct timespec start, stop, cpuStart, cpuStop;
+        double seconds, cpu;
+        int errors = 0, timedOut;
+
+        myQ = Queue_CreateSPSCWithCapacity(SPSC_TEST_CAPACITY);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        pthread_create(&producer, NULL, spscProducerWait, myQ);
+        for (j = 0; j < SPSC_TEST_COUNT; j++)
+        {
+            Queue_removeWait(myQ, &k, -1);
+            if (k != j)
+                ++errors;
+        }
+        pthread_join(producer, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+        printf("SPSC wait: moved %d elements in %.3f s (%.1f Mops/s), %d out of order\n",
+               SPSC_TEST_COUNT, seconds, SPSC_TEST_COUNT / seconds / 1e6, errors);
+
+        timedOut = !Queue_removeWait(myQ, &k, 10);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpuStart);
+        pthread_create(&producer, NULL, lateProducer, myQ);
+        Queue_removeWait(myQ, &k, 1000);
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpuStop);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        pthread_join(producer, NULL);
+        seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+        cpu = (cpuStop.tv_sec - cpuStart.tv_sec) + (cpuStop.tv_nsec - cpuStart.tv_nsec) / 1e9;
+        printf("SPSC wait: %s on an empty queue, got %d after %.1f ms using %.2f ms CPU\n",
+               timedOut ? "timed out" : "DID NOT TIME OUT", k, seconds * 1e3, cpu * 1e3);
+        Queue_Destroy(myQ);
+    }
     puts("Queue test program");
-    
+
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
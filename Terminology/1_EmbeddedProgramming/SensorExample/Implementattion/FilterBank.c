@@ -0,0 +1,144 @@
+#define _POSIX_C_SOURCE 200809L
+#include "FilterBank.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* the arrays are aligned to, and padded to a multiple of, the widest
+   vector (64 bytes, 16 floats) */
+#define FILTERBANK_ALIGN 64
+#define FILTERBANK_LANES (FILTERBANK_ALIGN / (int) sizeof(float))
+
+static float* FilterBank_array(int stride, float fill) {
+    void* block;
+    float* p;
+    int j;
+    if (posix_memalign(&block, FILTERBANK_ALIGN, (size_t) stride * sizeof(float)) != 0) {
+        return NULL;
+    }
+    p = (float*) block;
+    for (j = 0; j < stride; j++) {
+        p[j] = fill;
+    }
+    return p;
+}
+
+int FilterBank_Init(FilterBank* const me, int channels) {
+    me->channels = channels;
+    me->stride = (channels + FILTERBANK_LANES - 1) / FILTERBANK_LANES * FILTERBANK_LANES;
+    /* pass-through: y = x */
+    me->b0 = FilterBank_array(me->stride, 1.0f);
+    me->b1 = FilterBank_array(me->stride, 0.0f);
+    me->b2 = FilterBank_array(me->stride, 0.0f);
+    me->a1 = FilterBank_array(me->stride, 0.0f);
+    me->a2 = FilterBank_array(me->stride, 0.0f);
+    me->z1 = FilterBank_array(me->stride, 0.0f);
+    me->z2 = FilterBank_array(me->stride, 0.0f);
+    return me->b0 != NULL && me->b1 != NULL && me->b2 != NULL && me->a1 != NULL &&
+           me->a2 != NULL && me->z1 != NULL && me->z2 != NULL;
+}
+
+void FilterBank_Cleanup(FilterBank* const me) {
+    free(me->b0);
+    free(me->b1);
+    free(me->b2);
+    free(me->a1);
+    free(me->a2);
+    free(me->z1);
+    free(me->z2);
+}
+
+/* coefficients from the bilinear transform of the analog Butterworth
+   prototype, normalized so that a0 = 1 */
+void FilterBank_configure(FilterBank* const me, int channel, double cutoffHz, double sampleHz) {
+    const double pi = 3.14159265358979323846;
+    double w0, cosw0, alpha, a0;
+    if (cutoffHz <= 0.0 || sampleHz <= 0.0 || cutoffHz >= sampleHz / 2.0) {
+        me->b0[channel] = 1.0f;
+        me->b1[channel] = me->b2[channel] = me->a1[channel] = me->a2[channel] = 0.0f;
+        return;
+    }
+    w0 = 2.0 * pi * cutoffHz / sampleHz;
+    cosw0 = cos(w0);
+    alpha = sin(w0) / (2.0 * 0.70710678118654752);
+    a0 = 1.0 + alpha;
+    me->b0[channel] = (float) ((1.0 - cosw0) / 2.0 / a0);
+    me->b1[channel] = (float) ((1.0 - cosw0) / a0);
+    me->b2[channel] = me->b0[channel];
+    me->a1[channel] = (float) (-2.0 * cosw0 / a0);
+    me->a2[channel] = (float) ((1.0 - alpha) / a0);
+}
+
+void FilterBank_prime(FilterBank* const me, int channel, float x) {
+    /* at rest y = x (unity gain at DC), so the state equations give */
+    me->z1[channel] = x - me->b0[channel] * x;
+    me->z2[channel] = me->b2[channel] * x - me->a2[channel] * x;
+}
+
+/* process algorithm
+   one sample of every channel per pass, FILTERBANK_VECTOR channels at a
+   time with GCC/Clang vector types (one SIMD register wide with AVX, two
+   SSE registers otherwise), then the channels left over one by one.
+   The coefficient and state arrays are aligned and padded, so they are
+   loaded whole; in and out may have any alignment. */
+#define FILTERBANK_VECTOR 8
+typedef float FilterBankVector __attribute__((vector_size(FILTERBANK_VECTOR * sizeof(float))));
+
+static void FilterBank_pass(FilterBank* const me, const float* in, float* out) {
+    int j, n = me->channels;
+    FilterBankVector x, y, z1;
+    float xs, ys;
+    for (j = 0; j + FILTERBANK_VECTOR <= n; j += FILTERBANK_VECTOR) {
+        FilterBankVector* b0 = (FilterBankVector*) &me->b0[j];
+        FilterBankVector* b1 = (FilterBankVector*) &me->b1[j];
+        FilterBankVector* b2 = (FilterBankVector*) &me->b2[j];
+        FilterBankVector* a1 = (FilterBankVector*) &me->a1[j];
+        FilterBankVector* a2 = (FilterBankVector*) &me->a2[j];
+        FilterBankVector* pz1 = (FilterBankVector*) &me->z1[j];
+        FilterBankVector* pz2 = (FilterBankVector*) &me->z2[j];
+        memcpy(&x, in + j, sizeof(x));
+        z1 = *pz1;
+        y = *b0 * x + z1;
+        *pz1 = *b1 * x - *a1 * y + *pz2;
+        *pz2 = *b2 * x - *a2 * y;
+        memcpy(out + j, &y, sizeof(y));
+    }
+    for (; j < n; j++) {
+        xs = in[j];
+        ys = me->b0[j] * xs + me->z1[j];
+        me->z1[j] = me->b1[j] * xs - me->a1[j] * ys + me->z2[j];
+        me->z2[j] = me->b2[j] * xs - me->a2[j] * ys;
+        out[j] = ys;
+    }
+}
+
+void FilterBank_process(FilterBank* const me, const float* in, float* out) {
+    FilterBank_pass(me, in, out);
+}
+
+void FilterBank_processBlock(FilterBank* const me, const float* in, float* out, int frames) {
+    int f;
+    for (f = 0; f < frames; f++) {
+        FilterBank_pass(me, in + (size_t) f * me->channels, out + (size_t) f * me->channels);
+    }
+}
+
+FilterBank* FilterBank_Create(int channels) {
+    FilterBank* me;
+    if (channels < 1) {
+        return NULL;
+    }
+    me = (FilterBank*) malloc(sizeof(FilterBank));
+    if (me != NULL && !FilterBank_Init(me, channels)) {
+        FilterBank_Destroy(me);
+        me = NULL;
+    }
+    return me;
+}
+
+void FilterBank_Destroy(FilterBank* const me) {
+    if (me != NULL) {
+        FilterBank_Cleanup(me);
+    }
+    free(me);
+}
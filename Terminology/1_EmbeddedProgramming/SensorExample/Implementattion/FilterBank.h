@@ -0,0 +1,57 @@
+#ifndef FilterBank_H
+
+#define FilterBank_H
+
+/*## class FilterBank */
+/* Second-order low-pass (biquad) filters for many channels, run as one
+   bank: each coefficient and each state variable is an array with one
+   entry per channel, so a pass computes one sample of every channel
+   with a loop that has no dependence between channels and runs on
+   several channels per SIMD instruction.
+
+   Each channel is a Butterworth low-pass (Q = 1/sqrt(2)) in transposed
+   direct form II:
+
+       y  = b0 x + z1
+       z1 = b1 x - a1 y + z2
+       z2 = b2 x - a2 y */
+typedef struct FilterBank FilterBank;
+struct FilterBank {
+    int channels;
+    int stride;  /* floats per array, channels rounded up to a vector */
+    float* b0;
+    float* b1;
+    float* b2;
+    float* a1;
+    float* a2;
+    float* z1;
+    float* z2;
+};
+
+int FilterBank_Init(FilterBank* const me, int channels);
+void FilterBank_Cleanup(FilterBank* const me);
+
+/* sets channel to a low-pass at cutoffHz for samples taken at
+   sampleHz; a cutoff that is not between 0 and half the sample rate
+   makes the channel pass its input through unchanged */
+void FilterBank_configure(FilterBank* const me, int channel, double cutoffHz, double sampleHz);
+
+/* sets channel's state as if it had been fed x for ever, so it starts
+   without a transient */
+void FilterBank_prime(FilterBank* const me, int channel, float x);
+
+/* filters one sample of every channel: in and out hold one value per
+   channel (and may be the same array) */
+void FilterBank_process(FilterBank* const me, const float* in, float* out);
+
+/* filters frames samples of every channel, frame after frame: in and out
+   hold frames * channels values, channel fastest */
+void FilterBank_processBlock(FilterBank* const me, const float* in, float* out, int frames);
+
+/* room for channels channels, all passing their input through; NULL if
+   channels < 1 or out of memory */
+FilterBank* FilterBank_Create(int channels);
+
+void FilterBank_Destroy(FilterBank* const me);
+
+#endif
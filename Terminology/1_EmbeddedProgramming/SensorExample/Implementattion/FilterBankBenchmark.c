@@ -0,0 +1,168 @@
+#define _POSIX_C_SOURCE 200809L
+#include "FilterBank.h"
+#include "SensorArray.h"
+#include "SensorDevice.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+/* Low-pass filters thousands of sensor channels two ways:
+
+   Biquad objects      one filter object per sensor (coefficients and
+                       state together), filtered one after the other
+   FilterBank          every coefficient and state variable as an array,
+                       all channels filtered in one vector pass
+
+   Each channel gets its own cutoff, so no two filters are alike, and
+   the two outputs must agree sample for sample. A SensorArray with the
+   filter enabled then checks that a step in every reading settles to
+   the new value, each sensor following it as a filter designed for the
+   rate acquireAll() runs at, whatever its own updateFrequency. */
+
+#define CHANNELS 4096
+#define FRAMES 256
+#define SAMPLE_HZ 1000.0
+#define DEVICE_FILE "filter_device.bin"
+#define ARRAY_HZ 100.0
+
+/* the object-per-sensor filter, as a Sensor would hold it */
+typedef struct Biquad Biquad;
+struct Biquad {
+    float b0, b1, b2, a1, a2;
+    float z1, z2;
+};
+
+static float Biquad_process(Biquad* const me, float x) {
+    float y = me->b0 * x + me->z1;
+    me->z1 = me->b1 * x - me->a1 * y + me->z2;
+    me->z2 = me->b2 * x - me->a2 * y;
+    return y;
+}
+
+static double cutoffOf(int channel) {
+    return 5.0 + (channel % 97) * 4.0; /* 5 .. 389 Hz */
+}
+
+static double nsPerSample(const struct timespec* start, const struct timespec* stop) {
+    return ((stop->tv_sec - start->tv_sec) * 1e9 + (stop->tv_nsec - start->tv_nsec)) /
+           ((double)FRAMES * CHANNELS);
+}
+
+/* a step in every reading, acquired at ARRAY_HZ from sensors of mixed
+   updateFrequency; 0 if any filtered value strays from a filter with the
+   sensor's cutoff at ARRAY_HZ, or does not settle to the step */
+static int stepSettles(void) {
+    static const int updateHz[] = {10, 100, 1000};
+    SensorDevice* device = SensorDevice_Create(DEVICE_FILE, 64);
+    FilterBank* reference = FilterBank_Create(64);
+    SensorArray* array = NULL;
+    float x[64], y[64];
+    int j, r, ok = 1;
+    if (device == NULL || reference == NULL) {
+        FilterBank_Destroy(reference);
+        SensorDevice_Destroy(device);
+        return 0;
+    }
+    array = SensorArray_Create(64, device);
+    if (array == NULL || !SensorArray_enableFilter(array, ARRAY_HZ)) {
+        SensorArray_Destroy(array);
+        FilterBank_Destroy(reference);
+        SensorDevice_Destroy(device);
+        return 0;
+    }
+    for (j = 0; j < 64; j++) {
+        SensorArray_add(array, j % 2 ? PORTMAPPED : MEMORYMAPPED, j);
+        SensorArray_setUpdateFrequency(array, j, updateHz[j % 3]);
+        SensorArray_setFilterFrequency(array, j, 5 + j % 10);
+        FilterBank_configure(reference, j, 5 + j % 10, ARRAY_HZ);
+        FilterBank_prime(reference, j, 100.0f);
+        device->data[j] = device->ports[j] = 100;
+        x[j] = 1100.0f;
+    }
+    /* primed: the first output is the first reading */
+    SensorArray_acquireAll(array);
+    for (j = 0; j < 64; j++) {
+        ok = ok && fabsf(SensorArray_getFilteredValue(array, j) - 100.0f) < 0.01f;
+    }
+    for (j = 0; j < 64; j++) {
+        device->data[j] = device->ports[j] = 1100;
+    }
+    for (r = 0; r < 200; r++) {
+        SensorArray_acquireAll(array);
+        FilterBank_process(reference, x, y);
+        for (j = 0; j < 64; j++) {
+            ok = ok && fabsf(SensorArray_getFilteredValue(array, j) - y[j]) < 0.01f;
+        }
+    }
+    for (j = 0; j < 64; j++) {
+        ok = ok && fabsf(SensorArray_getFilteredValue(array, j) - 1100.0f) < 0.5f;
+    }
+    SensorArray_Destroy(array);
+    FilterBank_Destroy(reference);
+    SensorDevice_Destroy(device);
+    return ok;
+}
+
+int main(void) {
+    FilterBank* bank = FilterBank_Create(CHANNELS);
+    Biquad* biquads = (Biquad*) malloc(CHANNELS * sizeof(Biquad));
+    float* in = (float*) malloc((size_t)FRAMES * CHANNELS * sizeof(float));
+    float* out = (float*) malloc((size_t)FRAMES * CHANNELS * sizeof(float));
+    float* expected = (float*) malloc((size_t)FRAMES * CHANNELS * sizeof(float));
+    struct timespec start, stop;
+    double worst = 0.0, diff;
+    int j, f;
+
+    if (bank == NULL || biquads == NULL || in == NULL || out == NULL || expected == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    }
+    for (j = 0; j < CHANNELS; j++) {
+        FilterBank_configure(bank, j, cutoffOf(j), SAMPLE_HZ);
+        biquads[j].b0 = bank->b0[j];
+        biquads[j].b1 = bank->b1[j];
+        biquads[j].b2 = bank->b2[j];
+        biquads[j].a1 = bank->a1[j];
+        biquads[j].a2 = bank->a2[j];
+        biquads[j].z1 = biquads[j].z2 = 0.0f;
+    }
+    /* a noisy reading around a different level on every channel */
+    srand(1);
+    for (f = 0; f < FRAMES; f++) {
+        for (j = 0; j < CHANNELS; j++) {
+            in[(size_t)f * CHANNELS + j] = (float) (j % 1000) + (float) (rand() % 200 - 100);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (f = 0; f < FRAMES; f++) {
+        for (j = 0; j < CHANNELS; j++) {
+            expected[(size_t)f * CHANNELS + j] =
+                Biquad_process(&biquads[j], in[(size_t)f * CHANNELS + j]);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    printf("%-16s %7.2f ns per sample\n", "Biquad objects", nsPerSample(&start, &stop));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    FilterBank_processBlock(bank, in, out, FRAMES);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    printf("%-16s %7.2f ns per sample\n", "FilterBank", nsPerSample(&start, &stop));
+
+    for (j = 0; j < FRAMES * CHANNELS; j++) {
+        diff = fabs((double)out[j] - expected[j]);
+        if (diff > worst) {
+            worst = diff;
+        }
+    }
+    printf("%d channels x %d frames, largest difference %g\n", CHANNELS, FRAMES, worst);
+    printf("SensorArray filter step response: %s\n", stepSettles() ? "settled" : "WRONG");
+
+    free(in);
+    free(out);
+    free(expected);
+    free(biquads);
+    FilterBank_Destroy(bank);
+    return 0;
+}
@@ -1,8 +1,6 @@
 #include "Sensor.h"
 #include <stdlib.h>
 #include <stddef.h>
-#define MEMORYMAPPED 1
-#define PORTMAPPED 2
 #define WRITEMASK 0x01 /* Example command to force a read */
 
 void Sensor_Init(Sensor* const me) {
@@ -2,12 +2,20 @@
 
 #define Sensor_H
 
-/*## class Sensor */
+/* kinds of sensor interface */
+#define MEMORYMAPPED 1
+#define PORTMAPPED 2
 
+/*## class Sensor */
+/* A single sensor read by acquireValue(). Its value is the raw reading:
+   filterFrequency is kept as a setting only, and nothing here filters
+   with it. The low-pass at filterFrequency is run by SensorArray (see
+   SensorArray_enableFilter()), which filters all its sensors in one
+   FilterBank pass. */
 typedef struct Sensor Sensor;
 struct Sensor
 {
-    int filterFrequency;
+    int filterFrequency; /* low-pass cutoff in Hz, used by SensorArray only */
     int updateFrequency;
     int value;
     
@@ -26,6 +34,7 @@ int Sensor_getUpdateFrequency(const Sensor *const me);
 
 void Sensor_setUpdateFrequency(Sensor *const me, int p_updateFrequency);
 
+/* the last raw reading, unfiltered */
 int Sensor_getValue(const Sensor *const me);
 
 Sensor *Sensor_Create(void);
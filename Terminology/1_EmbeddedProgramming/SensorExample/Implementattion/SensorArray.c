@@ -0,0 +1,220 @@
+#include "SensorArray.h"
+#include <stdlib.h>
+
+static int SensorGroup_Init(SensorGroup* const me, int capacity) {
+    me->count = 0;
+    me->sensor = (int*) malloc((size_t)capacity * sizeof(int));
+    me->reg = (int*) malloc((size_t)capacity * sizeof(int));
+    return me->sensor != NULL && me->reg != NULL;
+}
+
+static void SensorGroup_Cleanup(SensorGroup* const me) {
+    free(me->sensor);
+    free(me->reg);
+}
+
+int SensorArray_Init(SensorArray* const me, int capacity, SensorDevice* device) {
+    size_t bytes = (size_t)capacity * sizeof(int);
+    int ok;
+    me->capacity = capacity;
+    me->count = 0;
+    me->itsDevice = device;
+    me->filterFrequency = (int*) calloc(1, bytes);
+    me->updateFrequency = (int*) calloc(1, bytes);
+    me->value = (int*) calloc(1, bytes);
+    me->whatKindOfInterface = (int*) calloc(1, bytes);
+    me->reg = (int*) calloc(1, bytes);
+    me->itsFilterBank = NULL;
+    me->raw = NULL;
+    me->filtered = NULL;
+    me->primed = 0;
+    me->sampleHz = 0.0;
+    ok = SensorGroup_Init(&me->memoryMapped, capacity);
+    ok = SensorGroup_Init(&me->portMapped, capacity) && ok;
+    return ok && me->filterFrequency != NULL && me->updateFrequency != NULL &&
+           me->value != NULL && me->whatKindOfInterface != NULL && me->reg != NULL;
+}
+
+void SensorArray_Cleanup(SensorArray* const me) {
+    free(me->filterFrequency);
+    free(me->updateFrequency);
+    free(me->value);
+    free(me->whatKindOfInterface);
+    free(me->reg);
+    FilterBank_Destroy(me->itsFilterBank);
+    free(me->raw);
+    free(me->filtered);
+    SensorGroup_Cleanup(&me->memoryMapped);
+    SensorGroup_Cleanup(&me->portMapped);
+}
+
+int SensorArray_add(SensorArray* const me, int whatKindOfInterface, int reg) {
+    SensorGroup* group;
+    int sensor = me->count;
+    switch (whatKindOfInterface) {
+    case MEMORYMAPPED:
+        group = &me->memoryMapped;
+        break;
+    case PORTMAPPED:
+        group = &me->portMapped;
+        break;
+    default:
+        return -1;
+    }
+    if (sensor == me->capacity || reg < 0 || reg >= me->itsDevice->registers) {
+        return -1;
+    }
+    me->filterFrequency[sensor] = 0;
+    me->updateFrequency[sensor] = 0;
+    me->value[sensor] = 0;
+    me->whatKindOfInterface[sensor] = whatKindOfInterface;
+    me->reg[sensor] = reg;
+    if (me->itsFilterBank != NULL) {
+        FilterBank_configure(me->itsFilterBank, sensor, 0.0, 0.0);
+    }
+    group->sensor[group->count] = sensor;
+    group->reg[group->count] = reg;
+    group->count++;
+    return me->count++;
+}
+
+/* acquire algorithm (memory-mapped)
+   one pass writes the command to every sensor, so they all take their
+   readings during the same settle time, then a second pass collects the
+   data registers */
+static void SensorArray_acquireMemoryMapped(SensorArray* const me) {
+    const SensorGroup* group = &me->memoryMapped;
+    volatile int* command = me->itsDevice->command;
+    volatile int* data = me->itsDevice->data;
+    const int* reg = group->reg;
+    const int* sensor = group->sensor;
+    int* value = me->value;
+    int j, n = group->count;
+    if (n == 0) {
+        return;
+    }
+    for (j = 0; j < n; j++) {
+        command[reg[j]] = SENSORDEVICE_READ_COMMAND;
+    }
+    SensorDevice_settle();
+    for (j = 0; j < n; j++) {
+        value[sensor[j]] = data[reg[j]];
+    }
+}
+
+static void SensorArray_acquirePortMapped(SensorArray* const me) {
+    const SensorGroup* group = &me->portMapped;
+    volatile int* ports = me->itsDevice->ports; /* stands in for inp() */
+    const int* reg = group->reg;
+    const int* sensor = group->sensor;
+    int* value = me->value;
+    int j, n = group->count;
+    for (j = 0; j < n; j++) {
+        value[sensor[j]] = ports[reg[j]];
+    }
+}
+
+void SensorArray_acquire(SensorArray* const me, int whatKindOfInterface) {
+    switch (whatKindOfInterface) {
+    case MEMORYMAPPED:
+        SensorArray_acquireMemoryMapped(me);
+        break;
+    case PORTMAPPED:
+        SensorArray_acquirePortMapped(me);
+        break;
+    }
+}
+
+/* filter algorithm
+   a sensor's first reading primes its filter, so the output starts at
+   the reading rather than rising from zero; after that every reading
+   goes through the bank in one pass */
+static void SensorArray_filter(SensorArray* const me) {
+    int j;
+    for (j = 0; j < me->count; j++) {
+        me->raw[j] = (float) me->value[j];
+    }
+    for (; me->primed < me->count; me->primed++) {
+        FilterBank_prime(me->itsFilterBank, me->primed, me->raw[me->primed]);
+    }
+    FilterBank_process(me->itsFilterBank, me->raw, me->filtered);
+}
+
+void SensorArray_acquireAll(SensorArray* const me) {
+    SensorArray_acquireMemoryMapped(me);
+    SensorArray_acquirePortMapped(me);
+    if (me->itsFilterBank != NULL) {
+        SensorArray_filter(me);
+    }
+}
+
+static void SensorArray_configureFilter(SensorArray* const me, int sensor) {
+    if (me->itsFilterBank != NULL) {
+        FilterBank_configure(me->itsFilterBank, sensor, me->filterFrequency[sensor],
+                             me->sampleHz);
+    }
+}
+
+int SensorArray_enableFilter(SensorArray* const me, double sampleHz) {
+    int j;
+    me->sampleHz = sampleHz;
+    if (me->itsFilterBank != NULL) {
+        for (j = 0; j < me->count; j++) {
+            SensorArray_configureFilter(me, j);
+        }
+        return 1;
+    }
+    me->itsFilterBank = FilterBank_Create(me->capacity);
+    me->raw = (float*) calloc((size_t) me->capacity, sizeof(float));
+    me->filtered = (float*) calloc((size_t) me->capacity, sizeof(float));
+    if (me->itsFilterBank == NULL || me->raw == NULL || me->filtered == NULL) {
+        FilterBank_Destroy(me->itsFilterBank);
+        free(me->raw);
+        free(me->filtered);
+        me->itsFilterBank = NULL;
+        me->raw = me->filtered = NULL;
+        return 0;
+    }
+    for (j = 0; j < me->count; j++) {
+        SensorArray_configureFilter(me, j);
+    }
+    me->primed = 0;
+    return 1;
+}
+
+int SensorArray_getFilterFrequency(const SensorArray* const me, int sensor) {
+    return me->filterFrequency[sensor];
+}
+
+void SensorArray_setFilterFrequency(SensorArray* const me, int sensor, int p_filterFrequency) {
+    me->filterFrequency[sensor] = p_filterFrequency;
+    SensorArray_configureFilter(me, sensor);
+}
+
+int SensorArray_getUpdateFrequency(const SensorArray* const me, int sensor) {
+    return me->updateFrequency[sensor];
+}
+
+void SensorArray_setUpdateFrequency(SensorArray* const me, int sensor, int p_updateFrequency) {
+    me->updateFrequency[sensor] = p_updateFrequency;
+}
+
+SensorArray* SensorArray_Create(int capacity, SensorDevice* device) {
+    SensorArray* me;
+    if (capacity < 1 || device == NULL) {
+        return NULL;
+    }
+    me = (SensorArray*) malloc(sizeof(SensorArray));
+    if (me != NULL && !SensorArray_Init(me, capacity, device)) {
+        SensorArray_Destroy(me);
+        me = NULL;
+    }
+    return me;
+}
+
+void SensorArray_Destroy(SensorArray* const me) {
+    if (me != NULL) {
+        SensorArray_Cleanup(me);
+    }
+    free(me);
+}
@@ -0,0 +1,102 @@
+#ifndef SensorArray_H
+
+#define SensorArray_H
+
+#include "Sensor.h"
+#include "SensorDevice.h"
+#include "FilterBank.h"
+
+/*## class SensorArray */
+/* Many sensors in one object, each attribute of Sensor stored as an
+   array indexed by sensor number (structure of arrays), so a pass over
+   one attribute of every sensor touches only that attribute's memory.
+
+   Sensors of the same interface kind are also listed together, with
+   their register numbers next to each other, so acquireAll() works one
+   kind at a time without a branch per sensor:
+
+       memory-mapped  write the read command to every sensor, settle
+                      once for all of them, then read every data
+                      register
+       port-mapped    read every port
+
+   against Sensor's acquireValue(), which switches on the kind and
+   settles once per sensor.
+
+   With the filter enabled, acquireAll() also runs every reading through
+   a low-pass at the sensor's filterFrequency (see FilterBank), all
+   sensors in one pass. Each call is one sample of every sensor, so the
+   filters are all designed for the one rate at which the caller runs
+   acquireAll(), given to enableFilter(); a sensor's updateFrequency
+   plays no part in it. */
+typedef struct SensorGroup SensorGroup;
+struct SensorGroup {
+    int count;
+    int* sensor;   /* sensor numbers */
+    int* reg;      /* their registers (data register or port) */
+};
+
+typedef struct SensorArray SensorArray;
+struct SensorArray {
+    int capacity;
+    int count;
+    SensorDevice* itsDevice;
+    /* per-sensor attributes */
+    int* filterFrequency;
+    int* updateFrequency;
+    int* value;
+    int* whatKindOfInterface; /* MEMORYMAPPED or PORTMAPPED */
+    int* reg;
+    /* low-pass stage, NULL until enableFilter() */
+    FilterBank* itsFilterBank;
+    float* raw;      /* the readings as filter input */
+    float* filtered; /* the filter output */
+    int primed;      /* sensors whose filter state starts from their first reading */
+    double sampleHz; /* acquireAll() calls a second, the filters' sample rate */
+    /* sensors by kind of interface */
+    SensorGroup memoryMapped;
+    SensorGroup portMapped;
+};
+
+/* Constructors and destructors:*/
+int SensorArray_Init(SensorArray* const me, int capacity, SensorDevice* device);
+void SensorArray_Cleanup(SensorArray* const me);
+
+/* Operations */
+
+/* adds a sensor reading register reg of the device (a port number for
+   PORTMAPPED); returns its sensor number, or -1 if the array is full or
+   reg or whatKindOfInterface is invalid */
+int SensorArray_add(SensorArray* const me, int whatKindOfInterface, int reg);
+
+/* acquires every sensor of one kind of interface */
+void SensorArray_acquire(SensorArray* const me, int whatKindOfInterface);
+
+/* acquires every sensor */
+void SensorArray_acquireAll(SensorArray* const me);
+
+static inline int SensorArray_getValue(const SensorArray* const me, int sensor) {
+    return me->value[sensor];
+}
+
+/* starts filtering the readings of every sensor, for acquireAll() called
+   sampleHz times a second; 0 if out of memory */
+int SensorArray_enableFilter(SensorArray* const me, double sampleHz);
+
+/* the sensor's filtered reading (its last reading if the filter is off) */
+static inline float SensorArray_getFilteredValue(const SensorArray* const me, int sensor) {
+    return me->filtered != NULL ? me->filtered[sensor] : (float) me->value[sensor];
+}
+
+int SensorArray_getFilterFrequency(const SensorArray* const me, int sensor);
+void SensorArray_setFilterFrequency(SensorArray* const me, int sensor, int p_filterFrequency);
+int SensorArray_getUpdateFrequency(const SensorArray* const me, int sensor);
+void SensorArray_setUpdateFrequency(SensorArray* const me, int sensor, int p_updateFrequency);
+
+/* room for capacity sensors on device (which the array does not own);
+   NULL if out of memory */
+SensorArray* SensorArray_Create(int capacity, SensorDevice* device);
+
+void SensorArray_Destroy(SensorArray* const me);
+
+#endif
@@ -0,0 +1,108 @@
+#define _POSIX_C_SOURCE 200809L
+#include "Sensor.h"
+#include "SensorArray.h"
+#include "SensorDevice.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Acquires every sensor of a board three ways, on the simulated device:
+
+   Sensor objects      acquireValue() per sensor, as written: its wait
+                       loop is empty, so the compiler drops it
+   Sensor + settle     acquireValue() with the settle time it means to
+                       wait, once per sensor
+   SensorArray         acquireAll(): one pass per kind of interface and
+                       one settle time for all memory-mapped sensors
+
+   Half the sensors are memory-mapped and half port-mapped, interleaved
+   as they would be on a board. Sensor reads its port number in place of
+   inp(), where SensorArray reads the simulated port, so the checksums
+   differ. */
+
+#define SENSORS 512
+#define ROUNDS 2000
+#define DEVICE_FILE "sensor_device.bin"
+
+static double nsPerSensor(const struct timespec* start, const struct timespec* stop) {
+    return ((stop->tv_sec - start->tv_sec) * 1e9 + (stop->tv_nsec - start->tv_nsec)) /
+           ((double)ROUNDS * SENSORS);
+}
+
+int main(void) {
+    SensorDevice* device = SensorDevice_Create(DEVICE_FILE, SENSORS);
+    SensorArray* array;
+    Sensor* sensors[SENSORS];
+    struct timespec start, stop;
+    long sum;
+    int j, r, errors = 0;
+
+    if (device == NULL) {
+        fprintf(stderr, "cannot map %s\n", DEVICE_FILE);
+        return EXIT_FAILURE;
+    }
+    array = SensorArray_Create(SENSORS, device);
+    for (j = 0; j < SENSORS; j++) {
+        sensors[j] = Sensor_Create();
+        sensors[j]->whatKindOfInterface = j % 2 ? PORTMAPPED : MEMORYMAPPED;
+        sensors[j]->WRITEADDR = (int*) &device->command[j];
+        sensors[j]->READADDR = (int*) &device->data[j];
+        sensors[j]->SENSORPORT = j;
+        SensorArray_add(array, sensors[j]->whatKindOfInterface, j);
+    }
+    SensorDevice_simulate(device, 7);
+
+    /* the batch reads what the hardware latched */
+    SensorArray_acquireAll(array);
+    for (j = 0; j < SENSORS; j++) {
+        int expected = j % 2 ? device->ports[j] : device->data[j];
+        if (SensorArray_getValue(array, j) != expected) {
+            errors++;
+        }
+    }
+    printf("SensorArray: %d sensors, %d wrong values\n", SENSORS, errors);
+
+    sum = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (r = 0; r < ROUNDS; r++) {
+        for (j = 0; j < SENSORS; j++) {
+            sum += acquireValue(sensors[j]);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    printf("%-16s %7.2f ns per sensor (checksum %ld)\n", "Sensor objects",
+           nsPerSensor(&start, &stop), sum);
+
+    sum = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (r = 0; r < ROUNDS; r++) {
+        for (j = 0; j < SENSORS; j++) {
+            if (sensors[j]->whatKindOfInterface == MEMORYMAPPED) {
+                SensorDevice_settle();
+            }
+            sum += acquireValue(sensors[j]);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    printf("%-16s %7.2f ns per sensor (checksum %ld)\n", "Sensor + settle",
+           nsPerSensor(&start, &stop), sum);
+
+    sum = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (r = 0; r < ROUNDS; r++) {
+        SensorArray_acquireAll(array);
+        for (j = 0; j < SENSORS; j++) {
+            sum += SensorArray_getValue(array, j);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    printf("%-16s %7.2f ns per sensor (checksum %ld)\n", "SensorArray",
+           nsPerSensor(&start, &stop), sum);
+
+    for (j = 0; j < SENSORS; j++) {
+        Sensor_Destroy(sensors[j]);
+    }
+    SensorArray_Destroy(array);
+    SensorDevice_Destroy(device);
+    return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
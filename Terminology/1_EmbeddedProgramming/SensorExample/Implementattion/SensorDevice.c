@@ -0,0 +1,86 @@
+#define _POSIX_C_SOURCE 200809L
+#include "SensorDevice.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+void SensorDevice_Init(SensorDevice* const me) {
+    me->filename[0] = '\0';
+    me->fd = -1;
+    me->registers = 0;
+    me->size = 0;
+    me->map = MAP_FAILED;
+    me->command = NULL;
+    me->data = NULL;
+    me->ports = NULL;
+}
+
+void SensorDevice_Cleanup(SensorDevice* const me) {
+    if (me->map != MAP_FAILED) {
+        munmap(me->map, me->size);
+    }
+    if (me->fd >= 0) {
+        close(me->fd);
+        unlink(me->filename);
+    }
+}
+
+void SensorDevice_settle(void) {
+    volatile int j;
+    for (j = 0; j < SENSORDEVICE_SETTLE; j++) { /* wait loop */ };
+}
+
+void SensorDevice_simulate(SensorDevice* const me, int tick) {
+    int j;
+    for (j = 0; j < me->registers; j++) {
+        me->data[j] = j * 10 + tick;
+        me->ports[j] = -(j * 10 + tick);
+        me->command[j] = 0;
+    }
+}
+
+/* the register arrays are laid out back to back, each starting on a
+   cache line */
+static size_t SensorDevice_arrayBytes(int registers) {
+    return ((size_t)registers * sizeof(int) + 63) & ~(size_t)63;
+}
+
+SensorDevice* SensorDevice_Create(const char* filename, int registers) {
+    SensorDevice* me;
+    size_t array;
+    if (registers < 1 || strlen(filename) >= sizeof(me->filename)) {
+        return NULL;
+    }
+    me = (SensorDevice*) malloc(sizeof(SensorDevice));
+    if (me == NULL) {
+        return NULL;
+    }
+    SensorDevice_Init(me);
+    strcpy(me->filename, filename);
+    array = SensorDevice_arrayBytes(registers);
+    me->registers = registers;
+    me->size = 3 * array;
+    me->fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (me->fd < 0 || ftruncate(me->fd, (off_t)me->size) != 0) {
+        SensorDevice_Destroy(me);
+        return NULL;
+    }
+    me->map = mmap(NULL, me->size, PROT_READ | PROT_WRITE, MAP_SHARED, me->fd, 0);
+    if (me->map == MAP_FAILED) {
+        SensorDevice_Destroy(me);
+        return NULL;
+    }
+    me->command = (volatile int*) me->map;
+    me->data = (volatile int*) ((char*) me->map + array);
+    me->ports = (volatile int*) ((char*) me->map + 2 * array);
+    return me;
+}
+
+void SensorDevice_Destroy(SensorDevice* const me) {
+    if (me != NULL) {
+        SensorDevice_Cleanup(me);
+    }
+    free(me);
+}
@@ -0,0 +1,51 @@
+#ifndef SensorDevice_H
+
+#define SensorDevice_H
+
+#include <stddef.h>
+
+/* command that makes a memory-mapped sensor latch a new reading */
+#define SENSORDEVICE_READ_COMMAND 0x01
+/* iterations of the wait for the sensors to settle after a command */
+#define SENSORDEVICE_SETTLE 100
+
+/*## class SensorDevice */
+/* A simulated bank of sensor hardware: a file mapped into memory, so
+   acquisition code reads and writes it exactly as it would the
+   registers of a real device, without the hardware.
+
+   The file holds three register arrays, one int per sensor:
+       command   written to make a sensor take a reading
+       data      the reading of a memory-mapped sensor
+       ports     the port space read by port-mapped sensors (inp()) */
+typedef struct SensorDevice SensorDevice;
+struct SensorDevice {
+    char filename[80];
+    int fd;
+    int registers;  /* sensors per register array */
+    size_t size;    /* bytes mapped */
+    void* map;
+    volatile int* command;
+    volatile int* data;
+    volatile int* ports;
+};
+
+void SensorDevice_Init(SensorDevice* const me);
+void SensorDevice_Cleanup(SensorDevice* const me);
+
+/* spins for the settle time; the counter is volatile so the compiler
+   keeps the loop */
+void SensorDevice_settle(void);
+
+/* the hardware side: every sensor latches a new reading, derived from
+   its register number and tick */
+void SensorDevice_simulate(SensorDevice* const me, int tick);
+
+/* maps (creating it if needed) filename with room for registers
+   sensors; NULL if the file cannot be created or mapped */
+SensorDevice* SensorDevice_Create(const char* filename, int registers);
+
+/* unmaps and removes the file */
+void SensorDevice_Destroy(SensorDevice* const me);
+
+#endif
@@ -0,0 +1,180 @@
+#include "SensorScheduler.h"
+#include <stdlib.h>
+
+void SensorScheduler_Init(SensorScheduler* const me, int capacity) {
+    int j, k;
+    me->now = 0;
+    me->capacity = capacity;
+    me->count = 0;
+    me->acquire = acquireValue;
+    for (j = 0; j < SENSORSCHEDULER_LEVELS; j++) {
+        for (k = 0; k < SENSORSCHEDULER_SLOTS; k++) {
+            me->slot[j][k] = -1;
+        }
+    }
+    /* every timer starts on the free list */
+    for (j = 0; j < capacity; j++) {
+        me->timer[j].itsSensor = NULL;
+        me->timer[j].next = j + 1 < capacity ? j + 1 : -1;
+    }
+    me->freeList = 0;
+}
+
+void SensorScheduler_Cleanup(SensorScheduler* const me) {
+    (void) me;
+}
+
+/* the list a timer due at expires belongs in: the finest level whose
+   range from now still covers it */
+static int* SensorScheduler_slotFor(SensorScheduler* const me, unsigned int expires) {
+    unsigned int delta = expires - me->now;
+    int level = 0;
+    while (level < SENSORSCHEDULER_LEVELS - 1 &&
+           delta >= 1u << ((level + 1) * SENSORSCHEDULER_SLOT_BITS)) {
+        level++;
+    }
+    return &me->slot[level][(expires >> (level * SENSORSCHEDULER_SLOT_BITS)) &
+                            (SENSORSCHEDULER_SLOTS - 1)];
+}
+
+static void SensorScheduler_link(SensorScheduler* const me, int t) {
+    int* head = SensorScheduler_slotFor(me, me->timer[t].expires);
+    me->timer[t].list = head;
+    me->timer[t].prev = -1;
+    me->timer[t].next = *head;
+    if (*head >= 0) {
+        me->timer[*head].prev = t;
+    }
+    *head = t;
+}
+
+static void SensorScheduler_unlink(SensorScheduler* const me, int t) {
+    SensorTimer* timer = &me->timer[t];
+    if (timer->prev >= 0) {
+        me->timer[timer->prev].next = timer->next;
+    } else {
+        *timer->list = timer->next;
+    }
+    if (timer->next >= 0) {
+        me->timer[timer->next].prev = timer->prev;
+    }
+}
+
+/* interval algorithm
+   a timer is due every TICK_HZ / frequency ticks, which is period whole
+   ticks and remainder / frequency of a tick; like Bresenham's line, the
+   fractions are added up in phase and each time they make a whole tick,
+   that interval is one tick longer. Over frequency intervals the extra
+   ticks come to exactly remainder, so a second is never gained or lost. */
+static unsigned int SensorScheduler_interval(SensorTimer* const timer) {
+    timer->phase += timer->remainder;
+    if (timer->phase >= timer->frequency) {
+        timer->phase -= timer->frequency;
+        return timer->period + 1;
+    }
+    return timer->period;
+}
+
+int SensorScheduler_add(SensorScheduler* const me, Sensor* sensor) {
+    int frequency = Sensor_getUpdateFrequency(sensor);
+    SensorTimer* timer;
+    int t = me->freeList;
+    if (t < 0 || frequency <= 0) {
+        return -1;
+    }
+    timer = &me->timer[t];
+    me->freeList = timer->next;
+    timer->itsSensor = sensor;
+    if ((unsigned int) frequency >= SENSORSCHEDULER_TICK_HZ) {
+        /* as fast as the tick or faster: once per tick */
+        timer->period = 1;
+        timer->remainder = 0;
+        timer->frequency = 1;
+    } else {
+        /* period is at most TICK_HZ, well within the wheel */
+        timer->period = SENSORSCHEDULER_TICK_HZ / (unsigned int) frequency;
+        timer->remainder = SENSORSCHEDULER_TICK_HZ % (unsigned int) frequency;
+        timer->frequency = (unsigned int) frequency;
+    }
+    timer->phase = 0;
+    timer->expires = me->now + SensorScheduler_interval(timer);
+    SensorScheduler_link(me, t);
+    me->count++;
+    return t;
+}
+
+void SensorScheduler_remove(SensorScheduler* const me, int handle) {
+    if (handle < 0 || handle >= me->capacity || me->timer[handle].itsSensor == NULL) {
+        return;
+    }
+    SensorScheduler_unlink(me, handle);
+    me->timer[handle].itsSensor = NULL;
+    me->timer[handle].next = me->freeList;
+    me->freeList = handle;
+    me->count--;
+}
+
+/* moves every timer of a slot to the finer levels; returns the slot's
+   index, which is 0 when the next level up is due to cascade too */
+static int SensorScheduler_cascade(SensorScheduler* const me, int level) {
+    int index = (me->now >> (level * SENSORSCHEDULER_SLOT_BITS)) & (SENSORSCHEDULER_SLOTS - 1);
+    int t = me->slot[level][index];
+    int next;
+    me->slot[level][index] = -1;
+    while (t >= 0) {
+        next = me->timer[t].next;
+        SensorScheduler_link(me, t);
+        t = next;
+    }
+    return index;
+}
+
+/* tick algorithm
+   when level 0 comes round to slot 0, the level 1 slot for the next 64
+   ticks is cascaded (and so on up the levels), then every timer in the
+   level 0 slot of this tick is due: it is acquired and linked again one
+   interval later */
+int SensorScheduler_tick(SensorScheduler* const me) {
+    int level, index, t, next, fired = 0;
+    me->now++;
+    index = me->now & (SENSORSCHEDULER_SLOTS - 1);
+    for (level = 1; index == 0 && level < SENSORSCHEDULER_LEVELS; level++) {
+        index = SensorScheduler_cascade(me, level);
+    }
+    index = me->now & (SENSORSCHEDULER_SLOTS - 1);
+    t = me->slot[0][index];
+    me->slot[0][index] = -1;
+    while (t >= 0) {
+        next = me->timer[t].next;
+        me->acquire(me->timer[t].itsSensor);
+        me->timer[t].expires += SensorScheduler_interval(&me->timer[t]);
+        SensorScheduler_link(me, t);
+        fired++;
+        t = next;
+    }
+    return fired;
+}
+
+void SensorScheduler_setAcquire(SensorScheduler* const me, SensorAcquireFunc acquire) {
+    me->acquire = acquire;
+}
+
+SensorScheduler* SensorScheduler_Create(int capacity) {
+    SensorScheduler* me;
+    if (capacity < 1) {
+        return NULL;
+    }
+    me = (SensorScheduler*) malloc(sizeof(SensorScheduler) +
+                                   (size_t) capacity * sizeof(SensorTimer));
+    if (me != NULL) {
+        SensorScheduler_Init(me, capacity);
+    }
+    return me;
+}
+
+void SensorScheduler_Destroy(SensorScheduler* const me) {
+    if (me != NULL) {
+        SensorScheduler_Cleanup(me);
+    }
+    free(me);
+}
@@ -0,0 +1,80 @@
+#ifndef SensorScheduler_H
+
+#define SensorScheduler_H
+
+#include "Sensor.h"
+
+/* ticks per second; a Sensor's updateFrequency is in acquisitions per
+   second, so it is acquired every SENSORSCHEDULER_TICK_HZ /
+   updateFrequency ticks (at most once a tick). Where the rate does not
+   divide the tick rate, the intervals alternate between the two nearest
+   whole numbers of ticks so that a second still holds exactly
+   updateFrequency acquisitions. */
+#define SENSORSCHEDULER_TICK_HZ 1000
+/* the wheel: 4 levels of 64 slots cover periods of up to 2^24 ticks */
+#define SENSORSCHEDULER_LEVELS 4
+#define SENSORSCHEDULER_SLOT_BITS 6
+#define SENSORSCHEDULER_SLOTS (1 << SENSORSCHEDULER_SLOT_BITS)
+#define SENSORSCHEDULER_MAX_PERIOD ((1u << (SENSORSCHEDULER_LEVELS * SENSORSCHEDULER_SLOT_BITS)) - 1)
+
+/* what the scheduler does with a sensor that is due */
+typedef int (*SensorAcquireFunc)(Sensor* me);
+
+/*## class SensorScheduler */
+/* Acquires each Sensor at its updateFrequency from a hierarchical timing
+   wheel. Level 0 has one slot per tick for the next 64 ticks, level 1
+   one slot per 64 ticks for the next 64 * 64, and so on. A sensor sits
+   in the slot of its next due time at the coarsest level that still
+   tells it apart; when the finer wheel comes round, the slot is spread
+   over the finer levels (cascading). Adding, removing and firing a
+   sensor are O(1), and a tick touches one slot plus the occasional
+   cascade, however many sensors there are.
+   Timers are kept in one array and linked by index, so the scheduler
+   allocates nothing after Create. */
+typedef struct SensorTimer SensorTimer;
+struct SensorTimer {
+    Sensor* itsSensor;  /* NULL while the timer is free */
+    unsigned int period;  /* whole ticks between acquisitions */
+    unsigned int remainder; /* SENSORSCHEDULER_TICK_HZ % frequency */
+    unsigned int frequency;
+    unsigned int phase;   /* remainder carried so far, below frequency */
+    unsigned int expires; /* tick it is next due */
+    int* list; /* head of the slot list it is in */
+    int next;  /* in its slot's list, or the free list */
+    int prev;
+};
+
+typedef struct SensorScheduler SensorScheduler;
+struct SensorScheduler {
+    unsigned int now;  /* ticks so far */
+    int capacity;
+    int count;
+    int freeList;
+    SensorAcquireFunc acquire;
+    int slot[SENSORSCHEDULER_LEVELS][SENSORSCHEDULER_SLOTS]; /* list heads, -1 if empty */
+    SensorTimer timer[];  /* capacity of them */
+};
+
+void SensorScheduler_Init(SensorScheduler* const me, int capacity);
+void SensorScheduler_Cleanup(SensorScheduler* const me);
+
+/* schedules sensor at its updateFrequency, first due one period from
+   now; returns a handle for remove(), or -1 if the scheduler is full or
+   the sensor's updateFrequency is not positive */
+int SensorScheduler_add(SensorScheduler* const me, Sensor* sensor);
+
+/* stops acquiring the sensor of handle */
+void SensorScheduler_remove(SensorScheduler* const me, int handle);
+
+/* advances one tick and acquires the sensors due; returns how many */
+int SensorScheduler_tick(SensorScheduler* const me);
+
+/* replaces acquireValue() as the action taken on a due sensor */
+void SensorScheduler_setAcquire(SensorScheduler* const me, SensorAcquireFunc acquire);
+
+/* room for capacity sensors; NULL if capacity < 1 or out of memory */
+SensorScheduler* SensorScheduler_Create(int capacity);
+
+void SensorScheduler_Destroy(SensorScheduler* const me);
+
+#endif
@@ -0,0 +1,75 @@
+#define _POSIX_C_SOURCE 200809L
+#include "Sensor.h"
+#include "SensorScheduler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* 10000 sensors at mixed update frequencies, run for 10 simulated
+   seconds: every sensor should be acquired updateFrequency times a
+   second, including the rates that do not divide the tick rate, and the
+   cost of a tick should not grow with the number of sensors. */
+
+#define SENSORS 10000
+#define SECONDS 10
+
+static const int frequencies[] = {1, 2, 3, 7, 10, 50, 100, 250, 300, 600, 1000};
+#define KINDS ((int)(sizeof(frequencies) / sizeof(frequencies[0])))
+
+/* counts acquisitions in value instead of reading hardware */
+static int countAcquisition(Sensor* me) {
+    return ++me->value;
+}
+
+int main(void) {
+    SensorScheduler* scheduler = SensorScheduler_Create(SENSORS);
+    Sensor* sensors[SENSORS];
+    struct timespec start, stop;
+    long fired = 0, expected[KINDS] = {0}, got[KINDS] = {0};
+    double ns;
+    int j, k, errors = 0;
+
+    SensorScheduler_setAcquire(scheduler, countAcquisition);
+    for (j = 0; j < SENSORS; j++) {
+        sensors[j] = Sensor_Create();
+        Sensor_setUpdateFrequency(sensors[j], frequencies[j % KINDS]);
+        SensorScheduler_add(scheduler, sensors[j]);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (j = 0; j < SECONDS * SENSORSCHEDULER_TICK_HZ; j++) {
+        fired += SensorScheduler_tick(scheduler);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    ns = (stop.tv_sec - start.tv_sec) * 1e9 + (stop.tv_nsec - start.tv_nsec);
+
+    for (j = 0; j < SENSORS; j++) {
+        k = j % KINDS;
+        expected[k] += (long) SECONDS * frequencies[k];
+        got[k] += Sensor_getValue(sensors[j]);
+        if (Sensor_getValue(sensors[j]) != SECONDS * frequencies[k]) {
+            errors++;
+        }
+    }
+    for (k = 0; k < KINDS; k++) {
+        printf("%5d Hz: %8ld acquisitions, expected %8ld\n", frequencies[k], got[k], expected[k]);
+    }
+    printf("%d sensors, %d ticks: %ld acquisitions, %.0f ns per tick, %.1f ns per acquisition, "
+           "%d sensors off schedule\n",
+           SENSORS, SECONDS * SENSORSCHEDULER_TICK_HZ, fired,
+           ns / (SECONDS * SENSORSCHEDULER_TICK_HZ), ns / fired, errors);
+
+    /* a removed sensor is no longer acquired */
+    SensorScheduler_remove(scheduler, 0);
+    k = Sensor_getValue(sensors[0]);
+    for (j = 0; j < SENSORSCHEDULER_TICK_HZ; j++) {
+        SensorScheduler_tick(scheduler);
+    }
+    printf("removed sensor acquired %d more times\n", Sensor_getValue(sensors[0]) - k);
+
+    for (j = 0; j < SENSORS; j++) {
+        Sensor_Destroy(sensors[j]);
+    }
+    SensorScheduler_Destroy(scheduler);
+    return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
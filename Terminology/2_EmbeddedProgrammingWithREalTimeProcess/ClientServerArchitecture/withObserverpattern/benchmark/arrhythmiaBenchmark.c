@@ -0,0 +1,306 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "ArrythmiaDetector.h"
+
+/* Feeds ArrythmiaDetector beat times, in milliseconds.
+
+   First one patient through a script of rhythms - normal, tachycardia,
+   atrial fibrillation, bradycardia, a premature beat and a pause - which
+   must give the rhythm changes and beat events the script puts in, with
+   the statistics equal at every beat to ones recomputed from the NN
+   intervals in the detector's window.
+
+   Then many patients at once, their beats interleaved as they would be
+   on a shared host, two ways:
+
+   recompute     every beat, the statistics over the window computed again
+   sliding       ArrythmiaDetector: the new interval in, the oldest out */
+
+#define TICKS 1000
+#define PATIENTS 10000
+#define BEATS_PER_PATIENT 1000
+
+/* segments of the script */
+typedef struct Segment {
+    int beats;
+    int rr;      /* mean RR interval, 0 for atrial fibrillation */
+    int jitter;  /* RR varies by up to this either way */
+} Segment;
+
+static const Segment script[] = {
+    {60, 800, 20},   /* normal */
+    {1, 480, 0},     /* a premature beat ... */
+    {1, 1120, 0},    /* ... and its compensatory pause */
+    {40, 800, 20},
+    {60, 450, 10},   /* tachycardia */
+    {40, 800, 20},
+    {80, 0, 0},      /* atrial fibrillation: 350 - 1000 ms at random */
+    {40, 800, 20},
+    {50, 1400, 30},  /* bradycardia */
+    {40, 800, 20},
+    {1, 2200, 0},    /* a pause */
+    {60, 800, 20}
+};
+#define SEGMENTS (int)(sizeof(script) / sizeof(script[0]))
+
+static const ArrythmiaType expectedRhythms[] = {
+    ARRYTHMIA_NORMAL_RHYTHM, ARRYTHMIA_TACHYCARDIA, ARRYTHMIA_NORMAL_RHYTHM, ARRYTHMIA_IRREGULAR_RHYTHM,
+    ARRYTHMIA_NORMAL_RHYTHM, ARRYTHMIA_BRADYCARDIA, ARRYTHMIA_NORMAL_RHYTHM
+};
+#define EXPECTED_RHYTHMS (int)(sizeof(expectedRhythms) / sizeof(expectedRhythms[0]))
+
+static unsigned long seed = 12345;
+
+static int randomBelow(int n) {
+    seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+    return (int)((seed >> 33) % (unsigned long)n);
+}
+
+/* the next RR interval of a segment; a change of rate from the last
+   rhythm is eased in over a few beats, as the sinus node does, but
+   fibrillation starts at once */
+static int nextRR(const Segment* segment, int beat, int previous) {
+    int rr;
+    if (segment->rr == 0) {
+        return 350 + randomBelow(651);
+    }
+    rr = segment->rr + (segment->jitter > 0 ? randomBelow(2 * segment->jitter + 1) - segment->jitter : 0);
+    if (segment->beats > 1 && beat < 6 && previous > 0) {
+        rr = previous + (rr - previous) * (beat + 1) / 6;
+    }
+    return rr;
+}
+
+/* the statistics the hard way */
+typedef struct Naive {
+    long rr[ARRYTHMIADETECTOR_MAX_WINDOW];
+    int first;
+    int count;
+    int window;
+} Naive;
+
+static void Naive_add(Naive* const me, long rr) {
+    if (me->count == me->window) {
+        me->first = (me->first + 1) % me->window;
+        me->count--;
+    }
+    me->rr[(me->first + me->count) % me->window] = rr;
+    me->count++;
+}
+
+/* over the count intervals of a ring from first */
+static void statistics(const long* rr, int first, int count, int window, ArrythmiaEvent* const stats) {
+    double mean = 0.0, var = 0.0, diffs = 0.0, d;
+    int j;
+    for (j = 0; j < count; j++) {
+        mean += rr[(first + j) % window];
+    }
+    mean = count > 0 ? mean / count : 0.0;
+    for (j = 0; j < count; j++) {
+        d = rr[(first + j) % window] - mean;
+        var += d * d;
+    }
+    for (j = 1; j < count; j++) {
+        d = rr[(first + j) % window] - rr[(first + j - 1) % window];
+        diffs += d * d;
+    }
+    stats->beats = count;
+    stats->meanRR = mean;
+    stats->sdnn = count > 1 ? sqrt(var / (count - 1)) : 0.0;
+    stats->rmssd = count > 1 ? sqrt(diffs / (count - 1)) : 0.0;
+    stats->irregularity = mean > 0.0 ? stats->rmssd / mean : 0.0;
+}
+
+static void Naive_statistics(const Naive* const me, ArrythmiaEvent* const stats) {
+    statistics(me->rr, me->first, me->count, me->window, stats);
+}
+
+/* ... and classified the same way */
+static ArrythmiaType Naive_classify(const ArrythmiaEvent* const stats) {
+    if (stats->beats < ARRYTHMIADETECTOR_MIN_BEATS) {
+        return ARRYTHMIA_UNKNOWN;
+    }
+    if (stats->irregularity * 100.0 > ARRYTHMIADETECTOR_IRREGULAR_PERCENT) {
+        return ARRYTHMIA_IRREGULAR_RHYTHM;
+    }
+    if (stats->meanRR > 60.0 * TICKS / ARRYTHMIADETECTOR_BRADYCARDIA_BPM) {
+        return ARRYTHMIA_BRADYCARDIA;
+    }
+    if (stats->meanRR < 60.0 * TICKS / ARRYTHMIADETECTOR_TACHYCARDIA_BPM) {
+        return ARRYTHMIA_TACHYCARDIA;
+    }
+    return ARRYTHMIA_NORMAL_RHYTHM;
+}
+
+static double relativeError(double a, double b) {
+    return fabs(a - b) / (fabs(b) > 1.0 ? fabs(b) : 1.0);
+}
+
+/* the events of the scripted patient */
+static ArrythmiaType rhythms[64];
+static int rhythmCount;
+static long prematureAt, pauseAt;
+static int beatEvents;
+static long events;
+
+static void Script_event(void* clientPtr, const ArrythmiaEvent* event) {
+    (void)clientPtr;
+    printf("  %8.1f s  %-16s RR %4ld  mean %6.1f  SDNN %6.1f  RMSSD %6.1f  irregularity %.3f\n",
+           event->beatTime / (double)TICKS, ArrythmiaDetector_typeName(event->type), event->rr, event->meanRR,
+           event->sdnn, event->rmssd, event->irregularity);
+    if (event->type == ARRYTHMIA_PREMATURE_BEAT || event->type == ARRYTHMIA_PAUSE) {
+        beatEvents++;
+        if (event->type == ARRYTHMIA_PREMATURE_BEAT && prematureAt == 0) {
+            prematureAt = event->beatTime;
+        } else if (event->type == ARRYTHMIA_PAUSE && pauseAt == 0) {
+            pauseAt = event->beatTime;
+        }
+    } else if (rhythmCount < 64) {
+        rhythms[rhythmCount++] = event->type;
+    }
+}
+
+static void Count_event(void* clientPtr, const ArrythmiaEvent* event) {
+    (void)clientPtr;
+    (void)event;
+    events++;
+}
+
+static int runScript(void) {
+    ArrythmiaDetector* detector = ArrythmiaDetector_Create();
+    ArrythmiaEvent fast, slow;
+    double worst = 0.0, e;
+    long t = 0, placedPremature = 0, placedPause = 0;
+    int s, j, rr, base = 0, disagreements = 0, ok = 1;
+
+    ArrythmiaDetector_configure(detector, ARRYTHMIADETECTOR_DEFAULT_WINDOW, TICKS);
+    ArrythmiaDetector_setEventHandler(detector, Script_event, NULL);
+    printf("scripted patient, %d-beat window:\n", ARRYTHMIADETECTOR_DEFAULT_WINDOW);
+    ArrythmiaDetector_detectArrythmia(detector, t);
+    for (s = 0; s < SEGMENTS; s++) {
+        for (j = 0; j < script[s].beats; j++) {
+            rr = nextRR(&script[s], j, base);
+            t += rr;
+            if (script[s].beats == 1 && rr < 800) {
+                placedPremature = t;
+            } else if (script[s].beats == 1 && rr > 2 * 800) {
+                placedPause = t;
+            }
+            if (script[s].beats > 1) {
+                base = rr;
+            }
+            ArrythmiaDetector_detectArrythmia(detector, t);
+
+            ArrythmiaDetector_getStatistics(detector, &fast);
+            statistics(detector->rr, detector->first, detector->count, detector->window, &slow);
+            e = relativeError(fast.meanRR, slow.meanRR);
+            e = fmax(e, relativeError(fast.sdnn, slow.sdnn));
+            e = fmax(e, relativeError(fast.rmssd, slow.rmssd));
+            worst = fmax(worst, e);
+            if (fast.type != Naive_classify(&slow)) {
+                disagreements++;
+            }
+        }
+    }
+
+    if (rhythmCount != EXPECTED_RHYTHMS) {
+        ok = 0;
+    }
+    for (j = 0; ok && j < EXPECTED_RHYTHMS; j++) {
+        ok = rhythms[j] == expectedRhythms[j];
+    }
+    printf("rhythm changes %s the script, ", ok ? "follow" : "DO NOT FOLLOW");
+    if (prematureAt != placedPremature || pauseAt != placedPause) {
+        ok = 0;
+    }
+    printf("premature beat %s, pause %s (%d beat events)\n", prematureAt == placedPremature ? "found" : "MISSED",
+           pauseAt == placedPause ? "found" : "MISSED", beatEvents);
+    printf("statistics against a recompute: largest relative error %.1e, %d rhythm disagreements\n\n", worst,
+           disagreements);
+    ArrythmiaDetector_Destroy(detector);
+    return ok && worst < 1e-9 && disagreements == 0;
+}
+
+static long now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000L + t.tv_nsec;
+}
+
+/* every patient's RR intervals: half in sinus rhythm, half fibrillating */
+static short* makeIntervals(void) {
+    short* rr = (short*)malloc((size_t)PATIENTS * BEATS_PER_PATIENT * sizeof(short));
+    long j;
+    if (rr != NULL) {
+        for (j = 0; j < (long)PATIENTS * BEATS_PER_PATIENT; j++) {
+            rr[j] = (short)((j % PATIENTS) % 2 == 0 ? 780 + randomBelow(41) : 350 + randomBelow(651));
+        }
+    }
+    return rr;
+}
+
+static void runPatients(int window) {
+    ArrythmiaDetector* detectors = (ArrythmiaDetector*)malloc(PATIENTS * sizeof(ArrythmiaDetector));
+    Naive* naive = (Naive*)malloc(PATIENTS * sizeof(Naive));
+    long* t = (long*)calloc(PATIENTS, sizeof(long));
+    short* rr = makeIntervals();
+    ArrythmiaEvent stats;
+    long start, ns, beats = (long)PATIENTS * BEATS_PER_PATIENT, j;
+    int p;
+    volatile double sink = 0.0;
+
+    if (detectors == NULL || naive == NULL || t == NULL || rr == NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (p = 0; p < PATIENTS; p++) {
+        ArrythmiaDetector_Init(&detectors[p]);
+        ArrythmiaDetector_configure(&detectors[p], window, TICKS);
+        ArrythmiaDetector_setEventHandler(&detectors[p], Count_event, NULL);
+        ArrythmiaDetector_detectArrythmia(&detectors[p], 0);
+        naive[p].first = 0;
+        naive[p].count = 0;
+        naive[p].window = window;
+    }
+
+    /* the patients' beats in turn */
+    start = now();
+    for (j = 0; j < beats; j++) {
+        p = (int)(j % PATIENTS);
+        t[p] += rr[j];
+        ArrythmiaDetector_detectArrythmia(&detectors[p], t[p]);
+    }
+    ns = now() - start;
+    printf("%2d-beat window  %-9s %6.1f ns per beat  (%ld events)\n", window, "sliding", (double)ns / beats,
+           events);
+
+    start = now();
+    for (j = 0; j < beats; j++) {
+        p = (int)(j % PATIENTS);
+        Naive_add(&naive[p], rr[j]);
+        Naive_statistics(&naive[p], &stats);
+        sink += Naive_classify(&stats) + stats.irregularity;
+    }
+    ns = now() - start;
+    printf("%2d-beat window  %-9s %6.1f ns per beat\n", window, "recompute", (double)ns / beats);
+
+    for (p = 0; p < PATIENTS; p++) {
+        ArrythmiaDetector_Cleanup(&detectors[p]);
+    }
+    events = 0;
+    free(rr);
+    free(t);
+    free(naive);
+    free(detectors);
+}
+
+int main(void) {
+    int ok = runScript();
+    printf("%d patients, %d beats each, interleaved:\n", PATIENTS, BEATS_PER_PATIENT);
+    runPatients(ARRYTHMIADETECTOR_DEFAULT_WINDOW);
+    runPatients(ARRYTHMIADETECTOR_MAX_WINDOW);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,173 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "TMDQueue.h"
+#include "TMDCursor.h"
+
+/* A producer inserts ECG samples into a TMDQueue read by a fast client
+   (a QRS detector keeping a running sum) and a slow one (a histogram
+   display spending SLOW_WORK loop iterations per sample):
+
+   subscribers   both pushed every sample by notify(), on the
+                 producer's thread
+   cursors       each reads on its own thread through a TMDCursor: the
+                 QRS detector's gates the producer so it loses nothing,
+                 the display's does not and skips what it misses
+
+   The producer's CPU time per sample shows what the clients cost it; the
+   QRS detector must see every sample in both runs. */
+
+#define SAMPLES 2000000L
+#define SLOW_WORK 200
+#define READ_SIZE 256
+
+typedef struct Client Client;
+struct Client {
+    TMDCursor cursor;
+    long sum;
+    long count;
+};
+
+static volatile int sink;
+static int producing; /* set while the producer runs */
+
+static void slowWork(int value) {
+    int j;
+    for (j = 0; j < SLOW_WORK; j++) {
+        sink = value + j;
+    }
+}
+
+static void fastUpdate(void* clientPtr, const struct TimeMarkedData tmd) {
+    Client* me = (Client*)clientPtr;
+    me->sum += tmd.dataValue;
+    me->count++;
+}
+
+static void slowUpdate(void* clientPtr, const struct TimeMarkedData tmd) {
+    Client* me = (Client*)clientPtr;
+    slowWork(tmd.dataValue);
+    me->count++;
+}
+
+/* the QRS detector's thread: works on spans of the queue in place */
+static void* fastReader(void* arg) {
+    Client* me = (Client*)arg;
+    const struct TimeMarkedData* span;
+    int n, j;
+    for (;;) {
+        int more = __atomic_load_n(&producing, __ATOMIC_ACQUIRE);
+        n = TMDCursor_peek(&me->cursor, &span);
+        if (n == 0) {
+            if (!more) {
+                break;
+            }
+            sched_yield();
+            continue;
+        }
+        for (j = 0; j < n; j++) {
+            me->sum += span[j].dataValue;
+        }
+        me->count += n;
+        TMDCursor_consume(&me->cursor, n);
+    }
+    return NULL;
+}
+
+/* the display's thread: copies what it can get and falls behind */
+static void* slowReader(void* arg) {
+    Client* me = (Client*)arg;
+    struct TimeMarkedData tmd[READ_SIZE];
+    int n, j;
+    for (;;) {
+        int more = __atomic_load_n(&producing, __ATOMIC_ACQUIRE);
+        n = TMDCursor_read(&me->cursor, tmd, READ_SIZE);
+        if (n == 0) {
+            if (!more) {
+                break;
+            }
+            sched_yield();
+            continue;
+        }
+        for (j = 0; j < n; j++) {
+            slowWork(tmd[j].dataValue);
+        }
+        me->count += n;
+    }
+    return NULL;
+}
+
+static double elapsedNs(const struct timespec* start, const struct timespec* stop) {
+    return (stop->tv_sec - start->tv_sec) * 1e9 + (stop->tv_nsec - start->tv_nsec);
+}
+
+/* inserts SAMPLES samples; prints the producer's CPU and wall time per sample */
+static long produce(TMDQueue* const queue, const char* name) {
+    struct timespec cpuStart, cpuStop, start, stop;
+    TimeMarkedData tmd;
+    long t, sum = 0;
+    TimeMarkedData_Init(&tmd);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuStart);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (t = 0; t < SAMPLES; t++) {
+        tmd.timeInterval = t;
+        tmd.dataValue = (int)((t * 7919) % 1024);
+        sum += tmd.dataValue;
+        TMDQueue_insert(queue, tmd);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuStop);
+    printf("%-12s producer %7.2f ns CPU, %7.2f ns wall per sample\n", name,
+           elapsedNs(&cpuStart, &cpuStop) / SAMPLES, elapsedNs(&start, &stop) / SAMPLES);
+    return sum;
+}
+
+int main(void) {
+    TMDQueue* queue = TMDQueue_Create();
+    Client qrs = {{0}, 0, 0}, display = {{0}, 0, 0};
+    pthread_t fast, slow;
+    int handles[2], errors = 0;
+    long sum;
+
+    if (queue == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    handles[0] = TMDQueue_subscribe(queue, fastUpdate, &qrs);
+    handles[1] = TMDQueue_subscribe(queue, slowUpdate, &display);
+    sum = produce(queue, "subscribers");
+    TMDQueue_unsubscribe(queue, handles[0]);
+    TMDQueue_unsubscribe(queue, handles[1]);
+    if (qrs.sum != sum || qrs.count != SAMPLES) {
+        errors++;
+    }
+
+    qrs.sum = qrs.count = display.count = 0;
+    TMDCursor_Init(&qrs.cursor);
+    TMDCursor_Init(&display.cursor);
+    TMDQueue_attachCursor(queue, &qrs.cursor, 1);
+    TMDQueue_attachCursor(queue, &display.cursor, 0);
+    __atomic_store_n(&producing, 1, __ATOMIC_RELEASE);
+    pthread_create(&fast, NULL, fastReader, &qrs);
+    pthread_create(&slow, NULL, slowReader, &display);
+    sum = produce(queue, "cursors");
+    __atomic_store_n(&producing, 0, __ATOMIC_RELEASE);
+    pthread_join(fast, NULL);
+    pthread_join(slow, NULL);
+    printf("QRS detector read %ld samples, lost %ld; display read %ld, lost %ld\n",
+           qrs.count, qrs.cursor.lost, display.count, display.cursor.lost);
+    if (qrs.sum != sum || qrs.count != SAMPLES || qrs.cursor.lost != 0 ||
+        display.count + display.cursor.lost != SAMPLES) {
+        errors++;
+    }
+    TMDCursor_Cleanup(&qrs.cursor);
+    TMDCursor_Cleanup(&display.cursor);
+
+    printf("%s\n", errors == 0 ? "QRS detector saw every sample" : "MISMATCH");
+    TMDQueue_Destroy(queue);
+    return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,132 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "TMDQueue.h"
+#include "TMDDispatcher.h"
+
+/* Feeds a TMDQueue at a steady sample rate to four clients that take
+   different times per sample, as the ECG clients would:
+
+   serial       all four subscribed to the queue, called one after the
+                other on the producer's thread
+   dispatched   all four on a TMDDispatcher with WORKERS workers
+
+   Every client checks that it sees the samples in order and measures
+   the latency from the time the sample was due to the end of its own
+   update; the dispatcher also reports its notify latency. */
+
+#define SAMPLES 20000L
+#define PERIOD_NS 50000L /* 20 kHz: 40 channels at 500 Hz */
+#define WORKERS 4
+
+typedef struct Client Client;
+struct Client {
+    const char* name;
+    long work; /* ns per sample */
+    long count;
+    long last; /* timeInterval of the last sample */
+    long outOfOrder;
+    long latencySum;
+    long maxLatency;
+};
+
+static long now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000L + t.tv_nsec;
+}
+
+/* the samples' timeInterval is the time they were due, in ns */
+static void Client_update(void* clientPtr, const struct TimeMarkedData tmd) {
+    Client* me = (Client*)clientPtr;
+    long done, until = now() + me->work;
+    while ((done = now()) < until) {
+        /* analysis */
+    }
+    if (tmd.timeInterval <= me->last) {
+        me->outOfOrder++;
+    }
+    me->last = tmd.timeInterval;
+    me->count++;
+    me->latencySum += done - tmd.timeInterval;
+    if (done - tmd.timeInterval > me->maxLatency) {
+        me->maxLatency = done - tmd.timeInterval;
+    }
+}
+
+static void produce(TMDQueue* const queue) {
+    struct timespec due;
+    TimeMarkedData tmd;
+    long start = now() + 1000000L, t;
+    TimeMarkedData_Init(&tmd);
+    for (t = 0; t < SAMPLES; t++) {
+        tmd.timeInterval = start + t * PERIOD_NS;
+        tmd.dataValue = (int)(t % 1024);
+        due.tv_sec = tmd.timeInterval / 1000000000L;
+        due.tv_nsec = tmd.timeInterval % 1000000000L;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL);
+        TMDQueue_insert(queue, tmd);
+    }
+}
+
+static int report(const char* mode, Client* clients, int n) {
+    int j, errors = 0;
+    for (j = 0; j < n; j++) {
+        printf("%-10s %-18s %5ld ns work: latency mean %8.0f ns, max %9ld ns\n", mode, clients[j].name,
+               clients[j].work, (double)clients[j].latencySum / (clients[j].count ? clients[j].count : 1),
+               clients[j].maxLatency);
+        if (clients[j].count != SAMPLES || clients[j].outOfOrder != 0) {
+            errors++;
+        }
+        clients[j].count = clients[j].last = clients[j].outOfOrder = 0;
+        clients[j].latencySum = clients[j].maxLatency = 0;
+    }
+    return errors;
+}
+
+int main(void) {
+    Client clients[4] = {
+        {"QRSDetector", 4000, 0, 0, 0, 0, 0},
+        {"ArrythmiaDetector", 6000, 0, 0, 0, 0, 0},
+        {"HistogramDisplay", 1500, 0, 0, 0, 0, 0},
+        {"WaveformDisplay", 500, 0, 0, 0, 0, 0},
+    };
+    TMDQueue* queue = TMDQueue_Create();
+    TMDDispatcher* dispatcher = TMDDispatcher_Create(WORKERS);
+    int handles[4], j, errors = 0;
+
+    if (queue == NULL || dispatcher == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    }
+    printf("%ld samples, one every %ld ns\n", SAMPLES, PERIOD_NS);
+
+    for (j = 0; j < 4; j++) {
+        handles[j] = TMDQueue_subscribe(queue, Client_update, &clients[j]);
+    }
+    produce(queue);
+    for (j = 0; j < 4; j++) {
+        TMDQueue_unsubscribe(queue, handles[j]);
+    }
+    errors += report("serial", clients, 4);
+
+    for (j = 0; j < 4; j++) {
+        TMDDispatcher_subscribe(dispatcher, Client_update, &clients[j]);
+    }
+    if (!TMDDispatcher_start(dispatcher, queue)) {
+        fprintf(stderr, "cannot start the workers\n");
+        return EXIT_FAILURE;
+    }
+    produce(queue);
+    TMDDispatcher_stop(dispatcher);
+    errors += report("dispatched", clients, 4);
+    printf("dispatcher: %ld samples, notify latency p50 %ld ns, p99 %ld ns, max %ld ns\n",
+           TMDDispatcher_getNotified(dispatcher), TMDDispatcher_getLatency(dispatcher, 0.5),
+           TMDDispatcher_getLatency(dispatcher, 0.99), TMDDispatcher_getMaxLatency(dispatcher));
+
+    printf("%s\n", errors == 0 ? "every client saw every sample in order" : "MISMATCH");
+    TMDDispatcher_Destroy(dispatcher);
+    TMDQueue_Destroy(queue);
+    return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,143 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include "TMDQueue.h"
+#include "HistogramDisplay.h"
+
+/* Keeps a histogram of the samples in a TMDQueue two ways:
+
+   recount       every sample, count the samples in the queue again, as
+                 updateHistogram() would without anything to go on
+   sliding       HistogramDisplay: the new sample in, the oldest out
+
+   while a renderer thread takes snapshots of the sliding histogram as
+   fast as it can. Every snapshot must add up to the samples it says it
+   holds, and the histogram at the end must equal a recount of the queue. */
+
+#define BINS 256
+#define RECOUNT_SAMPLES 5000L
+#define SLIDING_SAMPLES 4000000L
+
+static unsigned int recount[BINS];
+static int producing = 1;
+static long snapshots, inconsistent;
+
+static int binOf(int dataValue) {
+    return dataValue * BINS / HISTOGRAMDISPLAY_DEFAULT_HIGH;
+}
+
+/* counts the samples in the queue, oldest to newest */
+static void recountQueue(TMDQueue* const queue) {
+    int index;
+    memset(recount, 0, sizeof(recount));
+    for (index = queue->tail; index != queue->head; index = TMDQueue_getNextIndex(queue, index)) {
+        recount[binOf(queue->buffer[index].dataValue)]++;
+    }
+}
+
+static void Recount_update(void* clientPtr, const struct TimeMarkedData tmd) {
+    (void)tmd;
+    recountQueue((TMDQueue*)clientPtr);
+}
+
+static void* render(void* arg) {
+    const HistogramDisplay* histogram = (const HistogramDisplay*)arg;
+    unsigned int counts[BINS];
+    long total;
+    int j, samples;
+    while (__atomic_load_n(&producing, __ATOMIC_ACQUIRE)) {
+        samples = HistogramDisplay_getSnapshot(histogram, counts, BINS);
+        for (j = 0, total = 0; j < BINS; j++) {
+            total += counts[j];
+        }
+        if (total != samples) {
+            inconsistent++;
+        }
+        snapshots++;
+    }
+    return NULL;
+}
+
+static long now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000L + t.tv_nsec;
+}
+
+/* an ECG-like spread of 12-bit samples: mostly baseline, some beats */
+static int sampleAt(long t) {
+    long phase = t % 400;
+    return (int)(2048 + (phase < 20 ? 1500 - 150 * labs(phase - 10) : 0) + (t * 7919) % 101 - 50);
+}
+
+int main(void) {
+    TMDQueue* queue = TMDQueue_Create();
+    HistogramDisplay* histogram = HistogramDisplay_Create();
+    unsigned int counts[BINS];
+    TimeMarkedData tmd;
+    pthread_t renderer;
+    long start, ns, t = 0;
+    int j, handle, samples, mismatches = 0;
+
+    if (queue == NULL || histogram == NULL ||
+        !HistogramDisplay_configure(histogram, BINS, 0, HISTOGRAMDISPLAY_DEFAULT_HIGH, QUEUE_SIZE - 1)) {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    }
+    TimeMarkedData_Init(&tmd);
+    printf("%d bins over the last %d samples\n", BINS, QUEUE_SIZE - 1);
+
+    /* fill the queue first, so that every recount is of a full queue */
+    for (; t < QUEUE_SIZE; t++) {
+        tmd.timeInterval = t;
+        tmd.dataValue = sampleAt(t);
+        TMDQueue_insert(queue, tmd);
+        HistogramDisplay_updateHistogram(histogram, tmd.dataValue);
+    }
+
+    handle = TMDQueue_subscribe(queue, Recount_update, queue);
+    start = now();
+    for (; t < QUEUE_SIZE + RECOUNT_SAMPLES; t++) {
+        tmd.timeInterval = t;
+        tmd.dataValue = sampleAt(t);
+        TMDQueue_insert(queue, tmd);
+        HistogramDisplay_updateHistogram(histogram, tmd.dataValue);
+    }
+    ns = now() - start;
+    TMDQueue_unsubscribe(queue, handle);
+    printf("%-8s %10.1f ns per sample\n", "recount", (double)ns / RECOUNT_SAMPLES);
+
+    HistogramDisplay_setItsTMDQueue(histogram, queue);
+    if (pthread_create(&renderer, NULL, render, histogram) != 0) {
+        fprintf(stderr, "cannot start the renderer\n");
+        return EXIT_FAILURE;
+    }
+    start = now();
+    for (; t < QUEUE_SIZE + RECOUNT_SAMPLES + SLIDING_SAMPLES; t++) {
+        tmd.timeInterval = t;
+        tmd.dataValue = sampleAt(t);
+        TMDQueue_insert(queue, tmd);
+    }
+    ns = now() - start;
+    __atomic_store_n(&producing, 0, __ATOMIC_RELEASE);
+    pthread_join(renderer, NULL);
+    printf("%-8s %10.1f ns per sample, with %ld snapshots taken meanwhile (%ld inconsistent)\n",
+           "sliding", (double)ns / SLIDING_SAMPLES, snapshots, inconsistent);
+
+    recountQueue(queue);
+    samples = HistogramDisplay_getSnapshot(histogram, counts, BINS);
+    for (j = 0; j < BINS; j++) {
+        if (counts[j] != recount[j]) {
+            mismatches++;
+        }
+    }
+    printf("final histogram of %d samples: %s\n", samples,
+           mismatches == 0 && samples == QUEUE_SIZE - 1 ? "equals a recount" : "MISMATCH");
+
+    HistogramDisplay_Destroy(histogram);
+    TMDQueue_Destroy(queue);
+    return mismatches == 0 && inconsistent == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,181 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "TMDQueue.h"
+#include "MultiLeadQueue.h"
+#include "MultiLeadECG.h"
+
+/* Runs a minute of 12-lead ECG for several patients through a simple
+   detector, the slope energy of every lead (the sum of the squared
+   differences between consecutive samples), two ways:
+
+   TMDQueue per lead   every sample inserted into its lead's queue as a
+                       TimeMarkedData and handed to the lead's detector
+   MultiLeadQueue      one queue per patient, the detector handed every
+                       block and going through it lead by lead
+
+   Both are fed the same MultiLeadECG blocks, and must agree. */
+
+#define PATIENTS 8
+#define LEADS 12
+#define BLOCK_FRAMES 50 /* 100 ms */
+#define SECONDS 60
+#define BLOCKS (SECONDS * MULTILEADECG_SAMPLE_HZ / BLOCK_FRAMES)
+
+/* one lead's detector, fed sample by sample */
+typedef struct LeadSlope LeadSlope;
+struct LeadSlope {
+    int primed;
+    int prev;
+    long long energy;
+};
+
+static void LeadSlope_update(void* clientPtr, const struct TimeMarkedData tmd) {
+    LeadSlope* me = (LeadSlope*)clientPtr;
+    int d = me->primed ? tmd.dataValue - me->prev : 0;
+    me->energy += (long long)d * d;
+    me->prev = tmd.dataValue;
+    me->primed = 1;
+}
+
+/* a patient fed through a TMDQueue per lead */
+typedef struct PerLead PerLead;
+struct PerLead {
+    TMDQueue* queue[LEADS];
+    LeadSlope slope[LEADS];
+};
+
+static void PerLead_block(void* clientPtr, const struct LeadBlock* block) {
+    PerLead* me = (PerLead*)clientPtr;
+    TimeMarkedData tmd;
+    int f, j;
+    TimeMarkedData_Init(&tmd);
+    for (f = 0; f < block->frames; f++) {
+        tmd.timeInterval = block->time[f];
+        for (j = 0; j < block->leads; j++) {
+            tmd.dataValue = block->value[j][f];
+            TMDQueue_insert(me->queue[j], tmd);
+        }
+    }
+}
+
+/* every lead's detector, fed a block at a time */
+typedef struct BlockSlope BlockSlope;
+struct BlockSlope {
+    int primed;
+    int prev[MAX_LEADS];
+    long long energy[MAX_LEADS];
+};
+
+static void BlockSlope_update(void* clientPtr, const struct LeadBlock* block) {
+    BlockSlope* me = (BlockSlope*)clientPtr;
+    int j, f, d, sum;
+    for (j = 0; j < block->leads; j++) {
+        const int* x = block->value[j];
+        d = me->primed ? x[0] - me->prev[j] : 0;
+        sum = d * d;
+        for (f = 1; f < block->frames; f++) {
+            d = x[f] - x[f - 1];
+            sum += d * d;
+        }
+        me->energy[j] += sum;
+        me->prev[j] = x[block->frames - 1];
+    }
+    me->primed = 1;
+}
+
+static long now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000L + t.tv_nsec;
+}
+
+int main(void) {
+    static PerLead perLead[PATIENTS];
+    static BlockSlope blockSlope[PATIENTS];
+    MultiLeadQueue* recording[PATIENTS];
+    MultiLeadQueue* queue[PATIENTS];
+    LeadBlock minute[PATIENTS];
+    const int* value[MAX_LEADS];
+    long start, perLeadNs, blockNs;
+    double samples = (double)PATIENTS * LEADS * BLOCKS * BLOCK_FRAMES;
+    int b, p, j, mismatches = 0;
+
+    /* a minute of every patient, recorded first so that only the queues
+       and the detectors are timed */
+    for (p = 0; p < PATIENTS; p++) {
+        MultiLeadECG* source = MultiLeadECG_Create(LEADS, BLOCK_FRAMES);
+        recording[p] = MultiLeadQueue_Create(LEADS, BLOCKS * BLOCK_FRAMES);
+        queue[p] = MultiLeadQueue_Create(LEADS, QUEUE_SIZE);
+        if (source == NULL || recording[p] == NULL || queue[p] == NULL) {
+            fprintf(stderr, "out of memory\n");
+            return EXIT_FAILURE;
+        }
+        MultiLeadECG_setItsMultiLeadQueue(source, recording[p]);
+        for (b = 0; b < BLOCKS; b++) {
+            MultiLeadECG_getDataBlock(source);
+        }
+        MultiLeadECG_Destroy(source);
+        MultiLeadQueue_getBlock(recording[p], 0, BLOCKS * BLOCK_FRAMES, &minute[p]);
+        MultiLeadQueue_subscribe(queue[p], BlockSlope_update, &blockSlope[p]);
+        for (j = 0; j < LEADS; j++) {
+            perLead[p].queue[j] = TMDQueue_Create();
+            if (perLead[p].queue[j] == NULL) {
+                fprintf(stderr, "out of memory\n");
+                return EXIT_FAILURE;
+            }
+            TMDQueue_subscribe(perLead[p].queue[j], LeadSlope_update, &perLead[p].slope[j]);
+        }
+    }
+    printf("%d patients x %d leads, %d s at %d Hz, blocks of %d frames\n", PATIENTS, LEADS,
+           SECONDS, MULTILEADECG_SAMPLE_HZ, BLOCK_FRAMES);
+
+    start = now();
+    for (b = 0; b < BLOCKS; b++) {
+        for (p = 0; p < PATIENTS; p++) {
+            LeadBlock block = minute[p];
+            for (j = 0; j < LEADS; j++) {
+                block.value[j] += b * BLOCK_FRAMES;
+            }
+            block.time += b * BLOCK_FRAMES;
+            block.frames = BLOCK_FRAMES;
+            PerLead_block(&perLead[p], &block);
+        }
+    }
+    perLeadNs = now() - start;
+
+    start = now();
+    for (b = 0; b < BLOCKS; b++) {
+        for (p = 0; p < PATIENTS; p++) {
+            for (j = 0; j < LEADS; j++) {
+                value[j] = minute[p].value[j] + b * BLOCK_FRAMES;
+            }
+            MultiLeadQueue_insert(queue[p], minute[p].time + b * BLOCK_FRAMES, value, BLOCK_FRAMES);
+        }
+    }
+    blockNs = now() - start;
+
+    printf("%-18s %6.2f ns per sample\n", "TMDQueue per lead", perLeadNs / samples);
+    printf("%-18s %6.2f ns per sample\n", "MultiLeadQueue", blockNs / samples);
+    printf("%.0f patients' worth of 12 leads at %d Hz per core\n",
+           1e9 / (blockNs / samples * LEADS * MULTILEADECG_SAMPLE_HZ), MULTILEADECG_SAMPLE_HZ);
+
+    for (p = 0; p < PATIENTS; p++) {
+        for (j = 0; j < LEADS; j++) {
+            if (perLead[p].slope[j].energy != blockSlope[p].energy[j]) {
+                mismatches++;
+            }
+        }
+    }
+    printf("slope energies: %s\n", mismatches == 0 ? "agree" : "MISMATCH");
+
+    for (p = 0; p < PATIENTS; p++) {
+        for (j = 0; j < LEADS; j++) {
+            TMDQueue_Destroy(perLead[p].queue[j]);
+        }
+        MultiLeadQueue_Destroy(recording[p]);
+        MultiLeadQueue_Destroy(queue[p]);
+    }
+    return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
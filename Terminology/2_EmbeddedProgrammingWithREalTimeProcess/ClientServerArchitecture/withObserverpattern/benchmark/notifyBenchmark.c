@@ -0,0 +1,114 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "TMDQueue.h"
+
+/* Inserts ECG samples into a TMDQueue read by several subscribers, each
+   keeping a running sum and maximum of the data values:
+
+   per sample    every subscriber's UpdateFuncPtr, once per sample
+   batch         every subscriber's BatchUpdateFuncPtr, once per span of
+                 BATCH samples, looping over the span itself
+
+   Both must see the same data. A batch subscriber with a latency bound
+   is then checked never to wait longer than the bound. */
+
+#define SUBSCRIBERS 8
+#define SAMPLES 2000000L
+#define BATCH 64
+#define LATENCY 10
+
+typedef struct Statistics Statistics;
+struct Statistics {
+    long sum;
+    int max;
+    int longestSpan;
+};
+
+static void Statistics_update(void* clientPtr, const struct TimeMarkedData tmd) {
+    Statistics* me = (Statistics*)clientPtr;
+    me->sum += tmd.dataValue;
+    if (tmd.dataValue > me->max) {
+        me->max = tmd.dataValue;
+    }
+}
+
+static void Statistics_updateBatch(void* clientPtr, const struct TimeMarkedData* tmd, int count) {
+    Statistics* me = (Statistics*)clientPtr;
+    long sum = me->sum;
+    int j, max = me->max;
+    for (j = 0; j < count; j++) {
+        sum += tmd[j].dataValue;
+        max = tmd[j].dataValue > max ? tmd[j].dataValue : max;
+    }
+    me->sum = sum;
+    me->max = max;
+    if (count > me->longestSpan) {
+        me->longestSpan = count;
+    }
+}
+
+/* inserts SAMPLES samples; returns ns per sample */
+static double run(TMDQueue* const queue) {
+    struct timespec start, stop;
+    TimeMarkedData tmd;
+    long t;
+    TimeMarkedData_Init(&tmd);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (t = 0; t < SAMPLES; t++) {
+        tmd.timeInterval = t;
+        tmd.dataValue = (int)((t * 7919) % 1024);
+        TMDQueue_insert(queue, tmd);
+    }
+    TMDQueue_flush(queue);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    return ((stop.tv_sec - start.tv_sec) * 1e9 + (stop.tv_nsec - start.tv_nsec)) / SAMPLES;
+}
+
+int main(void) {
+    Statistics perSample[SUBSCRIBERS] = {{0, 0, 0}};
+    Statistics batch[SUBSCRIBERS] = {{0, 0, 0}};
+    Statistics bounded = {0, 0, 0};
+    TMDQueue* queue = TMDQueue_Create();
+    int handles[SUBSCRIBERS];
+    int j, errors = 0;
+    double ns;
+
+    if (queue == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    }
+    for (j = 0; j < SUBSCRIBERS; j++) {
+        handles[j] = TMDQueue_subscribe(queue, Statistics_update, &perSample[j]);
+    }
+    ns = run(queue);
+    printf("%-10s %d subscribers: %6.2f ns per sample\n", "per sample", SUBSCRIBERS, ns);
+    for (j = 0; j < SUBSCRIBERS; j++) {
+        TMDQueue_unsubscribe(queue, handles[j]);
+    }
+
+    for (j = 0; j < SUBSCRIBERS; j++) {
+        handles[j] = TMDQueue_subscribeBatch(queue, Statistics_updateBatch, &batch[j], BATCH, -1);
+    }
+    ns = run(queue);
+    printf("%-10s %d subscribers: %6.2f ns per sample (spans of %d)\n", "batch", SUBSCRIBERS, ns, BATCH);
+    for (j = 0; j < SUBSCRIBERS; j++) {
+        TMDQueue_unsubscribe(queue, handles[j]);
+        if (batch[j].sum != perSample[j].sum || batch[j].max != perSample[j].max) {
+            errors++;
+        }
+    }
+
+    /* one sample per time unit: no span may be older than LATENCY */
+    TMDQueue_subscribeBatch(queue, Statistics_updateBatch, &bounded, 1000, LATENCY);
+    run(queue);
+    printf("batch of 1000 bounded to %d time units: longest span %d\n", LATENCY, bounded.longestSpan);
+    if (bounded.longestSpan > LATENCY + 1 || bounded.sum != perSample[0].sum) {
+        errors++;
+    }
+
+    printf("%s\n", errors == 0 ? "subscribers agree" : "MISMATCH");
+    TMDQueue_Destroy(queue);
+    return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,188 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "QRSDetector.h"
+
+/* Runs a minute of ECG on many channels at 500 Hz through a QRSDetector
+   per channel, two ways:
+
+   sample by sample   every channel's sample of one frame, then the next
+                      frame, as a TMDQueue per channel would deliver them
+   in blocks          BLOCK_FRAMES samples of one channel, then the next
+                      channel, as a MultiLeadQueue delivers them
+
+   Every channel has its own amplitude and RR intervals that change from
+   beat to beat (0.6 - 1.2 s), with noise and baseline wander on top.
+   The detected beats are checked against the beats put in: a detection
+   within TOLERANCE of one counts as a hit. */
+
+#define CHANNELS 512
+#define SAMPLE_HZ 500
+#define SECONDS 60
+#define FRAMES (SECONDS * SAMPLE_HZ)
+#define BLOCK_FRAMES 50
+#define MAX_BEATS 128
+#define TOLERANCE (SAMPLE_HZ * 75 / 1000) /* 75 ms */
+
+typedef struct Channel Channel;
+struct Channel {
+    QRSDetector* detector;
+    int* signal;
+    long truth[MAX_BEATS]; /* frames of the R waves put in */
+    int nTruth;
+    long found[MAX_BEATS]; /* and of the ones detected */
+    int nFound;
+};
+
+static unsigned int seed = 12345;
+
+static int randomBetween(int low, int high) {
+    seed = seed * 1103515245u + 12345u;
+    return low + (int)((seed >> 8) % (unsigned int)(high - low + 1));
+}
+
+/* a beat: a QRS 40 ms wide with its R wave at 0, and a T wave 100 ms
+   wide 300 ms after it */
+static int beatAt(int phase, int amplitude) {
+    const int halfQRS = SAMPLE_HZ / 50, tStart = SAMPLE_HZ * 3 / 10, halfT = SAMPLE_HZ / 20;
+    if (phase >= -halfQRS && phase <= halfQRS) {
+        return amplitude - amplitude * (phase < 0 ? -phase : phase) / halfQRS;
+    }
+    phase -= tStart;
+    if (phase >= -halfT && phase <= halfT) {
+        return amplitude / 4 - amplitude / 4 * (phase < 0 ? -phase : phase) / halfT;
+    }
+    return 0;
+}
+
+static void Channel_generate(Channel* const me) {
+    int amplitude = randomBetween(500, 1500);
+    int noise = amplitude / 20;
+    int wander = randomBetween(0, 300), wanderPeriod = randomBetween(2, 6) * SAMPLE_HZ;
+    long f, next = randomBetween(SAMPLE_HZ / 4, SAMPLE_HZ), last = -SAMPLE_HZ;
+    int w;
+    me->nTruth = 0;
+    for (f = 0; f < FRAMES; f++) {
+        if (f == next) {
+            if (me->nTruth < MAX_BEATS) {
+                me->truth[me->nTruth++] = f;
+            }
+            last = f;
+            next = f + randomBetween(SAMPLE_HZ * 6 / 10, SAMPLE_HZ * 12 / 10);
+        }
+        w = (int)(f % wanderPeriod) * 2 * wander / wanderPeriod;
+        me->signal[f] = 2048 + beatAt((int)(f - (f - last < next - f ? last : next)), amplitude) +
+                        (w < wander ? w : 2 * wander - w) + randomBetween(-noise, noise);
+    }
+}
+
+static void Channel_beat(void* clientPtr, long beatTime) {
+    Channel* me = (Channel*)clientPtr;
+    if (me->nFound < MAX_BEATS) {
+        me->found[me->nFound++] = beatTime;
+    }
+}
+
+static long now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000L + t.tv_nsec;
+}
+
+static void reset(Channel* channels) {
+    int c;
+    for (c = 0; c < CHANNELS; c++) {
+        QRSDetector_setSampleRate(channels[c].detector, SAMPLE_HZ);
+        channels[c].nFound = 0;
+    }
+}
+
+static void report(const char* mode, long ns) {
+    double perSample = (double)ns / ((double)CHANNELS * FRAMES);
+    printf("%-18s %6.1f ns per sample, %6.0f channels at %d Hz per core\n", mode, perSample,
+           1e9 / (perSample * SAMPLE_HZ), SAMPLE_HZ);
+}
+
+int main(void) {
+    static Channel channels[CHANNELS];
+    static long timeInterval[FRAMES];
+    long start, ns, error = 0;
+    long hits = 0, missed = 0, extra = 0, from, to;
+    int c, f, t, d;
+
+    for (f = 0; f < FRAMES; f++) {
+        timeInterval[f] = f;
+    }
+    for (c = 0; c < CHANNELS; c++) {
+        channels[c].detector = QRSDetector_Create();
+        channels[c].signal = (int*)malloc(FRAMES * sizeof(int));
+        if (channels[c].detector == NULL || channels[c].signal == NULL) {
+            fprintf(stderr, "out of memory\n");
+            return EXIT_FAILURE;
+        }
+        QRSDetector_setBeatHandler(channels[c].detector, Channel_beat, &channels[c]);
+        Channel_generate(&channels[c]);
+    }
+    printf("%d channels, %d s at %d Hz\n", CHANNELS, SECONDS, SAMPLE_HZ);
+
+    reset(channels);
+    start = now();
+    for (f = 0; f < FRAMES; f++) {
+        for (c = 0; c < CHANNELS; c++) {
+            QRSDetector_detectQRS(channels[c].detector, timeInterval[f], channels[c].signal[f]);
+        }
+    }
+    ns = now() - start;
+    report("sample by sample", ns);
+
+    reset(channels);
+    start = now();
+    for (f = 0; f < FRAMES; f += BLOCK_FRAMES) {
+        for (c = 0; c < CHANNELS; c++) {
+            QRSDetector_detectBlock(channels[c].detector, timeInterval + f, channels[c].signal + f,
+                                    BLOCK_FRAMES);
+        }
+    }
+    ns = now() - start;
+    report("in blocks", ns);
+    printf("real time x %.0f\n", (double)SECONDS * 1e9 / ns);
+
+    /* the beats during the learning phase, and in the last half second
+       (which the detector has not finished with), are not counted */
+    from = channels[0].detector->learned;
+    to = FRAMES - SAMPLE_HZ / 2;
+    for (c = 0; c < CHANNELS; c++) {
+        const Channel* ch = &channels[c];
+        for (t = 0, d = 0; t < ch->nTruth || d < ch->nFound;) {
+            if (t < ch->nTruth && (ch->truth[t] < from || ch->truth[t] >= to)) {
+                if (d < ch->nFound && labs(ch->found[d] - ch->truth[t]) <= TOLERANCE) {
+                    d++;
+                }
+                t++;
+            } else if (d < ch->nFound && ch->found[d] >= to) {
+                d++;
+            } else if (t < ch->nTruth && d < ch->nFound &&
+                       labs(ch->found[d] - ch->truth[t]) <= TOLERANCE) {
+                error += labs(ch->found[d] - ch->truth[t]);
+                hits++;
+                t++;
+                d++;
+            } else if (d < ch->nFound && (t == ch->nTruth || ch->found[d] < ch->truth[t])) {
+                extra++;
+                d++;
+            } else {
+                missed++;
+                t++;
+            }
+        }
+    }
+    printf("%ld beats: %ld found, %ld missed, %ld false, R wave off by %.1f ms on average\n",
+           hits + missed, hits, missed, extra, hits ? error * 1000.0 / SAMPLE_HZ / hits : 0.0);
+
+    for (c = 0; c < CHANNELS; c++) {
+        QRSDetector_Destroy(channels[c].detector);
+        free(channels[c].signal);
+    }
+    return missed * 200 <= hits + missed && extra * 200 <= hits ? EXIT_SUCCESS : EXIT_FAILURE;
+}
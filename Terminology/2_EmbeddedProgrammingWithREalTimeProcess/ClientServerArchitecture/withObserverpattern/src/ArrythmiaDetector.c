@@ -1,27 +1,249 @@
+#include <math.h>
 #include "ArrythmiaDetector.h"
 #include "TimeMarkedData.h"
 #include "TMDQueue.h"
+#include "QRSDetector.h"
 
 static void cleanUpRelations(ArrythmiaDetector* const me);
 
+/* the UpdateFuncPtr the queue calls, with this client as clientPtr */
+static void ArrythmiaDetector_notify(void* clientPtr, const struct TimeMarkedData tmd) {
+    ArrythmiaDetector_update((ArrythmiaDetector*)clientPtr, tmd);
+}
+
+/* the BeatFuncPtr the QRS detector calls, with this client as clientPtr */
+static void ArrythmiaDetector_beat(void* clientPtr, long beatTime) {
+    ArrythmiaDetector_detectArrythmia((ArrythmiaDetector*)clientPtr, beatTime);
+}
+
 void ArrythmiaDetector_Init(ArrythmiaDetector* const me) {
     me->itsTMDQueue = NULL;
+    me->notificationHandle = -1;
+    me->itsQRSDetector = NULL;
+    me->eventAddr = NULL;
+    me->eventClientPtr = NULL;
+    ArrythmiaDetector_configure(me, ARRYTHMIADETECTOR_DEFAULT_WINDOW, ARRYTHMIADETECTOR_DEFAULT_TICKS);
 }
 
 void ArrythmiaDetector_Cleanup(ArrythmiaDetector* const me) {
     /* remove yourself from server subscription list */
     if (me->itsTMDQueue != NULL) {
-        TMDQueue_unsubscribe(me->itsTMDQueue, ArrythmiaDetector_update);
+        TMDQueue_unsubscribe(me->itsTMDQueue, me->notificationHandle);
+    }
+    if (me->itsQRSDetector != NULL) {
+        QRSDetector_setBeatHandler(me->itsQRSDetector, NULL, NULL);
     }
     cleanUpRelations(me);
 }
 
 void ArrythmiaDetector_update(ArrythmiaDetector* const me, const struct TimeMarkedData tmd) {
+    (void)me;
+#ifndef NO_INSTRUMENTATION
     printf(" Arrythmia Detector -> TimeInterval: %ld DataValue: %d\n", tmd.timeInterval, tmd.dataValue);
+#else
+    (void)tmd;
+#endif
 }
 
-void ArrythmiaDetector_detectArrythmia(ArrythmiaDetector* const me) {
-    /* put some arrythmia detection algorithm here */
+static void emit(const ArrythmiaDetector* const me, ArrythmiaType type, long beatTime, long rr) {
+    ArrythmiaEvent event;
+    ArrythmiaDetector_getStatistics(me, &event);
+    event.type = type;
+    event.beatTime = beatTime;
+    event.rr = rr;
+    if (me->eventAddr != NULL) {
+        me->eventAddr(me->eventClientPtr, &event);
+    }
+#ifndef NO_INSTRUMENTATION
+    printf(" Arrythmia Detector -> %s at %ld (RR %ld, mean %.1f, SDNN %.1f, RMSSD %.1f)\n",
+           ArrythmiaDetector_typeName(type), beatTime, rr, event.meanRR, event.sdnn, event.rmssd);
+#endif
+}
+
+/* the rhythm of the intervals in the window; compared as integers, so
+   the decision costs no division: mean RR = sum / count, and
+   irregularity > p% if 10000 * count^2 * sumSquaredDiffs >
+   p^2 * (count - 1) * sum^2 */
+static ArrythmiaType classify(const ArrythmiaDetector* const me) {
+    long long n = me->count;
+    long long p = ARRYTHMIADETECTOR_IRREGULAR_PERCENT;
+    if (n < ARRYTHMIADETECTOR_MIN_BEATS) {
+        return ARRYTHMIA_UNKNOWN;
+    }
+    if (10000 * n * n * me->sumSquaredDiffs > p * p * (n - 1) * me->sum * me->sum) {
+        return ARRYTHMIA_IRREGULAR_RHYTHM;
+    }
+    /* mean RR above 60 / bpm seconds */
+    if (me->sum * ARRYTHMIADETECTOR_BRADYCARDIA_BPM > 60 * me->ticksPerSecond * n) {
+        return ARRYTHMIA_BRADYCARDIA;
+    }
+    if (me->sum * ARRYTHMIADETECTOR_TACHYCARDIA_BPM < 60 * me->ticksPerSecond * n) {
+        return ARRYTHMIA_TACHYCARDIA;
+    }
+    return ARRYTHMIA_NORMAL_RHYTHM;
+}
+
+/* sliding window algorithm
+   the beat's RR interval goes into the running sums, and the oldest one
+   (with its difference to the next) comes out once the window is full.
+   The beat is judged first: it is premature if it is short against both
+   the interval before it (so that a change of rate is not one premature
+   beat after another) and the last NN interval (so that the beat after a
+   pause is not one), and ends a pause if it is long against the mean.
+   Neither goes in, nor does the interval after a premature beat, which
+   its compensatory pause lengthens. The rhythm is judged after. */
+void ArrythmiaDetector_detectArrythmia(ArrythmiaDetector* const me, long beatTime) {
+    long rr, oldest, previous, diff;
+    int next;
+    boolean ectopic = 0, premature = 0;
+    ArrythmiaType rhythm;
+
+    if (!me->hasBeat) {
+        me->hasBeat = 1;
+        me->lastBeatTime = beatTime;
+        return;
+    }
+    rr = beatTime - me->lastBeatTime;
+    me->lastBeatTime = beatTime;
+    if (rr <= 0) {
+        return;
+    }
+    if (rr > ARRYTHMIADETECTOR_MAX_RR_SECONDS * me->ticksPerSecond) {
+        /* beats were lost (a lead came off, say): start the window again */
+        me->first = 0;
+        me->count = 0;
+        me->sum = 0;
+        me->sumSquares = 0;
+        me->sumSquaredDiffs = 0;
+        me->lastRR = 0;
+        me->afterPremature = 0;
+        me->rhythm = ARRYTHMIA_UNKNOWN;
+        return;
+    }
+    me->beats++;
+
+    next = me->first + me->count;
+    if (next >= me->window) {
+        next -= me->window;
+    }
+    previous = me->count > 0 ? me->rr[next == 0 ? me->window - 1 : next - 1] : 0;
+
+    if (me->count >= ARRYTHMIADETECTOR_MIN_BEATS && me->rhythm != ARRYTHMIA_IRREGULAR_RHYTHM) {
+        if (rr * 100 < me->lastRR * ARRYTHMIADETECTOR_PREMATURE_PERCENT &&
+            rr * 100 < previous * ARRYTHMIADETECTOR_PREMATURE_PERCENT) {
+            emit(me, ARRYTHMIA_PREMATURE_BEAT, beatTime, rr);
+            premature = 1;
+            ectopic = 1;
+        } else if (rr * 100LL * me->count > me->sum * ARRYTHMIADETECTOR_PAUSE_PERCENT) {
+            emit(me, ARRYTHMIA_PAUSE, beatTime, rr);
+            ectopic = 1;
+        } else {
+            ectopic = me->afterPremature;
+        }
+    }
+    me->lastRR = rr;
+    me->afterPremature = premature;
+    if (ectopic) {
+        return;
+    }
+
+    if (me->count == me->window) {
+        oldest = me->rr[me->first];
+        me->first = me->first + 1 == me->window ? 0 : me->first + 1;
+        diff = me->rr[me->first] - oldest;
+        me->sum -= oldest;
+        me->sumSquares -= (long long)oldest * oldest;
+        me->sumSquaredDiffs -= (long long)diff * diff;
+        me->count--;
+    }
+    if (me->count > 0) {
+        diff = rr - previous;
+        me->sumSquaredDiffs += (long long)diff * diff;
+    }
+    me->rr[next] = rr;
+    me->sum += rr;
+    me->sumSquares += (long long)rr * rr;
+    me->count++;
+
+    rhythm = classify(me);
+    if (rhythm != me->rhythm) {
+        me->rhythm = rhythm;
+        if (rhythm != ARRYTHMIA_UNKNOWN) {
+            emit(me, rhythm, beatTime, rr);
+        }
+    }
+}
+
+int ArrythmiaDetector_configure(ArrythmiaDetector* const me, int window, long ticksPerSecond) {
+    if (window < 2 || window > ARRYTHMIADETECTOR_MAX_WINDOW || ticksPerSecond < 1 ||
+        ticksPerSecond > ARRYTHMIADETECTOR_MAX_TICKS) {
+        return 0;
+    }
+    me->window = window;
+    me->ticksPerSecond = ticksPerSecond;
+    me->first = 0;
+    me->count = 0;
+    me->sum = 0;
+    me->sumSquares = 0;
+    me->sumSquaredDiffs = 0;
+    me->hasBeat = 0;
+    me->lastBeatTime = 0;
+    me->lastRR = 0;
+    me->afterPremature = 0;
+    me->rhythm = ARRYTHMIA_UNKNOWN;
+    me->beats = 0;
+    return 1;
+}
+
+void ArrythmiaDetector_setEventHandler(ArrythmiaDetector* const me, ArrythmiaEventFuncPtr eventFuncAddr,
+                                       void* clientPtr) {
+    me->eventAddr = eventFuncAddr;
+    me->eventClientPtr = clientPtr;
+}
+
+void ArrythmiaDetector_getStatistics(const ArrythmiaDetector* const me, ArrythmiaEvent* const stats) {
+    double n = me->count;
+    stats->type = me->rhythm;
+    stats->beatTime = me->lastBeatTime;
+    stats->rr = me->count > 0 ? me->rr[(me->first + me->count - 1) % me->window] : 0;
+    stats->beats = me->count;
+    stats->meanRR = me->count > 0 ? (double)me->sum / n : 0.0;
+    stats->sdnn = 0.0;
+    stats->rmssd = 0.0;
+    stats->irregularity = 0.0;
+    if (me->count > 1) {
+        /* n * sumSquares - sum^2 is exact, and never negative */
+        stats->sdnn = sqrt((double)(me->count * me->sumSquares - me->sum * me->sum) / (n * (n - 1)));
+        stats->rmssd = sqrt((double)me->sumSquaredDiffs / (n - 1));
+        stats->irregularity = stats->rmssd / stats->meanRR;
+    }
+}
+
+ArrythmiaType ArrythmiaDetector_getRhythm(const ArrythmiaDetector* const me) {
+    return me->rhythm;
+}
+
+long ArrythmiaDetector_getBeats(const ArrythmiaDetector* const me) {
+    return me->beats;
+}
+
+const char* ArrythmiaDetector_typeName(ArrythmiaType type) {
+    switch (type) {
+    case ARRYTHMIA_NORMAL_RHYTHM:
+        return "normal rhythm";
+    case ARRYTHMIA_BRADYCARDIA:
+        return "bradycardia";
+    case ARRYTHMIA_TACHYCARDIA:
+        return "tachycardia";
+    case ARRYTHMIA_IRREGULAR_RHYTHM:
+        return "irregular rhythm";
+    case ARRYTHMIA_PREMATURE_BEAT:
+        return "premature beat";
+    case ARRYTHMIA_PAUSE:
+        return "pause";
+    default:
+        return "unknown";
+    }
 }
 
 struct TMDQueue* ArrythmiaDetector_getItsTMDQueue(const ArrythmiaDetector* const me) {
@@ -32,7 +254,21 @@ void ArrythmiaDetector_setItsTMDQueue(ArrythmiaDetector* const me, struct TMDQue
     me->itsTMDQueue = p_TMDQueue;
     /* call subscribe to connect to the server */
     if (p_TMDQueue != NULL) {
-        TMDQueue_subscribe(me->itsTMDQueue, ArrythmiaDetector_update);
+        me->notificationHandle = TMDQueue_subscribe(me->itsTMDQueue, ArrythmiaDetector_notify, me);
+    }
+}
+
+struct QRSDetector* ArrythmiaDetector_getItsQRSDetector(const ArrythmiaDetector* const me) {
+    return (struct QRSDetector*)me->itsQRSDetector;
+}
+
+void ArrythmiaDetector_setItsQRSDetector(ArrythmiaDetector* const me, struct QRSDetector* p_QRSDetector) {
+    if (me->itsQRSDetector != NULL) {
+        QRSDetector_setBeatHandler(me->itsQRSDetector, NULL, NULL);
+    }
+    me->itsQRSDetector = p_QRSDetector;
+    if (p_QRSDetector != NULL) {
+        QRSDetector_setBeatHandler(p_QRSDetector, ArrythmiaDetector_beat, me);
     }
 }
 
@@ -55,4 +291,5 @@ static void cleanUpRelations(ArrythmiaDetector* const me) {
     if (me->itsTMDQueue != NULL) {
         me->itsTMDQueue = NULL;
     }
+    me->itsQRSDetector = NULL;
 }
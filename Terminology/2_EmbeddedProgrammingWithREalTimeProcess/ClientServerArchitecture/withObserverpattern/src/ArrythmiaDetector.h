@@ -5,12 +5,95 @@
 #include "ECGPkg.h"
 
 struct TMDQueue;
+struct QRSDetector;
+
+/* RR intervals the window can hold */
+#define ARRYTHMIADETECTOR_MAX_WINDOW 64
+/* the finest time base, in timeInterval units a second, and the longest
+   RR interval taken as one (a longer gap is lost beats, and starts the
+   window again); together they keep the running sums within 64 bits */
+#define ARRYTHMIADETECTOR_MAX_TICKS 1000
+#define ARRYTHMIADETECTOR_MAX_RR_SECONDS 10
+/* the configuration Init() sets up: QRSDetector's beat times at its
+   default 500 Hz, 32 beats */
+#define ARRYTHMIADETECTOR_DEFAULT_WINDOW 32
+#define ARRYTHMIADETECTOR_DEFAULT_TICKS 500
+/* RR intervals needed before the rhythm is classified */
+#define ARRYTHMIADETECTOR_MIN_BEATS 8
+/* the classification, from the window's mean RR interval and its
+   irregularity (RMSSD / mean RR, in percent) */
+#define ARRYTHMIADETECTOR_BRADYCARDIA_BPM 50
+#define ARRYTHMIADETECTOR_TACHYCARDIA_BPM 100
+#define ARRYTHMIADETECTOR_IRREGULAR_PERCENT 15
+/* a beat is premature if its RR interval is under this share of the one
+   before and of the last NN interval, and ends a pause if it is over this
+   share of the mean, in percent */
+#define ARRYTHMIADETECTOR_PREMATURE_PERCENT 80
+#define ARRYTHMIADETECTOR_PAUSE_PERCENT 200
+
+typedef enum ArrythmiaType {
+    ARRYTHMIA_UNKNOWN,          /* too few beats yet */
+    ARRYTHMIA_NORMAL_RHYTHM,
+    ARRYTHMIA_BRADYCARDIA,
+    ARRYTHMIA_TACHYCARDIA,
+    ARRYTHMIA_IRREGULAR_RHYTHM, /* atrial fibrillation, say */
+    ARRYTHMIA_PREMATURE_BEAT,
+    ARRYTHMIA_PAUSE
+} ArrythmiaType;
+
+typedef struct ArrythmiaEvent ArrythmiaEvent;
+
+/* the rhythm types are reported when the rhythm changes to them, the
+   beat types for the beat they describe (but not in an irregular
+   rhythm, where every beat would be one); times are in timeInterval
+   units */
+struct ArrythmiaEvent {
+    ArrythmiaType type;
+    long beatTime;
+    long rr;             /* the beat's RR interval */
+    int beats;           /* NN intervals in the window */
+    double meanRR;
+    double sdnn;         /* their standard deviation */
+    double rmssd;        /* the root mean square of successive differences */
+    double irregularity; /* rmssd / meanRR */
+};
+
+typedef void (*ArrythmiaEventFuncPtr)(void* clientPtr, const ArrythmiaEvent* event);
 
 /* class ArrythmiaDetector */
+/* Classifies the rhythm from the RR intervals between the beats a
+   QRSDetector finds, and reports premature beats and pauses. The
+   statistics are those of the normal-to-normal (NN) intervals: the
+   intervals of premature beats, of the beats after them and of pauses
+   are reported but left out.
+
+   The last window NN intervals are kept in a ring, with running sums of
+   the intervals, of their squares and of the squared differences between
+   successive intervals; a beat adds its interval to the sums and takes
+   out the one leaving the window, so the statistics cost the same however
+   long the window is. The sums are integers, so they never drift. */
 typedef struct ArrythmiaDetector ArrythmiaDetector;
 
 struct ArrythmiaDetector {
     struct TMDQueue* itsTMDQueue;
+    int notificationHandle; /* our subscription to itsTMDQueue */
+    struct QRSDetector* itsQRSDetector;
+    long ticksPerSecond;    /* timeInterval units in a second */
+    int window;
+    long rr[ARRYTHMIADETECTOR_MAX_WINDOW]; /* a ring */
+    int first;              /* the oldest interval */
+    int count;
+    long long sum;
+    long long sumSquares;
+    long long sumSquaredDiffs; /* of the count - 1 successive differences */
+    boolean hasBeat;
+    long lastBeatTime;
+    long lastRR;            /* the interval before, in the window or not */
+    boolean afterPremature;
+    ArrythmiaType rhythm;
+    long beats;             /* RR intervals taken */
+    ArrythmiaEventFuncPtr eventAddr;
+    void* eventClientPtr;
 };
 
 /* Constructors and destructors:*/
@@ -19,10 +102,28 @@ void ArrythmiaDetector_Cleanup(ArrythmiaDetector* const me);
 
 /* Operations */
 void ArrythmiaDetector_update(ArrythmiaDetector* const me, const struct TimeMarkedData tmd);
-void ArrythmiaDetector_detectArrythmia(ArrythmiaDetector* const me);
+/* takes the next beat, its R wave at beatTime */
+void ArrythmiaDetector_detectArrythmia(ArrythmiaDetector* const me, long beatTime);
+
+/* statistics over the last window RR intervals of beats ticksPerSecond
+   timeInterval units apart; forgets every beat. Returns 0 (and changes
+   nothing) if window is not 2 .. ARRYTHMIADETECTOR_MAX_WINDOW or
+   ticksPerSecond is not 1 .. ARRYTHMIADETECTOR_MAX_TICKS. */
+int ArrythmiaDetector_configure(ArrythmiaDetector* const me, int window, long ticksPerSecond);
+void ArrythmiaDetector_setEventHandler(ArrythmiaDetector* const me, ArrythmiaEventFuncPtr eventFuncAddr,
+                                       void* clientPtr);
+
+/* the window's statistics, as an event of the current rhythm */
+void ArrythmiaDetector_getStatistics(const ArrythmiaDetector* const me, ArrythmiaEvent* const stats);
+ArrythmiaType ArrythmiaDetector_getRhythm(const ArrythmiaDetector* const me);
+long ArrythmiaDetector_getBeats(const ArrythmiaDetector* const me);
+const char* ArrythmiaDetector_typeName(ArrythmiaType type);
 
 struct TMDQueue* ArrythmiaDetector_getItsTMDQueue(const ArrythmiaDetector* const me);
 void ArrythmiaDetector_setItsTMDQueue(ArrythmiaDetector* const me, struct TMDQueue* p_TMDQueue);
+struct QRSDetector* ArrythmiaDetector_getItsQRSDetector(const ArrythmiaDetector* const me);
+/* takes the beats p_QRSDetector finds */
+void ArrythmiaDetector_setItsQRSDetector(ArrythmiaDetector* const me, struct QRSDetector* p_QRSDetector);
 
 ArrythmiaDetector* ArrythmiaDetector_Create(void);
 void ArrythmiaDetector_Destroy(ArrythmiaDetector* const me);
@@ -14,10 +14,21 @@ struct TestBuilder;
 struct TimeMarkedData;
 struct WaveformDisplay;
 struct NotificationHandle;
+struct LeadBlock;
+struct MultiLeadQueue;
+struct MultiLeadECG;
 
 typedef unsigned char boolean;
 typedef void (*UpdateFuncPtr)(void* clientPtr, const struct TimeMarkedData tmd);
+/* count samples, oldest first; tmd points into the queue and is only
+   valid during the call */
+typedef void (*BatchUpdateFuncPtr)(void* clientPtr, const struct TimeMarkedData* tmd, int count);
+/* frames of every lead (see MultiLeadQueue.h); block points into the
+   queue and is only valid during the call */
+typedef void (*LeadBlockFuncPtr)(void* clientPtr, const struct LeadBlock* block);
 
 #define QUEUE_SIZE (20000)
+#define MAX_SUBSCRIBERS (64)
+#define MAX_LEADS (16)
 
 #endif
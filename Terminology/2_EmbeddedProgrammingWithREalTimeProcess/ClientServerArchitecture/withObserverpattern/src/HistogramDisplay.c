@@ -1,27 +1,123 @@
 #include "HistogramDisplay.h"
 #include "TimeMarkedData.h"
 #include "TMDQueue.h"
- 
+
 static void cleanUpRelations(HistogramDisplay* const me);
 
+/* the UpdateFuncPtr the queue calls, with this client as clientPtr */
+static void HistogramDisplay_notify(void* clientPtr, const struct TimeMarkedData tmd) {
+    HistogramDisplay_update((HistogramDisplay*)clientPtr, tmd);
+}
+
 void HistogramDisplay_Init(HistogramDisplay* const me) {
     me->itsTMDQueue = NULL;
+    me->notificationHandle = -1;
+    me->bins = 0;
+    me->binOf = NULL;
+    me->count = NULL;
+    me->version = 0;
+    HistogramDisplay_configure(me, HISTOGRAMDISPLAY_DEFAULT_BINS, HISTOGRAMDISPLAY_DEFAULT_LOW,
+                               HISTOGRAMDISPLAY_DEFAULT_HIGH, HISTOGRAMDISPLAY_DEFAULT_WINDOW);
 }
 
 void HistogramDisplay_Cleanup(HistogramDisplay* const me) {
     /* remove yourself from server subscription list */
     if (me->itsTMDQueue != NULL) {
-        TMDQueue_unsubscribe(me->itsTMDQueue, HistogramDisplay_update);
+        TMDQueue_unsubscribe(me->itsTMDQueue, me->notificationHandle);
     }
     cleanUpRelations(me);
+    free(me->binOf);
+    free(me->count);
+    me->binOf = NULL;
+    me->count = NULL;
+    me->bins = 0;
 }
 
 void HistogramDisplay_update(HistogramDisplay* const me, const struct TimeMarkedData tmd) {
+#ifndef NO_INSTRUMENTATION
     printf(" Histogram -> TimeInterval: %ld DataValue: %d\n", tmd.timeInterval, tmd.dataValue);
+#endif
+    HistogramDisplay_updateHistogram(me, tmd.dataValue);
+}
+
+/* sliding window algorithm
+   one bin up and, once the window is full, one bin down, inside an odd
+   version; the counts are written with atomic stores so that a snapshot
+   reading them at the same time is not a data race */
+void HistogramDisplay_updateHistogram(HistogramDisplay* const me, int dataValue) {
+    unsigned int* count = me->count;
+    int bin, old;
+    if (me->bins == 0) {
+        return;
+    }
+    if (dataValue <= me->low) {
+        bin = 0;
+    } else if (dataValue >= me->high) {
+        bin = me->bins - 1;
+    } else {
+        bin = (int)((long long)(dataValue - me->low) * me->bins / ((long long)me->high - me->low));
+    }
+
+    __atomic_store_n(&me->version, me->version + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    if (me->samples == me->window) {
+        old = me->binOf[me->next];
+        __atomic_store_n(&count[old], count[old] - 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_store_n(&me->samples, me->samples + 1, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&count[bin], count[bin] + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&me->version, me->version + 1, __ATOMIC_RELEASE);
+
+    me->binOf[me->next] = (unsigned short)bin;
+    me->next = me->next + 1 == me->window ? 0 : me->next + 1;
+}
+
+int HistogramDisplay_configure(HistogramDisplay* const me, int bins, int low, int high, int window) {
+    free(me->binOf);
+    free(me->count);
+    me->bins = 0;
+    me->binOf = NULL;
+    me->count = NULL;
+    me->next = 0;
+    me->samples = 0;
+    if (bins < 1 || bins > HISTOGRAMDISPLAY_MAX_BINS || low >= high || window < 1) {
+        return 0;
+    }
+    me->binOf = (unsigned short*)malloc((size_t)window * sizeof(unsigned short));
+    me->count = (unsigned int*)calloc((size_t)bins, sizeof(unsigned int));
+    if (me->binOf == NULL || me->count == NULL) {
+        free(me->binOf);
+        free(me->count);
+        me->binOf = NULL;
+        me->count = NULL;
+        return 0;
+    }
+    me->low = low;
+    me->high = high;
+    me->window = window;
+    me->bins = bins;
+    return 1;
+}
+
+int HistogramDisplay_getSnapshot(const HistogramDisplay* const me, unsigned int* counts, int max) {
+    unsigned long before, after;
+    int j, n = max < me->bins ? max : me->bins;
+    int samples;
+    do {
+        before = __atomic_load_n(&me->version, __ATOMIC_ACQUIRE);
+        for (j = 0; j < n; j++) {
+            counts[j] = __atomic_load_n(&me->count[j], __ATOMIC_RELAXED);
+        }
+        samples = __atomic_load_n(&me->samples, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&me->version, __ATOMIC_RELAXED);
+    } while ((before & 1) != 0 || before != after);
+    return samples;
 }
 
-void HistogramDisplay_updateHistogram(HistogramDisplay* const me) {
-    /* put some histogram processing here */
+int HistogramDisplay_getBins(const HistogramDisplay* const me) {
+    return me->bins;
 }
 
 struct TMDQueue* HistogramDisplay_getItsTMDQueue(const HistogramDisplay* const me) {
@@ -32,7 +128,7 @@ void HistogramDisplay_setItsTMDQueue(HistogramDisplay* const me, struct TMDQueue
     me->itsTMDQueue = p_TMDQueue;
     /* call subscribe to connect to the server */
     if (p_TMDQueue != NULL) {
-        TMDQueue_subscribe(me->itsTMDQueue, HistogramDisplay_update);
+        me->notificationHandle = TMDQueue_subscribe(me->itsTMDQueue, HistogramDisplay_notify, me);
     }
 }
 
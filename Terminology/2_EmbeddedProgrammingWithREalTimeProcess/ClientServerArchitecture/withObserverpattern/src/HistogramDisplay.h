@@ -6,11 +6,40 @@
 
 struct TMDQueue;
 
+/* the configuration Init() sets up: 12-bit samples over the samples the
+   queue keeps */
+#define HISTOGRAMDISPLAY_DEFAULT_BINS 64
+#define HISTOGRAMDISPLAY_DEFAULT_LOW 0
+#define HISTOGRAMDISPLAY_DEFAULT_HIGH 4096
+#define HISTOGRAMDISPLAY_DEFAULT_WINDOW (QUEUE_SIZE - 1)
+#define HISTOGRAMDISPLAY_MAX_BINS 65536
+
 /* class HistogramDisplay */
+/* A histogram of the last window samples, kept up to date as each one
+   arrives rather than recounted from the queue: the new sample's bin
+   goes up by one, and the bin of the sample that drops out of the window
+   goes down by one. The bins of the samples in the window are kept in a
+   ring, so the one dropping out is found without looking at the queue.
+
+   The display is drawn from a snapshot, which a renderer may take on
+   another thread without holding the producer up: the bins are guarded
+   by a sequence number (a seqlock) that update makes odd while it changes
+   them, and a snapshot copies the bins again if the number was odd or
+   changed while it copied. */
 typedef struct HistogramDisplay HistogramDisplay;
 
 struct HistogramDisplay {
     struct TMDQueue* itsTMDQueue;
+    int notificationHandle; /* our subscription to itsTMDQueue */
+    int bins;               /* 0 if not configured */
+    int low;                /* bin j counts samples from low + j * (high - low) / bins */
+    int high;
+    int window;
+    unsigned short* binOf;  /* the bins of the samples in the window, a ring */
+    int next;               /* where the next sample's bin goes */
+    int samples;            /* in the window, up to window */
+    unsigned int* count;    /* per bin */
+    unsigned long version;  /* odd while the bins change */
 };
 
 /* Constructors and destructors:*/
@@ -19,7 +48,22 @@ void HistogramDisplay_Cleanup(HistogramDisplay* const me);
 
 /* Operations */
 void HistogramDisplay_update(HistogramDisplay* const me, const struct TimeMarkedData tmd);
-void HistogramDisplay_updateHistogram(HistogramDisplay* const me);
+/* adds the sample, and drops the one window samples ago */
+void HistogramDisplay_updateHistogram(HistogramDisplay* const me, int dataValue);
+
+/* bins bins from low to high (samples outside go in the first or last),
+   over the last window samples; empties the histogram. Returns 0, and
+   leaves the histogram unconfigured, if bins is not 1 ..
+   HISTOGRAMDISPLAY_MAX_BINS, low >= high, window < 1 or out of memory.
+   Not to be called while a snapshot is being taken. */
+int HistogramDisplay_configure(HistogramDisplay* const me, int bins, int low, int high, int window);
+
+/* copies the first max bins of a consistent state of the histogram into
+   counts and returns the number of samples it holds; may be called on
+   another thread than update() */
+int HistogramDisplay_getSnapshot(const HistogramDisplay* const me, unsigned int* counts, int max);
+
+int HistogramDisplay_getBins(const HistogramDisplay* const me);
 
 struct TMDQueue* HistogramDisplay_getItsTMDQueue(const HistogramDisplay* const me);
 void HistogramDisplay_setItsTMDQueue(HistogramDisplay* const me, struct TMDQueue* p_TMDQueue);
@@ -0,0 +1,102 @@
+#define _POSIX_C_SOURCE 200809L
+#include "MultiLeadECG.h"
+#include "MultiLeadQueue.h"
+
+static void cleanUpRelations(MultiLeadECG* const me);
+
+int MultiLeadECG_Init(MultiLeadECG* const me, int leads, int blockFrames) {
+    void* block;
+    int j;
+    me->leads = 0;
+    me->blockFrames = 0;
+    me->timeCounter = 1000;
+    me->time = NULL;
+    for (j = 0; j < MAX_LEADS; j++) {
+        me->value[j] = NULL;
+    }
+    me->itsMultiLeadQueue = NULL;
+    if (leads < 1 || leads > MAX_LEADS || blockFrames < 1) {
+        return 0;
+    }
+    me->time = (long*)malloc((size_t)blockFrames * sizeof(long));
+    if (me->time == NULL) {
+        return 0;
+    }
+    for (j = 0; j < leads; j++) {
+        if (posix_memalign(&block, MULTILEADQUEUE_ALIGN, (size_t)blockFrames * sizeof(int)) != 0) {
+            return 0;
+        }
+        me->value[j] = (int*)block;
+        me->leads = j + 1;
+    }
+    me->blockFrames = blockFrames;
+    return 1;
+}
+
+void MultiLeadECG_Cleanup(MultiLeadECG* const me) {
+    int j;
+    cleanUpRelations(me);
+    free(me->time);
+    for (j = 0; j < MAX_LEADS; j++) {
+        free(me->value[j]);
+    }
+}
+
+/* the simulated beat: a QRS spike 40 ms wide and a T wave 100 ms wide,
+   300 ms apart, in ADC counts */
+static int MultiLeadECG_beat(int phase) {
+    if (phase < 20) {
+        return 1000 - 100 * (phase < 10 ? 10 - phase : phase - 10);
+    }
+    if (phase >= 150 && phase < 200) {
+        return 200 - 8 * (phase < 175 ? 175 - phase : phase - 175);
+    }
+    return 0;
+}
+
+void MultiLeadECG_getDataBlock(MultiLeadECG* const me) {
+    /* Simulate getting a block from the ECG front end */
+    int j, f, phase, sample;
+    for (f = 0; f < me->blockFrames; f++) {
+        phase = (int)(me->timeCounter % MULTILEADECG_BEAT_FRAMES);
+        sample = MultiLeadECG_beat(phase);
+        me->time[f] = me->timeCounter++;
+        for (j = 0; j < me->leads; j++) {
+            me->value[j][f] = 512 + sample * (j + 4) / 8;
+        }
+    }
+
+    /* Insert the block into the queue, which will notify all observers */
+    MultiLeadQueue_insert(me->itsMultiLeadQueue, me->time, (const int* const*)me->value,
+                          me->blockFrames);
+}
+
+struct MultiLeadQueue* MultiLeadECG_getItsMultiLeadQueue(const MultiLeadECG* const me) {
+    return (struct MultiLeadQueue*)me->itsMultiLeadQueue;
+}
+
+void MultiLeadECG_setItsMultiLeadQueue(MultiLeadECG* const me, struct MultiLeadQueue* p_MultiLeadQueue) {
+    me->itsMultiLeadQueue = p_MultiLeadQueue;
+}
+
+MultiLeadECG* MultiLeadECG_Create(int leads, int blockFrames) {
+    MultiLeadECG* me = (MultiLeadECG*)malloc(sizeof(MultiLeadECG));
+    if (me != NULL && !MultiLeadECG_Init(me, leads, blockFrames)) {
+        MultiLeadECG_Destroy(me);
+        me = NULL;
+    }
+    return me;
+}
+
+void MultiLeadECG_Destroy(MultiLeadECG* const me) {
+    if (me != NULL) {
+        MultiLeadECG_Cleanup(me);
+    }
+    free(me);
+}
+
+static void cleanUpRelations(MultiLeadECG* const me) {
+    if (me->itsMultiLeadQueue != NULL) {
+        me->itsMultiLeadQueue = NULL;
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef MultiLeadECG_H
+#define MultiLeadECG_H
+
+#include <stdio.h>
+#include "ECGPkg.h"
+
+struct MultiLeadQueue;
+
+/* frames are counted in samples of MULTILEADECG_SAMPLE_HZ */
+#define MULTILEADECG_SAMPLE_HZ 500
+#define MULTILEADECG_BEAT_FRAMES 400 /* 75 beats per minute */
+
+/* class MultiLeadECG */
+/* The multi-lead counterpart of ECG_Module: acquires blockFrames frames
+   of every lead at a time, as a DMA transfer from the front end would
+   deliver them, into one array per lead, and inserts the block into its
+   MultiLeadQueue. The simulated signal is a beat every
+   MULTILEADECG_BEAT_FRAMES frames, scaled differently on every lead. */
+typedef struct MultiLeadECG MultiLeadECG;
+
+struct MultiLeadECG {
+    int leads;
+    int blockFrames;
+    long timeCounter;
+    long* time;            /* the block being acquired */
+    int* value[MAX_LEADS];
+    struct MultiLeadQueue* itsMultiLeadQueue;
+};
+
+/* Constructors and destructors:*/
+/* 0 if leads is not 1 .. MAX_LEADS, blockFrames < 1 or out of memory */
+int MultiLeadECG_Init(MultiLeadECG* const me, int leads, int blockFrames);
+void MultiLeadECG_Cleanup(MultiLeadECG* const me);
+
+/* Operations */
+void MultiLeadECG_getDataBlock(MultiLeadECG* const me);
+
+struct MultiLeadQueue* MultiLeadECG_getItsMultiLeadQueue(const MultiLeadECG* const me);
+void MultiLeadECG_setItsMultiLeadQueue(MultiLeadECG* const me, struct MultiLeadQueue* p_MultiLeadQueue);
+
+MultiLeadECG* MultiLeadECG_Create(int leads, int blockFrames);
+void MultiLeadECG_Destroy(MultiLeadECG* const me);
+
+#endif
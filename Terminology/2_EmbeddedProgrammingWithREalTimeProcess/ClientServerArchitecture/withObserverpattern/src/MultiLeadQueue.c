@@ -0,0 +1,183 @@
+#define _POSIX_C_SOURCE 200809L
+#include "MultiLeadQueue.h"
+#include <string.h>
+
+#define MULTILEADQUEUE_FRAMES_PER_LINE (MULTILEADQUEUE_ALIGN / (int)sizeof(int))
+
+static void initRelations(MultiLeadQueue* const me);
+static void cleanUpRelations(MultiLeadQueue* const me);
+
+int MultiLeadQueue_Init(MultiLeadQueue* const me, int leads, int capacity) {
+    void* block;
+    int j;
+    me->leads = 0;
+    me->capacity = 0;
+    me->head = 0;
+    me->published = 0;
+    me->time = NULL;
+    for (j = 0; j < MAX_LEADS; j++) {
+        me->value[j] = NULL;
+    }
+    me->nSubscribers = 0;
+    initRelations(me);
+    if (leads < 1 || leads > MAX_LEADS || capacity < 1) {
+        return 0;
+    }
+    /* rounded up so that every lead's array starts aligned */
+    capacity = (capacity + MULTILEADQUEUE_FRAMES_PER_LINE - 1) / MULTILEADQUEUE_FRAMES_PER_LINE *
+               MULTILEADQUEUE_FRAMES_PER_LINE;
+    if (posix_memalign(&block, MULTILEADQUEUE_ALIGN, (size_t)capacity * sizeof(long)) != 0) {
+        return 0;
+    }
+    me->time = (long*)block;
+    if (posix_memalign(&block, MULTILEADQUEUE_ALIGN, (size_t)leads * capacity * sizeof(int)) != 0) {
+        return 0;
+    }
+    memset(block, 0, (size_t)leads * capacity * sizeof(int));
+    memset(me->time, 0, (size_t)capacity * sizeof(long));
+    for (j = 0; j < leads; j++) {
+        me->value[j] = (int*)block + (size_t)j * capacity;
+    }
+    me->leads = leads;
+    me->capacity = capacity;
+    return 1;
+}
+
+void MultiLeadQueue_Cleanup(MultiLeadQueue* const me) {
+    cleanUpRelations(me);
+    free(me->time);
+    free(me->value[0]); /* one block for every lead */
+}
+
+/* insert algorithm
+   the frames are copied one array at a time, each copy a run of
+   consecutive elements, in as many runs as it takes to go around the end
+   of the buffer; every run is then a block for the subscribers */
+void MultiLeadQueue_insert(MultiLeadQueue* const me, const long* time, const int* const* value,
+                           int frames) {
+    LeadBlock block;
+    const LeadNotificationHandle* pLNH;
+    const LeadNotificationHandle* end;
+    int j, n, done = 0;
+    block.leads = me->leads;
+    while (done < frames) {
+        n = me->capacity - me->head;
+        if (n > frames - done) {
+            n = frames - done;
+        }
+        memcpy(me->time + me->head, time + done, (size_t)n * sizeof(long));
+        for (j = 0; j < me->leads; j++) {
+            memcpy(me->value[j] + me->head, value[j] + done, (size_t)n * sizeof(int));
+            block.value[j] = me->value[j] + me->head;
+        }
+        block.time = me->time + me->head;
+        block.sequence = me->published;
+        block.frames = n;
+        me->head = me->head + n == me->capacity ? 0 : me->head + n;
+        me->published += n;
+        done += n;
+#ifndef NO_INSTRUMENTATION
+        printf("Inserting %d frames of %d leads at: %ld\n", n, me->leads, block.sequence);
+#endif
+        end = me->itsLeadNotificationHandle + me->nSubscribers;
+        for (pLNH = me->itsLeadNotificationHandle; pLNH != end; pLNH++) {
+            pLNH->updateAddr(pLNH->clientPtr, &block);
+        }
+    }
+}
+
+int MultiLeadQueue_getBlock(const MultiLeadQueue* const me, long sequence, int frames,
+                            LeadBlock* const block) {
+    int j, n, index;
+    if (sequence < 0 || sequence < me->published - me->capacity || sequence >= me->published) {
+        return 0;
+    }
+    index = (int)(sequence % me->capacity);
+    n = me->capacity - index;
+    if (n > me->published - sequence) {
+        n = (int)(me->published - sequence);
+    }
+    if (n > frames) {
+        n = frames;
+    }
+    block->sequence = sequence;
+    block->frames = n < 0 ? 0 : n;
+    block->leads = me->leads;
+    block->time = me->time + index;
+    for (j = 0; j < me->leads; j++) {
+        block->value[j] = me->value[j] + index;
+    }
+    return block->frames;
+}
+
+int MultiLeadQueue_subscribe(MultiLeadQueue* const me, const LeadBlockFuncPtr updateFuncAddr,
+                             void* clientPtr) {
+    int handle, index = me->nSubscribers;
+    if (index == MAX_SUBSCRIBERS) {
+        return -1;
+    }
+    handle = me->handleAt[index];
+    me->subscriberAt[handle] = index;
+    me->itsLeadNotificationHandle[index].updateAddr = updateFuncAddr;
+    me->itsLeadNotificationHandle[index].clientPtr = clientPtr;
+    ++me->nSubscribers;
+    return handle;
+}
+
+int MultiLeadQueue_unsubscribe(MultiLeadQueue* const me, int handle) {
+    int index, last;
+    if (handle < 0 || handle >= MAX_SUBSCRIBERS || me->subscriberAt[handle] >= me->nSubscribers) {
+        return 0;
+    }
+    last = --me->nSubscribers;
+    index = me->subscriberAt[handle];
+    /* the last subscriber moves into the hole, its handle with it */
+    me->itsLeadNotificationHandle[index] = me->itsLeadNotificationHandle[last];
+    me->handleAt[index] = me->handleAt[last];
+    me->subscriberAt[me->handleAt[index]] = index;
+    me->handleAt[last] = handle;
+    me->subscriberAt[handle] = last;
+    LeadNotificationHandle_Init(&me->itsLeadNotificationHandle[last]);
+    return 1;
+}
+
+int MultiLeadQueue_getLeads(const MultiLeadQueue* const me) {
+    return me->leads;
+}
+
+int MultiLeadQueue_getCapacity(const MultiLeadQueue* const me) {
+    return me->capacity;
+}
+
+long MultiLeadQueue_getPublished(const MultiLeadQueue* const me) {
+    return me->published;
+}
+
+MultiLeadQueue* MultiLeadQueue_Create(int leads, int capacity) {
+    MultiLeadQueue* me = (MultiLeadQueue*)malloc(sizeof(MultiLeadQueue));
+    if (me != NULL && !MultiLeadQueue_Init(me, leads, capacity)) {
+        MultiLeadQueue_Destroy(me);
+        me = NULL;
+    }
+    return me;
+}
+
+void MultiLeadQueue_Destroy(MultiLeadQueue* const me) {
+    if (me != NULL) {
+        MultiLeadQueue_Cleanup(me);
+    }
+    free(me);
+}
+
+static void initRelations(MultiLeadQueue* const me) {
+    int iter;
+    for (iter = 0; iter < MAX_SUBSCRIBERS; iter++) {
+        LeadNotificationHandle_Init(&me->itsLeadNotificationHandle[iter]);
+        me->subscriberAt[iter] = iter;
+        me->handleAt[iter] = iter;
+    }
+}
+
+static void cleanUpRelations(MultiLeadQueue* const me) {
+    me->nSubscribers = 0;
+}
@@ -0,0 +1,86 @@
+#ifndef MultiLeadQueue_H
+#define MultiLeadQueue_H
+
+#include <stdio.h>
+#include "ECGPkg.h"
+#include "NotificationHandle.h"
+
+/* the arrays are aligned to, and capacity rounded up to a multiple of,
+   64 bytes */
+#define MULTILEADQUEUE_ALIGN 64
+
+typedef struct LeadBlock LeadBlock;
+
+/* frames consecutive frames of every lead: lead j's samples are
+   value[j][0 .. frames - 1], taken at time[0 .. frames - 1] */
+struct LeadBlock {
+    long sequence; /* of the first frame */
+    int frames;
+    int leads;
+    const long* time;
+    const int* value[MAX_LEADS];
+};
+
+typedef struct MultiLeadQueue MultiLeadQueue;
+
+/*
+The multi-lead counterpart of TMDQueue: a leaky queue of frames, one
+sample of every lead at one time. Rather than a TimeMarkedData per
+sample, the timestamps are one array and every lead's samples another,
+so the frames of a time window are a run of consecutive elements in
+each array and a detector goes through every lead of the window with
+plain loops over arrays that the compiler can vectorize.
+
+Subscribers get each inserted run of frames as a LeadBlock pointing
+into the arrays, split in two where it wraps around the end. They are
+kept packed as in TMDQueue, with the same handle scheme.
+*/
+struct MultiLeadQueue {
+    int leads;
+    int capacity;   /* frames */
+    int head;       /* where the next frame goes */
+    long published; /* frames inserted; the next one's sequence number */
+    long* time;
+    int* value[MAX_LEADS]; /* capacity samples of each lead */
+    int nSubscribers;
+    struct LeadNotificationHandle itsLeadNotificationHandle[MAX_SUBSCRIBERS];
+    int subscriberAt[MAX_SUBSCRIBERS]; /* handle -> index in itsLeadNotificationHandle */
+    int handleAt[MAX_SUBSCRIBERS];     /* index -> handle */
+};
+
+/* Constructors and destructors:*/
+/* 0 if leads is not 1 .. MAX_LEADS, capacity < 1 or out of memory */
+int MultiLeadQueue_Init(MultiLeadQueue* const me, int leads, int capacity);
+void MultiLeadQueue_Cleanup(MultiLeadQueue* const me);
+
+/* Operations */
+
+/* appends frames frames: time[0 .. frames - 1], and value[j][0 ..
+   frames - 1] for lead j, then notifies the subscribers */
+void MultiLeadQueue_insert(MultiLeadQueue* const me, const long* time, const int* const* value,
+                           int frames);
+
+/* fills block with up to frames frames from sequence on, as many as are
+   in the queue without wrapping; returns how many, 0 if sequence has
+   been overwritten or not inserted yet */
+int MultiLeadQueue_getBlock(const MultiLeadQueue* const me, long sequence, int frames,
+                            LeadBlock* const block);
+
+/* insert() calls updateFuncAddr(clientPtr, block) for every run of frames;
+   returns the subscription's handle, or -1 if there are MAX_SUBSCRIBERS
+   already */
+int MultiLeadQueue_subscribe(MultiLeadQueue* const me, const LeadBlockFuncPtr updateFuncAddr,
+                             void* clientPtr);
+/* returns 0 if handle is not subscribed. Not to be called from inside
+   insert(). */
+int MultiLeadQueue_unsubscribe(MultiLeadQueue* const me, int handle);
+
+int MultiLeadQueue_getLeads(const MultiLeadQueue* const me);
+int MultiLeadQueue_getCapacity(const MultiLeadQueue* const me);
+long MultiLeadQueue_getPublished(const MultiLeadQueue* const me);
+
+/* NULL if the arguments are invalid (see Init) or out of memory */
+MultiLeadQueue* MultiLeadQueue_Create(int leads, int capacity);
+void MultiLeadQueue_Destroy(MultiLeadQueue* const me);
+
+#endif
@@ -1,22 +1,28 @@
 #include "NotificationHandle.h"
 
-static void cleanUpRelations(NotificationHandle* const me);
-
 void NotificationHandle_Init(NotificationHandle* const me) {
     me->updateAddr = NULL;
-    me->itsNotificationHandle = NULL;
+    me->clientPtr = NULL;
 }
  
 void NotificationHandle_Cleanup(NotificationHandle* const me) {
-    cleanUpRelations(me);
+    me->updateAddr = NULL;
+    me->clientPtr = NULL;
 }
 
-struct NotificationHandle* NotificationHandle_getItsNotificationHandle(const NotificationHandle* const me) {
-    return (struct NotificationHandle*)me->itsNotificationHandle;
+void BatchNotificationHandle_Init(BatchNotificationHandle* const me) {
+    me->updateAddr = NULL;
+    me->clientPtr = NULL;
+    me->batchSize = 1;
+    me->maxLatency = -1;
+    me->first = 0;
+    me->firstSeq = 0;
+    me->firstTime = 0;
 }
 
-void NotificationHandle_setItsNotificationHandle(NotificationHandle* const me, struct NotificationHandle* p_NotificationHandle) {
-    me->itsNotificationHandle = p_NotificationHandle;
+void LeadNotificationHandle_Init(LeadNotificationHandle* const me) {
+    me->updateAddr = NULL;
+    me->clientPtr = NULL;
 }
 
 NotificationHandle* NotificationHandle_Create(void) {
@@ -33,9 +39,3 @@ void NotificationHandle_Destroy(NotificationHandle* const me) {
     }
     free(me);
 }
-
-static void cleanUpRelations(NotificationHandle* const me) {
-    if (me->itsNotificationHandle != NULL) {
-        me->itsNotificationHandle = NULL;
-    }
-}
@@ -6,17 +6,42 @@
 
 typedef struct NotificationHandle NotificationHandle;
 
+/* one subscription: the client's update function and the client it is
+   called for */
 struct NotificationHandle {
     UpdateFuncPtr updateAddr;
-    struct NotificationHandle* itsNotificationHandle;
+    void* clientPtr;
+};
+
+typedef struct BatchNotificationHandle BatchNotificationHandle;
+
+/* one batch subscription: updateAddr gets the samples in spans of
+   batchSize, or fewer once the newest waiting sample is maxLatency (in
+   timeInterval units) after the oldest */
+struct BatchNotificationHandle {
+    BatchUpdateFuncPtr updateAddr;
+    void* clientPtr;
+    int batchSize;
+    long maxLatency; /* < 0 for no bound */
+    int first;       /* queue index of the oldest sample not yet delivered */
+    long firstSeq;   /* its sequence number */
+    long firstTime;  /* its timeInterval */
+};
+
+typedef struct LeadNotificationHandle LeadNotificationHandle;
+
+/* one subscription to a MultiLeadQueue */
+struct LeadNotificationHandle {
+    LeadBlockFuncPtr updateAddr;
+    void* clientPtr;
 };
 
 /* Constructors and destructors:*/
 void NotificationHandle_Init(NotificationHandle* const me);
 void NotificationHandle_Cleanup(NotificationHandle* const me);
 
-struct NotificationHandle* NotificationHandle_getItsNotificationHandle(const NotificationHandle* const me);
-void NotificationHandle_setItsNotificationHandle(NotificationHandle* const me, struct NotificationHandle* p_NotificationHandle);
+void BatchNotificationHandle_Init(BatchNotificationHandle* const me);
+void LeadNotificationHandle_Init(LeadNotificationHandle* const me);
 
 NotificationHandle* NotificationHandle_Create(void);
 void NotificationHandle_Destroy(NotificationHandle* const me);
@@ -1,27 +1,284 @@
 #include "QRSDetector.h"
 #include "TimeMarkedData.h"
 #include "TMDQueue.h"
+#include <string.h>
+
+#define QRSDETECTOR_MASK (QRSDETECTOR_HISTORY - 1)
 
 static void cleanUpRelations(QRSDetector* const me);
 
+/* the UpdateFuncPtr the queue calls, with this client as clientPtr */
+static void QRSDetector_notify(void* clientPtr, const struct TimeMarkedData tmd) {
+    QRSDetector_update((QRSDetector*)clientPtr, tmd);
+}
+
+static int QRSDetector_log2(long x) {
+    int shift = 0;
+    while (x > 1) {
+        x >>= 1;
+        shift++;
+    }
+    return shift;
+}
+
+/* the stage lengths of the 200 Hz original, scaled to sampleHz */
+static void QRSDetector_reset(QRSDetector* const me, int sampleHz) {
+    me->sampleHz = sampleHz;
+    me->lowPassLength = (6 * sampleHz + 100) / 200;
+    me->lowPassShift = QRSDetector_log2((long)me->lowPassLength * me->lowPassLength);
+    me->highPassLength = 2 * ((16 * sampleHz + 100) / 200);
+    me->highPassShift = QRSDetector_log2(me->highPassLength);
+    me->derivativeStep = (sampleHz + 100) / 200;
+    me->window = (150 * sampleHz + 500) / 1000;
+    me->delay = (me->lowPassLength - 1) + me->highPassLength / 2;
+    me->refractory = sampleHz / 5;
+    me->tWaveWindow = 360 * sampleHz / 1000;
+    me->settled = 2 * me->lowPassLength + me->highPassLength + 4 * me->derivativeStep + me->window;
+    me->learned = me->settled + 2 * sampleHz;
+
+    me->n = 0;
+    me->lowPass1 = 0;
+    me->lowPass2 = 0;
+    me->highPassSum = 0;
+    me->integral = 0;
+    memset(me->time, 0, sizeof(me->time));
+    memset(me->input, 0, sizeof(me->input));
+    memset(me->lowPass, 0, sizeof(me->lowPass));
+    memset(me->highPass, 0, sizeof(me->highPass));
+    memset(me->squared, 0, sizeof(me->squared));
+    me->rising = 0;
+    me->riseN = 0;
+    me->peak = 0;
+    me->peakN = 0;
+    me->peakSlope = 0;
+    me->peakAmplitude = 0;
+    me->peakTime = 0;
+    me->spki = 0;
+    me->npki = 0;
+    me->threshold1 = 0;
+    me->threshold2 = 0;
+    me->candidate = 0;
+    me->candidateN = 0;
+    me->candidateTime = 0;
+    me->candidateSlope = 0;
+    me->lastQRSN = -1;
+    me->lastQRSSlope = 0;
+    memset(me->rr, 0, sizeof(me->rr));
+    me->rrCount = 0;
+    me->rrNext = 0;
+    me->rrSum = 0;
+    me->rrMissed = 0;
+    me->beats = 0;
+    me->lastBeatTime = 0;
+}
+
 void QRSDetector_Init(QRSDetector* const me) {
     me->itsTMDQueue = NULL;
+    me->notificationHandle = -1;
+    me->beatAddr = NULL;
+    me->beatClientPtr = NULL;
+    QRSDetector_reset(me, 500);
 }
 
 void QRSDetector_Cleanup(QRSDetector* const me) {
     /* remove yourself from server subscription list */
     if (me->itsTMDQueue != NULL) {
-        TMDQueue_unsubscribe(me->itsTMDQueue, QRSDetector_update);
+        TMDQueue_unsubscribe(me->itsTMDQueue, me->notificationHandle);
     }
     cleanUpRelations(me);
 }
 
 void QRSDetector_update(QRSDetector* const me, const struct TimeMarkedData tmd) {
+#ifndef NO_INSTRUMENTATION
     printf(" QRS Detector -> TimeInterval: %ld DataValue: %d\n", tmd.timeInterval, tmd.dataValue);
+#endif
+    QRSDetector_detectQRS(me, tmd.timeInterval, tmd.dataValue);
+}
+
+static void QRSDetector_setThresholds(QRSDetector* const me) {
+    me->threshold1 = me->npki + ((me->spki - me->npki) >> 2);
+    me->threshold2 = me->threshold1 >> 1;
+}
+
+/* a QRS at sample peakN; also ends the search for a candidate */
+static void QRSDetector_beat(QRSDetector* const me, long peakN, long peakTime, long long slope) {
+    int rr;
+    if (me->lastQRSN >= 0) {
+        rr = (int)(peakN - me->lastQRSN);
+        if (me->rrCount == QRSDETECTOR_RR_COUNT) {
+            me->rrSum -= me->rr[me->rrNext];
+        } else {
+            me->rrCount++;
+        }
+        me->rr[me->rrNext] = rr;
+        me->rrSum += rr;
+        me->rrNext = (me->rrNext + 1) % QRSDETECTOR_RR_COUNT;
+        me->rrMissed = me->rrSum * 166 / (100 * me->rrCount);
+    }
+    me->lastQRSN = peakN;
+    me->lastQRSSlope = slope;
+    me->candidate = 0;
+    me->beats++;
+    me->lastBeatTime = peakTime;
+#ifndef NO_INSTRUMENTATION
+    printf(" QRS Detector -> QRS at TimeInterval: %ld\n", peakTime);
+#endif
+    if (me->beatAddr != NULL) {
+        me->beatAddr(me->beatClientPtr, peakTime);
+    }
+}
+
+/* thresholds algorithm
+   decides what the hump that just ended was */
+static void QRSDetector_classify(QRSDetector* const me) {
+    long since = me->peakN - me->lastQRSN;
+    boolean tWave;
+    if (me->riseN < me->learned || (me->lastQRSN >= 0 && since < me->refractory)) {
+        return;
+    }
+    tWave = me->lastQRSN >= 0 && since < me->tWaveWindow && me->peakSlope < me->lastQRSSlope / 2;
+    if (me->peak > me->threshold1 && !tWave) {
+        me->spki = (me->peak + 7 * me->spki) >> 3;
+        QRSDetector_beat(me, me->peakN, me->peakTime, me->peakSlope);
+    } else {
+        me->npki = (me->peak + 7 * me->npki) >> 3;
+        if (!tWave && me->peak > me->threshold2 && me->peak > me->candidate) {
+            me->candidate = me->peak;
+            me->candidateN = me->peakN;
+            me->candidateTime = me->peakTime;
+            me->candidateSlope = me->peakSlope;
+        }
+    }
+    QRSDetector_setThresholds(me);
+}
+
+/* Pan-Tompkins algorithm
+   one sample through every stage: each one reads its input history at
+   fixed offsets from n */
+static inline void QRSDetector_step(QRSDetector* const me, long timeInterval, int dataValue) {
+    const long n = me->n++;
+    const int i = (int)(n & QRSDETECTOR_MASK);
+    long lowPass;
+    int highPass;
+    long long derivative, squared, integral;
+
+    me->time[i] = timeInterval;
+    me->input[i] = dataValue;
+
+    /* low-pass: y(n) = 2y(n-1) - y(n-2) + x(n) - 2x(n-m) + x(n-2m) */
+    lowPass = 2 * me->lowPass1 - me->lowPass2 + dataValue -
+              2 * me->input[(n - me->lowPassLength) & QRSDETECTOR_MASK] +
+              me->input[(n - 2 * me->lowPassLength) & QRSDETECTOR_MASK];
+    me->lowPass2 = me->lowPass1;
+    me->lowPass1 = lowPass;
+    me->lowPass[i] = (int)(lowPass >> me->lowPassShift);
+
+    /* high-pass: the input half the length ago, less the average */
+    me->highPassSum += me->lowPass[i] - me->lowPass[(n - me->highPassLength) & QRSDETECTOR_MASK];
+    highPass = (int)(((long)me->lowPass[(n - me->highPassLength / 2) & QRSDETECTOR_MASK] *
+                          me->highPassLength - me->highPassSum) >> me->highPassShift);
+    me->highPass[i] = highPass;
+
+    /* derivative: (2x(n) + x(n-k) - x(n-3k) - 2x(n-4k)), then squared */
+    derivative = 2 * (long long)highPass +
+                 me->highPass[(n - me->derivativeStep) & QRSDETECTOR_MASK] -
+                 me->highPass[(n - 3 * me->derivativeStep) & QRSDETECTOR_MASK] -
+                 2 * (long long)me->highPass[(n - 4 * me->derivativeStep) & QRSDETECTOR_MASK];
+    squared = derivative * derivative;
+    me->squared[i] = squared;
+
+    /* moving-window integration */
+    integral = me->integral += squared - me->squared[(n - me->window) & QRSDETECTOR_MASK];
+
+    if (n < me->learned) {
+        /* learning: the largest and the average of the integral set the
+           initial levels */
+        if (n >= me->settled) {
+            if (integral > me->spki) {
+                me->spki = integral;
+            }
+            me->npki += integral;
+            if (n == me->learned - 1) {
+                me->spki /= 3;
+                me->npki = me->npki / (2 * (me->learned - me->settled));
+                QRSDetector_setThresholds(me);
+                /* a hump already under way is not looked at */
+                me->rising = integral > me->threshold2;
+                me->riseN = n;
+                me->peak = integral;
+            }
+        }
+        return;
+    }
+
+    /* the humps: climb to a peak, and once down to half of it, classify
+       it and wait for the next climb */
+    if (!me->rising) {
+        if (integral > me->peak) {
+            me->rising = 1;
+            me->riseN = n;
+            me->peakSlope = 0;
+            me->peakAmplitude = 0;
+        }
+    } else if (integral <= me->peak >> 1) {
+        QRSDetector_classify(me);
+        me->rising = 0;
+    }
+    if (me->rising) {
+        if (integral > me->peak) {
+            me->peak = integral;
+            me->peakN = n;
+        }
+        if (squared > me->peakSlope) {
+            me->peakSlope = squared;
+        }
+        if ((highPass < 0 ? -highPass : highPass) > me->peakAmplitude) {
+            me->peakAmplitude = highPass < 0 ? -highPass : highPass;
+            me->peakTime = me->time[(n - me->delay) & QRSDETECTOR_MASK];
+        }
+    } else {
+        me->peak = integral;
+    }
+
+    /* search back */
+    if (me->rrMissed > 0 && me->candidate > 0 && n - me->lastQRSN > me->rrMissed) {
+        me->spki = (me->candidate + 3 * me->spki) >> 2;
+        QRSDetector_beat(me, me->candidateN, me->candidateTime, me->candidateSlope);
+        QRSDetector_setThresholds(me);
+    }
+}
+
+void QRSDetector_detectQRS(QRSDetector* const me, long timeInterval, int dataValue) {
+    QRSDetector_step(me, timeInterval, dataValue);
+}
+
+void QRSDetector_detectBlock(QRSDetector* const me, const long* timeInterval, const int* dataValue,
+                             int count) {
+    int j;
+    for (j = 0; j < count; j++) {
+        QRSDetector_step(me, timeInterval[j], dataValue[j]);
+    }
+}
+
+int QRSDetector_setSampleRate(QRSDetector* const me, int sampleHz) {
+    if (sampleHz < QRSDETECTOR_MIN_HZ || sampleHz > QRSDETECTOR_MAX_HZ) {
+        return 0;
+    }
+    QRSDetector_reset(me, sampleHz);
+    return 1;
+}
+
+void QRSDetector_setBeatHandler(QRSDetector* const me, BeatFuncPtr beatFuncAddr, void* clientPtr) {
+    me->beatAddr = beatFuncAddr;
+    me->beatClientPtr = clientPtr;
+}
+
+long QRSDetector_getBeats(const QRSDetector* const me) {
+    return me->beats;
 }
 
-void QRSDetector_detectQRS(QRSDetector* const me) {
-    /* put some QRS detection algorithm here */
+long QRSDetector_getLastBeatTime(const QRSDetector* const me) {
+    return me->lastBeatTime;
 }
 
 struct TMDQueue* QRSDetector_getItsTMDQueue(const QRSDetector* const me) {
@@ -32,7 +289,7 @@ void QRSDetector_setItsTMDQueue(QRSDetector* const me, struct TMDQueue* p_TMDQue
     me->itsTMDQueue = p_TMDQueue;
     /* call subscribe to connect to the server */
     if (p_TMDQueue != NULL) {
-        TMDQueue_subscribe(me->itsTMDQueue, QRSDetector_update);
+        me->notificationHandle = TMDQueue_subscribe(me->itsTMDQueue, QRSDetector_notify, me);
     }
 }
 
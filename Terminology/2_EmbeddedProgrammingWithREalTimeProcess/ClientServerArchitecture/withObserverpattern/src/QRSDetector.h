@@ -6,11 +6,104 @@
 
 struct TMDQueue;
 
+/* sample rates the detector can be set to, in Hz */
+#define QRSDETECTOR_MIN_HZ 100
+#define QRSDETECTOR_MAX_HZ 1000
+/* samples each stage keeps; enough for every delay at QRSDETECTOR_MAX_HZ */
+#define QRSDETECTOR_HISTORY 256
+/* RR intervals averaged for the search back */
+#define QRSDETECTOR_RR_COUNT 8
+
+/* called for every beat with the timeInterval of its R wave */
+typedef void (*BeatFuncPtr)(void* clientPtr, long beatTime);
+
 /* class QRSDetector */
+/* Finds the QRS complexes in the samples as they arrive, with the
+   Pan-Tompkins algorithm:
+
+       band-pass      a low-pass and a high-pass that keep 5 - 11 Hz
+       derivative     the slope of the band-passed signal
+       squaring       makes every slope positive, the steep ones most
+       integration    a moving sum over 150 ms: one hump per QRS
+       thresholds     a hump is a QRS if it is above a threshold that
+                      follows the running levels of the QRS peaks (spki)
+                      and of the noise peaks (npki); the R wave is where
+                      the band-passed signal is largest on the climb
+
+   Each stage is a recursive filter or running sum over its own history
+   ring of QRSDETECTOR_HISTORY samples, so a sample costs the same small
+   amount of work however long the detector runs, and the memory is
+   fixed. The stage lengths are those of the 200 Hz original scaled to
+   the sample rate.
+
+   The decision rules are the original's:
+       - no QRS within 200 ms of the last one
+       - a hump within 360 ms of the last QRS with less than half its
+         slope is a T wave
+       - when no QRS turns up for 166% of the average RR interval, the
+         largest hump since the last QRS above half the threshold is
+         taken as one (search back)
+   The first two seconds after the filters have settled set the initial
+   levels. */
 typedef struct QRSDetector QRSDetector;
 
 struct QRSDetector {
     struct TMDQueue* itsTMDQueue;
+    int notificationHandle; /* our subscription to itsTMDQueue */
+    /* stage lengths, in samples, from the sample rate */
+    int sampleHz;
+    int lowPassLength;   /* the low-pass zeros are lowPassLength apart */
+    int lowPassShift;    /* scales its output back to the input's size */
+    int highPassLength;  /* the length of the average it subtracts */
+    int highPassShift;
+    int derivativeStep;
+    int window;          /* of the integration */
+    int delay;           /* from an R wave to the band-pass output's peak */
+    int refractory;
+    int tWaveWindow;
+    long settled;        /* samples before the filters have settled */
+    long learned;        /* ... and before the learning phase is over */
+    /* filter state */
+    long n;              /* samples so far */
+    long lowPass1;       /* the low-pass output, one and two samples ago */
+    long lowPass2;
+    long highPassSum;
+    long long integral;
+    long time[QRSDETECTOR_HISTORY];
+    int input[QRSDETECTOR_HISTORY];
+    int lowPass[QRSDETECTOR_HISTORY];
+    int highPass[QRSDETECTOR_HISTORY];
+    long long squared[QRSDETECTOR_HISTORY];
+    /* the hump being climbed */
+    boolean rising;
+    long riseN;          /* where the climb began */
+    long long peak;
+    long peakN;
+    long long peakSlope;
+    int peakAmplitude;   /* of the band-passed signal, where the R wave is */
+    long peakTime;       /* ... and when */
+    /* levels and thresholds */
+    long long spki;
+    long long npki;
+    long long threshold1;
+    long long threshold2;
+    /* the search back candidate, 0 if none */
+    long long candidate;
+    long candidateN;
+    long candidateTime;
+    long long candidateSlope;
+    /* the beats */
+    long lastQRSN;       /* < 0 before the first */
+    long long lastQRSSlope;
+    int rr[QRSDETECTOR_RR_COUNT];
+    int rrCount;
+    int rrNext;
+    long rrSum;
+    long rrMissed;       /* no QRS for this long: search back; 0 for never */
+    long beats;
+    long lastBeatTime;
+    BeatFuncPtr beatAddr;
+    void* beatClientPtr;
 };
 
 /* Constructors and destructors:*/
@@ -19,7 +112,18 @@ void QRSDetector_Cleanup(QRSDetector* const me);
 
 /* Operations */
 void QRSDetector_update(QRSDetector* const me, const struct TimeMarkedData tmd);
-void QRSDetector_detectQRS(QRSDetector* const me);
+/* takes the next sample */
+void QRSDetector_detectQRS(QRSDetector* const me, long timeInterval, int dataValue);
+/* takes count samples in a row, as a MultiLeadQueue lead gives them */
+void QRSDetector_detectBlock(QRSDetector* const me, const long* timeInterval, const int* dataValue,
+                             int count);
+/* forgets every sample and beat; returns 0 (and changes nothing) if
+   sampleHz is not QRSDETECTOR_MIN_HZ .. QRSDETECTOR_MAX_HZ. The rate is
+   500 Hz until set. */
+int QRSDetector_setSampleRate(QRSDetector* const me, int sampleHz);
+void QRSDetector_setBeatHandler(QRSDetector* const me, BeatFuncPtr beatFuncAddr, void* clientPtr);
+long QRSDetector_getBeats(const QRSDetector* const me);
+long QRSDetector_getLastBeatTime(const QRSDetector* const me);
 
 struct TMDQueue* QRSDetector_getItsTMDQueue(const QRSDetector* const me);
 void QRSDetector_setItsTMDQueue(QRSDetector* const me, struct TMDQueue* p_TMDQueue);
@@ -0,0 +1,105 @@
+#include "TMDCursor.h"
+#include "TMDQueue.h"
+#include <string.h>
+
+void TMDCursor_Init(TMDCursor* const me) {
+    me->itsTMDQueue = NULL;
+    me->sequence = 0;
+    me->gating = 0;
+    me->lost = 0;
+}
+
+void TMDCursor_Cleanup(TMDCursor* const me) {
+    if (me->itsTMDQueue != NULL) {
+        TMDQueue_detachCursor(me->itsTMDQueue, me);
+    }
+}
+
+static long TMDCursor_published(const TMDCursor* const me) {
+    return __atomic_load_n(&me->itsTMDQueue->published, __ATOMIC_ACQUIRE);
+}
+
+/* the cursor moves on: a gating cursor releases the samples to the
+   producer */
+static void TMDCursor_moveTo(TMDCursor* const me, long sequence) {
+    __atomic_store_n(&me->sequence, sequence, __ATOMIC_RELEASE);
+}
+
+/* read algorithm
+   a lapped cursor first skips to the oldest sample still kept. The
+   samples are copied, then the sequence is checked again: any that the
+   producer may have started to overwrite meanwhile are dropped and
+   counted as lost, like a seqlock reader retrying */
+int TMDCursor_read(TMDCursor* const me, struct TimeMarkedData* tmd, int max) {
+    const struct TimeMarkedData* buffer = me->itsTMDQueue->buffer;
+    long sequence = me->sequence;
+    long published = TMDCursor_published(me);
+    long oldest = published - (QUEUE_SIZE - 1);
+    int n, index, toEnd, stale;
+    if (sequence < oldest) {
+        me->lost += oldest - sequence;
+        sequence = oldest;
+    }
+    n = published - sequence < max ? (int)(published - sequence) : max;
+    if (n <= 0) {
+        TMDCursor_moveTo(me, sequence);
+        return 0;
+    }
+    index = (int)(sequence % QUEUE_SIZE);
+    toEnd = QUEUE_SIZE - index;
+    if (n <= toEnd) {
+        memcpy(tmd, &buffer[index], (size_t)n * sizeof(*tmd));
+    } else {
+        memcpy(tmd, &buffer[index], (size_t)toEnd * sizeof(*tmd));
+        memcpy(tmd + toEnd, &buffer[0], (size_t)(n - toEnd) * sizeof(*tmd));
+    }
+    if (!me->gating) {
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        stale = (int)(TMDCursor_published(me) - (QUEUE_SIZE - 1) - sequence);
+        if (stale > 0) {
+            stale = stale < n ? stale : n;
+            memmove(tmd, tmd + stale, (size_t)(n - stale) * sizeof(*tmd));
+            me->lost += stale;
+            sequence += stale;
+            n -= stale;
+        }
+    }
+    TMDCursor_moveTo(me, sequence + n);
+    return n;
+}
+
+int TMDCursor_peek(TMDCursor* const me, const struct TimeMarkedData** span) {
+    long available = TMDCursor_published(me) - me->sequence;
+    int index = (int)(me->sequence % QUEUE_SIZE);
+    int toEnd = QUEUE_SIZE - index;
+    *span = &me->itsTMDQueue->buffer[index];
+    return available < toEnd ? (int)available : toEnd;
+}
+
+void TMDCursor_consume(TMDCursor* const me, int count) {
+    TMDCursor_moveTo(me, me->sequence + count);
+}
+
+long TMDCursor_available(const TMDCursor* const me) {
+    long available = TMDCursor_published(me) - me->sequence;
+    return available < QUEUE_SIZE - 1 ? available : QUEUE_SIZE - 1;
+}
+
+struct TMDQueue* TMDCursor_getItsTMDQueue(const TMDCursor* const me) {
+    return (struct TMDQueue*)me->itsTMDQueue;
+}
+
+TMDCursor* TMDCursor_Create(void) {
+    TMDCursor* me = (TMDCursor*)malloc(sizeof(TMDCursor));
+    if (me != NULL) {
+        TMDCursor_Init(me);
+    }
+    return me;
+}
+
+void TMDCursor_Destroy(TMDCursor* const me) {
+    if (me != NULL) {
+        TMDCursor_Cleanup(me);
+    }
+    free(me);
+}
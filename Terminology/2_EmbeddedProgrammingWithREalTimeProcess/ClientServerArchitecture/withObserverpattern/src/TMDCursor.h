@@ -0,0 +1,58 @@
+#ifndef TMDCursor_H
+#define TMDCursor_H
+
+#include <stdio.h>
+#include "ECGPkg.h"
+#include "TimeMarkedData.h"
+
+struct TMDQueue;
+
+/* class TMDCursor */
+/* A client's own read position in a TMDQueue, for clients that pull
+   samples at their own pace (on their own thread, say) instead of being
+   pushed every sample by notify(). The cursor is the sequence number of
+   the next sample to read; the queue numbers samples as they are
+   inserted (published) and keeps the last QUEUE_SIZE - 1 of them.
+
+   A gating cursor holds the producer back: insert() waits rather than
+   overwrite a sample the cursor has not read, so nothing is lost. Any
+   other cursor is lapped when it falls behind: it skips to the oldest
+   sample still in the queue and counts the samples it missed in lost.
+   The producer looks only at the gating cursors, so a slow non-gating
+   reader never delays anybody else.
+
+   One thread reads through a cursor; the producer may be another. */
+typedef struct TMDCursor TMDCursor;
+
+struct TMDCursor {
+    struct TMDQueue* itsTMDQueue;
+    long sequence; /* the next sample to read */
+    boolean gating;
+    long lost;     /* samples overwritten before they were read */
+};
+
+/* Constructors and destructors:*/
+void TMDCursor_Init(TMDCursor* const me);
+void TMDCursor_Cleanup(TMDCursor* const me);
+
+/* Operations */
+
+/* copies up to max unread samples, oldest first, into tmd and moves past
+   them; returns how many */
+int TMDCursor_read(TMDCursor* const me, struct TimeMarkedData* tmd, int max);
+
+/* gating cursors only: points span at the unread samples in the queue
+   itself and returns how many there are in one piece (0 if none). They
+   stay put until consume() moves past them. */
+int TMDCursor_peek(TMDCursor* const me, const struct TimeMarkedData** span);
+void TMDCursor_consume(TMDCursor* const me, int count);
+
+/* unread samples */
+long TMDCursor_available(const TMDCursor* const me);
+
+struct TMDQueue* TMDCursor_getItsTMDQueue(const TMDCursor* const me);
+
+TMDCursor* TMDCursor_Create(void);
+void TMDCursor_Destroy(TMDCursor* const me);
+
+#endif
@@ -0,0 +1,279 @@
+#define _POSIX_C_SOURCE 200809L
+#include "TMDDispatcher.h"
+#include "TMDQueue.h"
+#include "RingBuffer.h"
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+
+RING_BUFFER_DEFINE(TMDJobRing, TMDWorker, TMDJob, jobs, TMDDISPATCHER_QUEUE_SIZE, RING_SPSC)
+
+/* jobs a worker takes from its ring at a time */
+#define TMDDISPATCHER_BATCH 64
+
+static long TMDDispatcher_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+/* latency histogram buckets: 0 .. 3 ns exactly, then four per power of
+   two, so a bucket is never wider than a quarter of its values */
+static int TMDDispatcher_bucket(long ns) {
+    int bit;
+    if (ns < 4) {
+        return ns < 0 ? 0 : (int)ns;
+    }
+    bit = 63 - __builtin_clzl((unsigned long)ns);
+    return (bit - 1) * 4 + (int)((ns >> (bit - 2)) & 3);
+}
+
+/* the largest latency in bucket */
+static long TMDDispatcher_bucketLimit(int bucket) {
+    int bit;
+    if (bucket < 4) {
+        return bucket;
+    }
+    bit = bucket / 4 + 1;
+    return ((long)(4 + bucket % 4 + 1) << (bit - 2)) - 1;
+}
+
+static void TMDWorker_Init(TMDWorker* const me, TMDDispatcher* dispatcher) {
+    me->itsTMDDispatcher = dispatcher;
+    me->nClients = 0;
+    me->head = me->tailCache = 0;
+    me->tail = me->headCache = 0;
+    memset(me->latency, 0, sizeof(me->latency));
+    me->maxLatency = 0;
+    me->sleeping = 0;
+    pthread_mutex_init(&me->mutex, NULL);
+    pthread_cond_init(&me->wake, NULL);
+}
+
+static void TMDWorker_Cleanup(TMDWorker* const me) {
+    pthread_mutex_destroy(&me->mutex);
+    pthread_cond_destroy(&me->wake);
+}
+
+/* sleeps until there is a job or the dispatcher stops. sleeping is set
+   before the ring is looked at, and the producer looks at sleeping after
+   it pushes, so one of them sees the other */
+static void TMDWorker_wait(TMDWorker* const me) {
+    pthread_mutex_lock(&me->mutex);
+    __atomic_store_n(&me->sleeping, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    while (TMDJobRing_isEmpty(me) && __atomic_load_n(&me->itsTMDDispatcher->running, __ATOMIC_ACQUIRE)) {
+        pthread_cond_wait(&me->wake, &me->mutex);
+    }
+    __atomic_store_n(&me->sleeping, 0, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&me->mutex);
+}
+
+static void TMDWorker_signal(TMDWorker* const me) {
+    pthread_mutex_lock(&me->mutex);
+    pthread_cond_signal(&me->wake);
+    pthread_mutex_unlock(&me->mutex);
+}
+
+/* worker algorithm
+   takes the jobs waiting, calls every client for each in turn, and
+   records how long after notify() each was done */
+static void* TMDWorker_run(void* arg) {
+    TMDWorker* const me = (TMDWorker*)arg;
+    TMDJob jobs[TMDDISPATCHER_BATCH];
+    const NotificationHandle* pNH;
+    const NotificationHandle* end = me->itsNotificationHandle + me->nClients;
+    long latency;
+    int n, j;
+    for (;;) {
+        n = TMDJobRing_popN(me, jobs, TMDDISPATCHER_BATCH);
+        if (n == 0) {
+            if (!__atomic_load_n(&me->itsTMDDispatcher->running, __ATOMIC_ACQUIRE) &&
+                TMDJobRing_isEmpty(me)) {
+                break;
+            }
+            TMDWorker_wait(me);
+            continue;
+        }
+        for (j = 0; j < n; j++) {
+            for (pNH = me->itsNotificationHandle; pNH != end; pNH++) {
+                pNH->updateAddr(pNH->clientPtr, jobs[j].tmd);
+            }
+            latency = TMDDispatcher_now() - jobs[j].notified;
+            me->latency[TMDDispatcher_bucket(latency)]++;
+            if (latency > me->maxLatency) {
+                me->maxLatency = latency;
+            }
+        }
+    }
+    return NULL;
+}
+
+int TMDDispatcher_Init(TMDDispatcher* const me, int nWorkers) {
+    void* block;
+    int j;
+    me->itsTMDQueue = NULL;
+    me->handle = -1;
+    me->nWorkers = nWorkers;
+    me->nClients = 0;
+    me->running = 0;
+    me->itsWorker = NULL;
+    if (posix_memalign(&block, 64, (size_t)nWorkers * sizeof(TMDWorker)) != 0) {
+        me->nWorkers = 0;
+        return 0;
+    }
+    me->itsWorker = (TMDWorker*)block;
+    for (j = 0; j < nWorkers; j++) {
+        TMDWorker_Init(&me->itsWorker[j], me);
+    }
+    return 1;
+}
+
+void TMDDispatcher_Cleanup(TMDDispatcher* const me) {
+    int j;
+    if (me->running) {
+        TMDDispatcher_stop(me);
+    }
+    for (j = 0; j < me->nWorkers; j++) {
+        TMDWorker_Cleanup(&me->itsWorker[j]);
+    }
+    free(me->itsWorker);
+    me->itsWorker = NULL;
+}
+
+int TMDDispatcher_subscribe(TMDDispatcher* const me, const UpdateFuncPtr updateFuncAddr, void* clientPtr) {
+    int worker = me->nClients % me->nWorkers;
+    TMDWorker* pW = &me->itsWorker[worker];
+    if (me->running || pW->nClients == MAX_SUBSCRIBERS) {
+        return -1;
+    }
+    pW->itsNotificationHandle[pW->nClients].updateAddr = updateFuncAddr;
+    pW->itsNotificationHandle[pW->nClients].clientPtr = clientPtr;
+    pW->nClients++;
+    me->nClients++;
+    return worker;
+}
+
+/* stops the first n workers once they have run out of jobs */
+static void TMDDispatcher_join(TMDDispatcher* const me, int n) {
+    int j;
+    __atomic_store_n(&me->running, 0, __ATOMIC_RELEASE);
+    for (j = 0; j < n; j++) {
+        TMDWorker_signal(&me->itsWorker[j]);
+    }
+    for (j = 0; j < n; j++) {
+        pthread_join(me->itsWorker[j].thread, NULL);
+    }
+}
+
+int TMDDispatcher_start(TMDDispatcher* const me, struct TMDQueue* queue) {
+    int j;
+    if (me->running) {
+        return 0;
+    }
+    __atomic_store_n(&me->running, 1, __ATOMIC_RELEASE);
+    for (j = 0; j < me->nWorkers; j++) {
+        if (pthread_create(&me->itsWorker[j].thread, NULL, TMDWorker_run, &me->itsWorker[j]) != 0) {
+            TMDDispatcher_join(me, j);
+            return 0;
+        }
+    }
+    me->itsTMDQueue = queue;
+    me->handle = TMDQueue_subscribe(queue, TMDDispatcher_notify, me);
+    return 1;
+}
+
+void TMDDispatcher_stop(TMDDispatcher* const me) {
+    if (!me->running) {
+        return;
+    }
+    if (me->itsTMDQueue != NULL) {
+        TMDQueue_unsubscribe(me->itsTMDQueue, me->handle);
+        me->itsTMDQueue = NULL;
+        me->handle = -1;
+    }
+    TMDDispatcher_join(me, me->nWorkers);
+}
+
+/* notify algorithm
+   one copy of the sample per worker; a full ring makes the producer
+   yield until the worker catches up */
+void TMDDispatcher_notify(void* clientPtr, const struct TimeMarkedData tmd) {
+    TMDDispatcher* const me = (TMDDispatcher*)clientPtr;
+    TMDJob job;
+    TMDWorker* pW;
+    int j;
+    job.tmd = tmd;
+    job.notified = TMDDispatcher_now();
+    for (j = 0; j < me->nWorkers; j++) {
+        pW = &me->itsWorker[j];
+        while (!TMDJobRing_push(pW, &job)) {
+            sched_yield();
+        }
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&pW->sleeping, __ATOMIC_RELAXED)) {
+            TMDWorker_signal(pW);
+        }
+    }
+}
+
+long TMDDispatcher_getNotified(const TMDDispatcher* const me) {
+    long n = 0;
+    int j, b;
+    for (j = 0; j < me->nWorkers; j++) {
+        for (b = 0; b < TMDDISPATCHER_LATENCY_BUCKETS; b++) {
+            n += me->itsWorker[j].latency[b];
+        }
+    }
+    return me->nWorkers > 0 ? n / me->nWorkers : 0;
+}
+
+long TMDDispatcher_getLatency(const TMDDispatcher* const me, double fraction) {
+    long total = 0, count = 0;
+    int j, b;
+    for (j = 0; j < me->nWorkers; j++) {
+        for (b = 0; b < TMDDISPATCHER_LATENCY_BUCKETS; b++) {
+            total += me->itsWorker[j].latency[b];
+        }
+    }
+    for (b = 0; b < TMDDISPATCHER_LATENCY_BUCKETS; b++) {
+        for (j = 0; j < me->nWorkers; j++) {
+            count += me->itsWorker[j].latency[b];
+        }
+        if (count > 0 && count >= fraction * total) {
+            return TMDDispatcher_bucketLimit(b);
+        }
+    }
+    return 0;
+}
+
+long TMDDispatcher_getMaxLatency(const TMDDispatcher* const me) {
+    long max = 0;
+    int j;
+    for (j = 0; j < me->nWorkers; j++) {
+        if (me->itsWorker[j].maxLatency > max) {
+            max = me->itsWorker[j].maxLatency;
+        }
+    }
+    return max;
+}
+
+TMDDispatcher* TMDDispatcher_Create(int nWorkers) {
+    TMDDispatcher* me;
+    if (nWorkers < 1) {
+        return NULL;
+    }
+    me = (TMDDispatcher*)malloc(sizeof(TMDDispatcher));
+    if (me != NULL && !TMDDispatcher_Init(me, nWorkers)) {
+        TMDDispatcher_Destroy(me);
+        me = NULL;
+    }
+    return me;
+}
+
+void TMDDispatcher_Destroy(TMDDispatcher* const me) {
+    if (me != NULL) {
+        TMDDispatcher_Cleanup(me);
+    }
+    free(me);
+}
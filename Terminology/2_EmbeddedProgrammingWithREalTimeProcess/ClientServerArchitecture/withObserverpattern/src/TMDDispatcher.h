@@ -0,0 +1,101 @@
+#ifndef TMDDispatcher_H
+#define TMDDispatcher_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include "ECGPkg.h"
+#include "TimeMarkedData.h"
+#include "NotificationHandle.h"
+
+struct TMDQueue;
+
+/* samples a worker can have waiting, a power of two */
+#define TMDDISPATCHER_QUEUE_SIZE 1024
+#define TMDDISPATCHER_CACHE_ALIGNED __attribute__((aligned(64)))
+/* latency histogram: four buckets per power of two nanoseconds */
+#define TMDDISPATCHER_LATENCY_BUCKETS 256
+
+/* class TMDDispatcher */
+/* Calls its clients' update functions on a fixed pool of worker
+   threads instead of the producer's. The dispatcher subscribes to a
+   TMDQueue like any client; notify() only copies the sample, stamped
+   with the time, into each worker's single-producer single-consumer
+   ring, and wakes the worker if it sleeps.
+
+   Every client belongs to one worker, which calls it for the samples in
+   the order they were inserted, so each client still sees an ordered
+   stream; clients on different workers run in parallel. A worker whose
+   ring is full holds the producer back rather than drop a sample.
+
+   Each worker records the latency from notify() to the end of its
+   clients' update calls, which getLatency() reports once the dispatcher
+   has stopped. */
+typedef struct TMDJob TMDJob;
+struct TMDJob {
+    struct TimeMarkedData tmd;
+    long notified; /* ns, CLOCK_MONOTONIC */
+};
+
+typedef struct TMDWorker TMDWorker;
+struct TMDWorker {
+    struct TMDDispatcher* itsTMDDispatcher;
+    pthread_t thread;
+    int nClients;
+    struct NotificationHandle itsNotificationHandle[MAX_SUBSCRIBERS];
+    /* producer side */
+    TMDDISPATCHER_CACHE_ALIGNED int head;
+    int tailCache;
+    /* worker side */
+    TMDDISPATCHER_CACHE_ALIGNED int tail;
+    int headCache;
+    long latency[TMDDISPATCHER_LATENCY_BUCKETS]; /* samples by latency bucket */
+    long maxLatency;
+    /* a worker with nothing to do sleeps on wake, with sleeping set */
+    TMDDISPATCHER_CACHE_ALIGNED int sleeping;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    TMDJob jobs[TMDDISPATCHER_QUEUE_SIZE];
+};
+
+typedef struct TMDDispatcher TMDDispatcher;
+struct TMDDispatcher {
+    struct TMDQueue* itsTMDQueue;
+    int handle;  /* the dispatcher's subscription to itsTMDQueue */
+    int nWorkers;
+    int nClients;
+    int running;
+    TMDWorker* itsWorker;
+};
+
+/* Constructors and destructors:*/
+int TMDDispatcher_Init(TMDDispatcher* const me, int nWorkers);
+void TMDDispatcher_Cleanup(TMDDispatcher* const me);
+
+/* Operations */
+
+/* adds a client, before start(); clients go to the workers in turn.
+   Returns the client's worker, or -1 if the workers are full. */
+int TMDDispatcher_subscribe(TMDDispatcher* const me, const UpdateFuncPtr updateFuncAddr, void* clientPtr);
+
+/* starts the workers and subscribes to queue; returns 0 if a thread
+   could not be started */
+int TMDDispatcher_start(TMDDispatcher* const me, struct TMDQueue* queue);
+
+/* unsubscribes, lets the workers finish the samples they have, and
+   stops them; to be called on the producer's thread */
+void TMDDispatcher_stop(TMDDispatcher* const me);
+
+/* the UpdateFuncPtr the dispatcher subscribes with */
+void TMDDispatcher_notify(void* clientPtr, const struct TimeMarkedData tmd);
+
+/* after stop(): samples dispatched, and the latency (ns) that fraction
+   of them stayed under, such as 0.99 */
+long TMDDispatcher_getNotified(const TMDDispatcher* const me);
+long TMDDispatcher_getLatency(const TMDDispatcher* const me, double fraction);
+long TMDDispatcher_getMaxLatency(const TMDDispatcher* const me);
+
+/* NULL if nWorkers < 1 or out of memory */
+TMDDispatcher* TMDDispatcher_Create(int nWorkers);
+void TMDDispatcher_Destroy(TMDDispatcher* const me);
+
+#endif
@@ -1,36 +1,86 @@
+#define _POSIX_C_SOURCE 200809L
 #include "TMDQueue.h"
 #include "NotificationHandle.h"
+#include "RingBuffer.h"
+#include <limits.h>
+#include <sched.h>
 
 static void initRelations(TMDQueue* const me);
 static void cleanUpRelations(TMDQueue* const me);
 
+RING_BUFFER_DEFINE(TMDRing, TMDQueue, struct TimeMarkedData, buffer, QUEUE_SIZE, RING_UNLOCKED)
+
 void TMDQueue_Init(TMDQueue* const me) {
     me->head = 0;
+    me->tail = 0;
     me->nSubscribers = 0;
+    me->nBatchSubscribers = 0;
+    me->batchSeq = 0;
+    me->batchDueSeq = LONG_MAX;
+    me->batchDueTime = LONG_MAX;
+    me->batchStarting = 0;
+    me->published = 0;
+    me->gateSequence = LONG_MAX;
+    me->nGatingCursors = 0;
+    pthread_mutex_init(&me->cursorLock, NULL);
     me->size = 0;
-    me->itsNotificationHandle = NULL;
     initRelations(me);
 }
 
 void TMDQueue_Cleanup(TMDQueue* const me) {
     cleanUpRelations(me);
+    pthread_mutex_destroy(&me->cursorLock);
 }
 
 int TMDQueue_getNextIndex(TMDQueue* const me, int index) {
-    /* this operation computes the next index from the first using modulo arithmetic */
-    return (index + 1) % QUEUE_SIZE;
+    /* this operation computes the next index from the first */
+    return TMDRing_next(me, index);
+}
+
+/* waits until every gating cursor has read the sample the next insert
+   drops, so that the last QUEUE_SIZE - 1 samples stay readable. The
+   cursors are only looked at under cursorLock, so none of them can be
+   detached (and freed) meanwhile. */
+static void TMDQueue_waitForCursors(TMDQueue* const me) {
+    long needed = me->published + 1 - (QUEUE_SIZE - 1);
+    long sequence, gate;
+    int j;
+    while (__atomic_load_n(&me->gateSequence, __ATOMIC_ACQUIRE) < needed) {
+        pthread_mutex_lock(&me->cursorLock);
+        gate = LONG_MAX;
+        for (j = 0; j < me->nGatingCursors; j++) {
+            sequence = __atomic_load_n(&me->itsGatingCursor[j]->sequence, __ATOMIC_ACQUIRE);
+            if (sequence < gate) {
+                gate = sequence;
+            }
+        }
+        __atomic_store_n(&me->gateSequence, gate, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&me->cursorLock);
+        if (gate < needed) {
+            sched_yield();
+        }
+    }
 }
 
 void TMDQueue_insert(TMDQueue* const me, const struct TimeMarkedData tmd) {
     /* note that because we never 'remove' data from this leaky queue, size only increases to
     the queue size and then stops increasing. Insertion always takes place at the head. */
+#ifndef NO_INSTRUMENTATION
     printf("Inserting at: %d Data #: %ld", me->head, tmd.timeInterval);
+#endif
     
-    me->buffer[me->head] = tmd;
-    me->head = TMDQueue_getNextIndex(me, me->head);
-    if (me->size < QUEUE_SIZE) ++me->size;
+    if (__atomic_load_n(&me->nGatingCursors, __ATOMIC_ACQUIRE) > 0) {
+        TMDQueue_waitForCursors(me);
+    }
+    /* cursors learn a slot is changing from published, before it changes */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    TMDRing_pushOverwrite(me, &tmd);
+    __atomic_store_n(&me->published, me->published + 1, __ATOMIC_RELEASE);
+    if (me->size < TMDRing_capacity(me)) ++me->size; /* one slot is always free */
     
+#ifndef NO_INSTRUMENTATION
     printf(" Storing data value: %d\n", tmd.dataValue);
+#endif
     TMDQueue_notify(me, tmd);
 }
 
@@ -38,88 +88,241 @@ boolean TMDQueue_isEmpty(TMDQueue* const me) {
     return (boolean)(me->size == 0);
 }
 
+/* hands a batch subscriber the samples since its last batch, in two
+   spans if they wrap around the end of the buffer; its next span starts
+   with the next sample */
+static void TMDQueue_deliver(TMDQueue* const me, BatchNotificationHandle* const pBNH) {
+    int pending = (int)(me->batchSeq - pBNH->firstSeq);
+    int toEnd = QUEUE_SIZE - pBNH->first;
+    if (pending <= toEnd) {
+        pBNH->updateAddr(pBNH->clientPtr, &me->buffer[pBNH->first], pending);
+    } else {
+        pBNH->updateAddr(pBNH->clientPtr, &me->buffer[pBNH->first], toEnd);
+        pBNH->updateAddr(pBNH->clientPtr, &me->buffer[0], pending - toEnd);
+    }
+    pBNH->first = me->head;
+    pBNH->firstSeq = me->batchSeq;
+}
+
+/* finds when the next batch is due */
+static void TMDQueue_scheduleBatch(TMDQueue* const me) {
+    const BatchNotificationHandle* pBNH = me->itsBatchNotificationHandle;
+    const BatchNotificationHandle* end = pBNH + me->nBatchSubscribers;
+    long dueSeq = LONG_MAX, dueTime = LONG_MAX;
+    int starting = 0;
+    for (; pBNH != end; pBNH++) {
+        if (pBNH->firstSeq + pBNH->batchSize < dueSeq) {
+            dueSeq = pBNH->firstSeq + pBNH->batchSize;
+        }
+        if (pBNH->maxLatency >= 0) {
+            if (pBNH->firstSeq == me->batchSeq) {
+                starting = 1; /* its time bound is not known yet */
+            } else if (pBNH->firstTime + pBNH->maxLatency < dueTime) {
+                dueTime = pBNH->firstTime + pBNH->maxLatency;
+            }
+        }
+    }
+    me->batchDueSeq = dueSeq;
+    me->batchDueTime = dueTime;
+    me->batchStarting = starting;
+}
+
+/* notify algorithm (batch)
+   the sample just inserted joins every batch subscriber's pending span;
+   until a batch is due there is nothing else to do */
+static void TMDQueue_notifyBatch(TMDQueue* const me, const struct TimeMarkedData tmd) {
+    BatchNotificationHandle* pBNH = me->itsBatchNotificationHandle;
+    BatchNotificationHandle* end = pBNH + me->nBatchSubscribers;
+    long seq = me->batchSeq++;
+    if (me->batchSeq < me->batchDueSeq && tmd.timeInterval < me->batchDueTime && !me->batchStarting) {
+        return;
+    }
+    for (; pBNH != end; pBNH++) {
+        if (pBNH->firstSeq == seq) {
+            pBNH->firstTime = tmd.timeInterval;
+        }
+        if (me->batchSeq - pBNH->firstSeq >= pBNH->batchSize ||
+            (pBNH->maxLatency >= 0 && tmd.timeInterval - pBNH->firstTime >= pBNH->maxLatency)) {
+            TMDQueue_deliver(me, pBNH);
+        }
+    }
+    TMDQueue_scheduleBatch(me);
+}
+
 void TMDQueue_notify(TMDQueue* const me, const struct TimeMarkedData tmd) {
-    NotificationHandle* pNH;
-    pNH = me->itsNotificationHandle;
-    while (pNH) {
-        printf("----->> calling updateAddr on pNH %p\n", (void*)pNH);
-        pNH->updateAddr(NULL, tmd);
-        pNH = pNH->itsNotificationHandle;
+    const NotificationHandle* pNH = me->itsNotificationHandle;
+    const NotificationHandle* end = pNH + me->nSubscribers;
+    for (; pNH != end; pNH++) {
+#ifndef NO_INSTRUMENTATION
+        printf("----->> calling updateAddr on pNH %p\n", (const void*)pNH);
+#endif
+        pNH->updateAddr(pNH->clientPtr, tmd);
+    }
+    if (me->nBatchSubscribers > 0) {
+        TMDQueue_notifyBatch(me, tmd);
     }
 }
 
+void TMDQueue_flush(TMDQueue* const me) {
+    int j;
+    for (j = 0; j < me->nBatchSubscribers; j++) {
+        if (me->itsBatchNotificationHandle[j].firstSeq != me->batchSeq) {
+            TMDQueue_deliver(me, &me->itsBatchNotificationHandle[j]);
+        }
+    }
+    TMDQueue_scheduleBatch(me);
+}
+
+/* index is a slot of the buffer; only the slots from tail up to head
+   hold samples, the free slot at head holds one already overwritten */
 struct TimeMarkedData TMDQueue_remove(TMDQueue* const me, int index) {
     TimeMarkedData tmd;
     tmd.timeInterval = -1; /* sentinel values */
     tmd.dataValue = -9999;
-    if (!TMDQueue_isEmpty(me) && (index >= 0) && (index < QUEUE_SIZE) && (index < me->size)) {
+    if (!TMDQueue_isEmpty(me) && (index >= 0) && (index < QUEUE_SIZE) &&
+        (index - me->tail + QUEUE_SIZE) % QUEUE_SIZE < me->size) {
         tmd = me->buffer[index];
     }
     return tmd;
 }
 
-void TMDQueue_subscribe(TMDQueue* const me, const UpdateFuncPtr updateFuncAddr) {
-    struct NotificationHandle* pNH;
-    pNH = me->itsNotificationHandle;
-    if (!pNH) { /* empty list? */
-        /* create a new Notification Handle, initialize it, and point to it */
-        printf("-----> Added to a new list\n");
-        me->itsNotificationHandle = NotificationHandle_Create();
-        printf("-----> Called NH_Create()\n");
-        pNH = me->itsNotificationHandle;
-    } else {
-        /* search list to find end */
-        printf("-----> Adding to an existing list\n");
-        while (pNH->itsNotificationHandle != NULL) {
-            printf("Getting ready to augment ptr %p to %p\n", (void*)pNH, (void*)pNH->itsNotificationHandle);
-            pNH = pNH->itsNotificationHandle; /* get next element in list */
-            printf("-----> augmenting ptr\n");
-        }
-        printf("-----> calling NH_Create\n");
-        pNH->itsNotificationHandle = NotificationHandle_Create();
-        pNH = pNH->itsNotificationHandle; /* pt to the new instance */
-        printf("-----> called NH_Create()\n");
+/* handle bookkeeping, the same for both kinds of subscriber: takes the
+   handle of subscriber index, which must be the first free one */
+static int TMDQueue_takeHandle(int* const subscriberAt, const int* const handleAt, int index) {
+    int handle = handleAt[index];
+    subscriberAt[handle] = index;
+    return handle;
+}
+
+/* frees handle by swapping it with the handle of the last subscriber;
+   returns the index the last subscriber has to move to */
+static int TMDQueue_releaseHandle(int* const subscriberAt, int* const handleAt, int last, int handle) {
+    int index = subscriberAt[handle];
+    int lastHandle = handleAt[last];
+    handleAt[index] = lastHandle;
+    subscriberAt[lastHandle] = index;
+    handleAt[last] = handle;
+    subscriberAt[handle] = last;
+    return index;
+}
+
+int TMDQueue_subscribe(TMDQueue* const me, const UpdateFuncPtr updateFuncAddr, void* clientPtr) {
+    int handle, index = me->nSubscribers;
+    if (index == MAX_SUBSCRIBERS) {
+#ifndef NO_INSTRUMENTATION
+        printf("-----> Subscriber list full\n");
+#endif
+        return -1;
     }
-    /* pNH now points to an constructed Notification Handle */
-    pNH->updateAddr = updateFuncAddr; /* set callback address */
+    handle = TMDQueue_takeHandle(me->subscriberAt, me->handleAt, index);
+    me->itsNotificationHandle[index].updateAddr = updateFuncAddr;
+    me->itsNotificationHandle[index].clientPtr = clientPtr;
     ++me->nSubscribers;
-    printf("-----> wrote updateAddr \n");
-    
-    if (pNH->itsNotificationHandle)
-        printf("xxxxxxx> next Ptr not null!\n\n");
-    else
-        printf("-----> next ptr null\n\n");
-}
-
-int TMDQueue_unsubscribe(TMDQueue* const me, const UpdateFuncPtr updateFuncAddr) {
-    struct NotificationHandle *pNH, *pBack;
-    pNH = pBack = me->itsNotificationHandle;
-    if (pNH == NULL) { /* empty list? */
-        return 0; /* can't delete it from an empty list */
-    } else { /* is it the first one? */
-        if (pNH->updateAddr == updateFuncAddr) {
-            me->itsNotificationHandle = pNH->itsNotificationHandle;
-            NotificationHandle_Destroy(pNH);
-            printf(">>>>>> Removing the first element\n");
-            --me->nSubscribers;
-            return 1;
-        } else { /* search list to find element */
-            printf(">>>>>> Searching....\n");
-            while (pNH != NULL) {
-                if (pNH->updateAddr == updateFuncAddr) {
-                    pBack->itsNotificationHandle = pNH->itsNotificationHandle;
-                    NotificationHandle_Destroy(pNH);
-                    printf(">>>>>> Removing subscriber in list\n");
-                    --me->nSubscribers;
-                    return 1;
-                }
-                pBack = pNH; /* points to the list element before pNH */
-                pNH = pNH->itsNotificationHandle; /* get next element in list */
-            }
-        }
+#ifndef NO_INSTRUMENTATION
+    printf("-----> Added subscriber %d\n", handle);
+#endif
+    return handle;
+}
+
+int TMDQueue_subscribeBatch(TMDQueue* const me, const BatchUpdateFuncPtr updateFuncAddr,
+                            void* clientPtr, int batchSize, long maxLatency) {
+    BatchNotificationHandle* pBNH;
+    int handle, index = me->nBatchSubscribers;
+    if (index == MAX_SUBSCRIBERS) {
+#ifndef NO_INSTRUMENTATION
+        printf("-----> Batch subscriber list full\n");
+#endif
+        return -1;
+    }
+    /* a pending span must not be overwritten before it is delivered */
+    if (batchSize < 1) {
+        batchSize = 1;
+    } else if (batchSize > QUEUE_SIZE - 1) {
+        batchSize = QUEUE_SIZE - 1;
+    }
+    handle = TMDQueue_takeHandle(me->batchSubscriberAt, me->batchHandleAt, index);
+    pBNH = &me->itsBatchNotificationHandle[index];
+    BatchNotificationHandle_Init(pBNH);
+    pBNH->updateAddr = updateFuncAddr;
+    pBNH->clientPtr = clientPtr;
+    pBNH->batchSize = batchSize;
+    pBNH->maxLatency = maxLatency;
+    pBNH->first = me->head;
+    pBNH->firstSeq = me->batchSeq;
+    ++me->nBatchSubscribers;
+    TMDQueue_scheduleBatch(me);
+#ifndef NO_INSTRUMENTATION
+    printf("-----> Added batch subscriber %d\n", MAX_SUBSCRIBERS + handle);
+#endif
+    return MAX_SUBSCRIBERS + handle;
+}
+
+int TMDQueue_unsubscribe(TMDQueue* const me, int handle) {
+    int index, last;
+    if (handle >= 0 && handle < MAX_SUBSCRIBERS && me->subscriberAt[handle] < me->nSubscribers) {
+        last = --me->nSubscribers;
+        index = TMDQueue_releaseHandle(me->subscriberAt, me->handleAt, last, handle);
+        me->itsNotificationHandle[index] = me->itsNotificationHandle[last];
+        NotificationHandle_Init(&me->itsNotificationHandle[last]);
+    } else if (handle >= MAX_SUBSCRIBERS && handle < 2 * MAX_SUBSCRIBERS &&
+               me->batchSubscriberAt[handle - MAX_SUBSCRIBERS] < me->nBatchSubscribers) {
+        last = --me->nBatchSubscribers;
+        index = TMDQueue_releaseHandle(me->batchSubscriberAt, me->batchHandleAt, last,
+                                       handle - MAX_SUBSCRIBERS);
+        me->itsBatchNotificationHandle[index] = me->itsBatchNotificationHandle[last];
+        BatchNotificationHandle_Init(&me->itsBatchNotificationHandle[last]);
+        TMDQueue_scheduleBatch(me);
+    } else {
+#ifndef NO_INSTRUMENTATION
         printf(">>>>>> Didn't remove any subscribers\n");
+#endif
         return 0;
     }
+#ifndef NO_INSTRUMENTATION
+    printf(">>>>>> Removed subscriber %d\n", handle);
+#endif
+    return 1;
+}
+
+/* attachCursor algorithm
+   the cursor is set up first and only then entered in the table; the
+   gate is lowered to it under cursorLock, so either the producer's next
+   look at the cursors sees it, or the lowered gate makes it look again */
+int TMDQueue_attachCursor(TMDQueue* const me, struct TMDCursor* cursor, boolean gating) {
+    long published;
+    pthread_mutex_lock(&me->cursorLock);
+    if (gating && me->nGatingCursors == MAX_SUBSCRIBERS) {
+        pthread_mutex_unlock(&me->cursorLock);
+        return 0;
+    }
+    published = __atomic_load_n(&me->published, __ATOMIC_ACQUIRE);
+    cursor->itsTMDQueue = me;
+    cursor->sequence = published;
+    cursor->gating = gating;
+    cursor->lost = 0;
+    if (gating) {
+        me->itsGatingCursor[me->nGatingCursors] = cursor;
+        __atomic_store_n(&me->nGatingCursors, me->nGatingCursors + 1, __ATOMIC_RELEASE);
+        if (published < me->gateSequence) {
+            __atomic_store_n(&me->gateSequence, published, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&me->cursorLock);
+    return 1;
+}
+
+void TMDQueue_detachCursor(TMDQueue* const me, struct TMDCursor* cursor) {
+    int j;
+    pthread_mutex_lock(&me->cursorLock);
+    for (j = 0; j < me->nGatingCursors; j++) {
+        if (me->itsGatingCursor[j] == cursor) {
+            me->itsGatingCursor[j] = me->itsGatingCursor[me->nGatingCursors - 1];
+            __atomic_store_n(&me->nGatingCursors, me->nGatingCursors - 1, __ATOMIC_RELEASE);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&me->cursorLock);
+    cursor->itsTMDQueue = NULL;
 }
 
 int TMDQueue_getBuffer(const TMDQueue* const me) {
@@ -127,12 +330,8 @@ int TMDQueue_getBuffer(const TMDQueue* const me) {
     return iter;
 }
 
-struct NotificationHandle* TMDQueue_getItsNotificationHandle(const TMDQueue* const me) {
-    return (struct NotificationHandle*)me->itsNotificationHandle;
-}
-
-void TMDQueue_setItsNotificationHandle(TMDQueue* const me, struct NotificationHandle* p_NotificationHandle) {
-    me->itsNotificationHandle = p_NotificationHandle;
+const struct NotificationHandle* TMDQueue_getItsNotificationHandle(const TMDQueue* const me) {
+    return me->itsNotificationHandle;
 }
 
 TMDQueue* TMDQueue_Create(void) {
@@ -157,6 +356,14 @@ static void initRelations(TMDQueue* const me) {
         TimeMarkedData__setItsTMDQueue(&((me->buffer)[iter]), me);
         iter++;
     }
+    for (iter = 0; iter < MAX_SUBSCRIBERS; iter++) {
+        NotificationHandle_Init(&me->itsNotificationHandle[iter]);
+        me->subscriberAt[iter] = iter;
+        me->handleAt[iter] = iter;
+        BatchNotificationHandle_Init(&me->itsBatchNotificationHandle[iter]);
+        me->batchSubscriberAt[iter] = iter;
+        me->batchHandleAt[iter] = iter;
+    }
 }
 
 static void cleanUpRelations(TMDQueue* const me) {
@@ -165,13 +372,8 @@ static void cleanUpRelations(TMDQueue* const me) {
         TimeMarkedData_Cleanup(&((me->buffer)[iter]));
         iter++;
     }
-    
-    /* Clean up the notification list */
-    struct NotificationHandle* current = me->itsNotificationHandle;
-    while (current != NULL) {
-        struct NotificationHandle* next = current->itsNotificationHandle;
-        NotificationHandle_Destroy(current);
-        current = next;
-    }
-    me->itsNotificationHandle = NULL;
+    me->nSubscribers = 0;
+    me->nBatchSubscribers = 0;
+    TMDQueue_scheduleBatch(me);
+    me->nGatingCursors = 0;
 }
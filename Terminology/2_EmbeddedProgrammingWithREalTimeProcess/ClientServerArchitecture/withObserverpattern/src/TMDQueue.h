@@ -3,23 +3,64 @@
 
 /*## auto_generated */
 #include <stdio.h>
+#include <pthread.h>
 #include "ECGPkg.h"
 #include "TimeMarkedData.h"
+#include "NotificationHandle.h"
+#include "TMDCursor.h"
 
-struct NotificationHandle;
 typedef struct TMDQueue TMDQueue;
 
 /*
 This queue is meant to operate as a "leaky" queue. In this queue,
 data are never removed per se, but are instead overwritten when the
 buffer pointer wraps around. This allows for many clients to read
-the same data from the queue. */
+the same data from the queue.
+
+The subscribers are kept packed at the front of itsNotificationHandle,
+so notify() walks one contiguous array. A subscriber is known by the
+handle subscribe() returns; subscriberAt maps the handle to its place in
+the array and handleAt maps back, which lets unsubscribe() move the last
+subscriber into the hole in O(1). handleAt also keeps the free handles,
+after the first nSubscribers entries.
+
+Batch subscribers are kept the same way in itsBatchNotificationHandle,
+with handles numbered from MAX_SUBSCRIBERS. They are handed spans of the
+buffer itself, so a batch costs one call and no copying. Samples are
+numbered as they arrive (batchSeq), and the queue keeps the sample
+number and time at which the next batch is due, so the samples in
+between cost one compare however many batch subscribers there are.
+
+Clients can also read at their own pace through a TMDCursor. Samples
+are numbered as they are inserted (published); the producer keeps the
+smallest gating cursor it has seen (gateSequence) and looks at the
+cursors again only when that one would be overrun. The gating cursors
+are attached and detached on their readers' threads, so the table of
+them is guarded by cursorLock, which the producer takes only for that
+second look; once detachCursor() returns, the producer no longer
+touches the cursor. */
 struct TMDQueue {
     int head;
+    int tail; /* oldest sample not yet overwritten */
     int nSubscribers;
     int size;
     struct TimeMarkedData buffer[QUEUE_SIZE];
-    struct NotificationHandle* itsNotificationHandle;
+    struct NotificationHandle itsNotificationHandle[MAX_SUBSCRIBERS];
+    int subscriberAt[MAX_SUBSCRIBERS]; /* handle -> index in itsNotificationHandle */
+    int handleAt[MAX_SUBSCRIBERS];     /* index -> handle */
+    int nBatchSubscribers;
+    long batchSeq;     /* samples seen by the batch subscribers */
+    long batchDueSeq;  /* the next batch is due when batchSeq gets here */
+    long batchDueTime; /* or when a sample's timeInterval gets here */
+    int batchStarting; /* a time-bounded span starts with the next sample */
+    struct BatchNotificationHandle itsBatchNotificationHandle[MAX_SUBSCRIBERS];
+    int batchSubscriberAt[MAX_SUBSCRIBERS];
+    int batchHandleAt[MAX_SUBSCRIBERS];
+    long published; /* samples inserted; the next one's sequence number */
+    long gateSequence; /* lowered by attachCursor(), so read atomically */
+    int nGatingCursors; /* read without cursorLock by insert() */
+    struct TMDCursor* itsGatingCursor[MAX_SUBSCRIBERS];
+    pthread_mutex_t cursorLock; /* guards the gating cursor table */
 };
 
 /* Constructors and destructors:*/
@@ -33,13 +74,34 @@ boolean TMDQueue_isEmpty(TMDQueue* const me);
 void TMDQueue_notify(TMDQueue* const me, const struct TimeMarkedData tmd);
 struct TimeMarkedData TMDQueue_remove(TMDQueue* const me, int index);
 
-/* The NotificationHandle is managed as a linked list, with insertions coming at the end. */
-void TMDQueue_subscribe(TMDQueue* const me, const UpdateFuncPtr updateFuncAddr);
-int TMDQueue_unsubscribe(TMDQueue* const me, const UpdateFuncPtr updateFuncAddr);
+/* notify() calls updateFuncAddr(clientPtr, tmd) for every sample; returns the
+   subscription's handle, or -1 if there are MAX_SUBSCRIBERS already */
+int TMDQueue_subscribe(TMDQueue* const me, const UpdateFuncPtr updateFuncAddr, void* clientPtr);
+/* notify() collects samples for updateFuncAddr and calls it with
+   batchSize of them at a time (1 .. QUEUE_SIZE - 1), or sooner when the
+   newest is maxLatency after the oldest (maxLatency < 0: no bound);
+   returns the subscription's handle, or -1 if there are MAX_SUBSCRIBERS
+   batch subscribers already */
+int TMDQueue_subscribeBatch(TMDQueue* const me, const BatchUpdateFuncPtr updateFuncAddr,
+                            void* clientPtr, int batchSize, long maxLatency);
+/* ends the subscription, either kind; samples a batch subscriber has not
+   been handed yet are dropped. Returns 0 if handle is not subscribed. Not
+   to be called from inside notify(). */
+int TMDQueue_unsubscribe(TMDQueue* const me, int handle);
+/* hands every batch subscriber the samples it is still waiting for */
+void TMDQueue_flush(TMDQueue* const me);
+
+/* starts cursor at the next sample to be inserted; returns 0 if there are
+   MAX_SUBSCRIBERS gating cursors already. A gating cursor must be read
+   on another thread than the producer's, or insert() waits for ever.
+   Both may be called on the cursor's own thread while the producer
+   inserts; after detachCursor() the cursor may be freed. */
+int TMDQueue_attachCursor(TMDQueue* const me, struct TMDCursor* cursor, boolean gating);
+void TMDQueue_detachCursor(TMDQueue* const me, struct TMDCursor* cursor);
 
 int TMDQueue_getBuffer(const TMDQueue* const me);
-struct NotificationHandle* TMDQueue_getItsNotificationHandle(const TMDQueue* const me);
-void TMDQueue_setItsNotificationHandle(TMDQueue* const me, struct NotificationHandle* p_NotificationHandle);
+/* the subscriptions, nSubscribers of them, in no particular order */
+const struct NotificationHandle* TMDQueue_getItsNotificationHandle(const TMDQueue* const me);
 
 TMDQueue* TMDQueue_Create(void);
 void TMDQueue_Destroy(TMDQueue* const me);
@@ -71,6 +71,9 @@ static void initRelations(TestBuilder* const me) {
     QRSDetector_setItsTMDQueue(&(me->itsQRSDetector), &(me->itsTMDQueue));
     WaveformDisplay_setItsTMDQueue(&(me->itsWaveformDisplay), &(me->itsTMDQueue));
     ArrythmiaDetector_setItsTMDQueue(&(me->itsArrythmiaDetector), &(me->itsTMDQueue));
+
+    /* The arrythmia detector takes the beats the QRS detector finds */
+    ArrythmiaDetector_setItsQRSDetector(&(me->itsArrythmiaDetector), &(me->itsQRSDetector));
 }
 
 static void cleanUpRelations(TestBuilder* const me) {
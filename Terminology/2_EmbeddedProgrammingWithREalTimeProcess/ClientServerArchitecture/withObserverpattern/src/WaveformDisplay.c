@@ -4,14 +4,20 @@
 
 static void cleanUpRelations(WaveformDisplay* const me);
 
+/* the UpdateFuncPtr the queue calls, with this client as clientPtr */
+static void WaveformDisplay_notify(void* clientPtr, const struct TimeMarkedData tmd) {
+    WaveformDisplay_update((WaveformDisplay*)clientPtr, tmd);
+}
+
 void WaveformDisplay_Init(WaveformDisplay* const me) {
     me->itsTMDQueue = NULL;
+    me->notificationHandle = -1;
 }
 
 void WaveformDisplay_Cleanup(WaveformDisplay* const me) {
     /* remove yourself from server subscription list */
     if (me->itsTMDQueue != NULL) {
-        TMDQueue_unsubscribe(me->itsTMDQueue, WaveformDisplay_update);
+        TMDQueue_unsubscribe(me->itsTMDQueue, me->notificationHandle);
     }
     cleanUpRelations(me);
 }
@@ -32,7 +38,7 @@ void WaveformDisplay_setItsTMDQueue(WaveformDisplay* const me, struct TMDQueue*
     me->itsTMDQueue = p_TMDQueue;
     /* call subscribe to connect to the server */
     if (p_TMDQueue != NULL) {
-        TMDQueue_subscribe(me->itsTMDQueue, WaveformDisplay_update);
+        me->notificationHandle = TMDQueue_subscribe(me->itsTMDQueue, WaveformDisplay_notify, me);
     }
 }
 
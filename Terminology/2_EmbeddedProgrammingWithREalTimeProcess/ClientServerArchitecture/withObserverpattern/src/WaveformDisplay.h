@@ -11,6 +11,7 @@ typedef struct WaveformDisplay WaveformDisplay;
 
 struct WaveformDisplay {
     struct TMDQueue* itsTMDQueue;
+    int notificationHandle; /* our subscription to itsTMDQueue */
 };
 
 /* Constructors and destructors:*/
@@ -1,17 +1,26 @@
 #include "GasDataQueue.h"
+#include "RingBuffer.h"
 #include <stdio.h>
 
 /* private (static) methods */
 static void cleanUpRelations(GasDataQueue* const me);
-static int getNextIndex(GasDataQueue* const me, int index);
-static unsigned char isEmpty(GasDataQueue* const me);
-static unsigned char isFull(GasDataQueue* const me);
 static void initRelations(GasDataQueue* const me);
 
+/* the ring takes the semaphore around every operation */
+static void GasDataRing_lock(GasDataQueue* const me) {
+    OS_lock_semaphore(me->sema);
+}
+
+static void GasDataRing_unlock(GasDataQueue* const me) {
+    OS_release_semaphore(me->sema);
+}
+
+RING_BUFFER_DEFINE(GasDataRing, GasDataQueue, GasData, itsGasData,
+                   GAS_QUEUE_SLOTS, RING_LOCKED)
+
 void GasDataQueue_Init(GasDataQueue* const me) {
     me->head = 0;
     me->sema = NULL;
-    me->size = 0;
     me->tail = 0;
     initRelations(me);
     me->sema = OS_create_semaphore();
@@ -27,40 +36,34 @@ Insert puts new gas data elements into the queue
 if possible. It returns 1 if successful, 0 otherwise.
 */
 int GasDataQueue_insert(GasDataQueue* const me, GasData g) {
-    OS_lock_semaphore(me->sema);
-    if (!isFull(me)) {
-        me->itsGasData[me->head] = g;
-        me->head = getNextIndex(me, me->head);
-        ++me->size;
-
-        /* instrumentation */
-        /* print stuff out, just to visualize the insertions */
-        switch (g.gType) {
-        case O2_GAS:
-            printf("+++ Oxygen ");
-            break;
-        case N2_GAS:
-            printf("+++ Nitrogen ");
-            break;
-        case HE_GAS:
-            printf("+++ Helium ");
-            break;
-        default:
-            printf("UNKNOWN ");
-            break;
-        };
-        printf(" at conc %f, flow %d\n", g.conc, g.flowInCCPerMin);
-        printf(" Number of elements queued %d, head = %d, tail = %d\n",
-               me->size, me->head, me->tail);
-        /* end instrumentation */
-
-        OS_release_semaphore(me->sema);
-        return 1;
-    }
-    else { /* return error indication */
-        OS_release_semaphore(me->sema);
-        return 0;
+    if (!GasDataRing_push(me, &g)) {
+        return 0; /* full: return error indication */
     }
+
+    /* instrumentation (build with -DNO_INSTRUMENTATION to leave it out) */
+#ifndef NO_INSTRUMENTATION
+    /* print stuff out, just to visualize the insertions */
+    switch (g.gType) {
+    case O2_GAS:
+        printf("+++ Oxygen ");
+        break;
+    case N2_GAS:
+        printf("+++ Nitrogen ");
+        break;
+    case HE_GAS:
+        printf("+++ Helium ");
+        break;
+    default:
+        printf("UNKNOWN ");
+        break;
+    };
+    printf(" at conc %f, flow %d\n", g.conc, g.flowInCCPerMin);
+    printf(" Number of elements queued %d, head = %d, tail = %d\n",
+           GasDataRing_count(me), me->head, me->tail);
+#endif
+    /* end instrumentation */
+
+    return 1;
 }
 
 /*
@@ -70,58 +73,40 @@ returns the pointer. Returns NULL if the queue
 is empty
 */
 GasData* GasDataQueue_remove(GasDataQueue* const me) {
+    GasData g;
     GasData* gPtr;
-    OS_lock_semaphore(me->sema);
-    if (!isEmpty(me)) {
-        gPtr = (GasData*)malloc(sizeof(GasData));
-        gPtr->gType = me->itsGasData[me->tail].gType;
-        gPtr->conc = me->itsGasData[me->tail].conc;
-        gPtr->flowInCCPerMin = me->itsGasData[me->tail].flowInCCPerMin;
-        me->tail = getNextIndex(me, me->tail);
-        --me->size;
-
-        /* instrumentation */
-        switch (gPtr->gType) {
-        case O2_GAS:
-            printf("--- Oxygen ");
-            break;
-        case N2_GAS:
-            printf("--- Nitrogen ");
-            break;
-        case HE_GAS:
-            printf("--- Helium ");
-            break;
-        default:
-            printf("--- UNKNOWN ");
-            break;
-        };
-        printf(" at conc %f, flow %d\n", gPtr->conc, gPtr->flowInCCPerMin);
-        printf(" Number of elements queued %d, head = %d, tail = %d\n",
-               me->size, me->head, me->tail);
-        /* end instrumentation */
-
-        OS_release_semaphore(me->sema);
-        return gPtr;
+    if (!GasDataRing_pop(me, &g)) {
+        return NULL; /* if empty return NULL ptr */
     }
-    else { /* if empty return NULL ptr */
-        OS_release_semaphore(me->sema);
+    gPtr = (GasData*)malloc(sizeof(GasData));
+    if (gPtr == NULL) {
         return NULL;
     }
-}
-
-static int getNextIndex(GasDataQueue* const me, int index) {
-    /* this operation computes the next index from the
-    first using modulo arithmetic
-    */
-    return (index + 1) % GAS_QUEUE_SIZE;
-}
-
-static unsigned char isEmpty(GasDataQueue* const me) {
-    return (me->size == 0);
-}
-
-static unsigned char isFull(GasDataQueue* const me) {
-    return (me->size == GAS_QUEUE_SIZE);
+    *gPtr = g;
+
+    /* instrumentation (build with -DNO_INSTRUMENTATION to leave it out) */
+#ifndef NO_INSTRUMENTATION
+    switch (gPtr->gType) {
+    case O2_GAS:
+        printf("--- Oxygen ");
+        break;
+    case N2_GAS:
+        printf("--- Nitrogen ");
+        break;
+    case HE_GAS:
+        printf("--- Helium ");
+        break;
+    default:
+        printf("--- UNKNOWN ");
+        break;
+    };
+    printf(" at conc %f, flow %d\n", gPtr->conc, gPtr->flowInCCPerMin);
+    printf(" Number of elements queued %d, head = %d, tail = %d\n",
+           GasDataRing_count(me), me->head, me->tail);
+#endif
+    /* end instrumentation */
+
+    return gPtr;
 }
 
 int GasDataQueue_getItsGasData(const GasDataQueue* const me) {
@@ -146,7 +131,7 @@ void GasDataQueue_Destroy(GasDataQueue* const me) {
 
 static void initRelations(GasDataQueue* const me) {
     int iter = 0;
-    while (iter < GAS_QUEUE_SIZE) {
+    while (iter < GAS_QUEUE_SLOTS) {
         GasData_Init(&((me->itsGasData)[iter]));
         iter++;
     }
@@ -154,7 +139,7 @@ static void initRelations(GasDataQueue* const me) {
 
 static void cleanUpRelations(GasDataQueue* const me) {
     int iter = 0;
-    while (iter < GAS_QUEUE_SIZE) {
+    while (iter < GAS_QUEUE_SLOTS) {
         GasData_Cleanup(&((me->itsGasData)[iter]));
         iter++;
     }
@@ -6,12 +6,15 @@
 #include "OSSemaphore.h"
 
 typedef struct GasDataQueue GasDataQueue;
+/* one slot of the ring always stays free, so the storage is one
+   larger than the number of elements the queue holds */
+#define GAS_QUEUE_SLOTS (GAS_QUEUE_SIZE + 1)
+
 struct GasDataQueue {
     int head;
     OSSemaphore* sema;
-    int size;
     int tail;
-    struct GasData itsGasData[GAS_QUEUE_SIZE];
+    struct GasData itsGasData[GAS_QUEUE_SLOTS];
 };
 
 /* Constructors and destructors */
@@ -23,7 +23,9 @@ typedef enum GAS_TYPE {
 } GAS_TYPE;
 
 /* define the size of the queue */
+#ifndef GAS_QUEUE_SIZE
 #define GAS_QUEUE_SIZE (10)
+#endif
 
 /* OS semaphore services */
 struct OSSemaphore* OS_create_semaphore(void);
@@ -1,12 +1,23 @@
 #include "TSREventQueue.h"
 #include "Mutex.h"
+#include "RingBuffer.h"
 #include <stdlib.h>
 
 static void cleanUpRelations(TSREventQueue* const me);
 
+/* the ring holds itsMutex around every operation */
+static void TSREventRing_lock(TSREventQueue* const me) {
+    Mutex_lock(me->itsMutex);
+}
+
+static void TSREventRing_unlock(TSREventQueue* const me) {
+    Mutex_release(me->itsMutex);
+}
+
+RING_BUFFER_DEFINE(TSREventRing, TSREventQueue, Event, q, QSIZE, RING_LOCKED)
+
 void TSREventQueue_Init(TSREventQueue* const me) {
     me->head = 0;
-    me->size = 0;
     me->tail = 0;
     me->itsMutex = NULL;
 }
@@ -16,28 +27,20 @@ void TSREventQueue_Cleanup(TSREventQueue* const me) {
 }
 
 int TSREventQueue_isEmpty(TSREventQueue* const me) {
-    return me->size <= 0;
+    return TSREventRing_isEmpty(me);
 }
 
 int TSREventQueue_isFull(TSREventQueue* const me) {
-    return me->size >= QSIZE-1;
+    return TSREventRing_isFull(me);
 }
 
 /* post enqueues an event and signals that fact */
 int TSREventQueue_post(TSREventQueue* const me, Event e) {
-    Mutex_lock(me->itsMutex);
-    
-    if (!TSREventQueue_isFull(me)) {
-        me->q[me->head] = e;
-        me->head = (me->head + 1) % QSIZE;
-        me->size += 1;
-        Mutex_release(me->itsMutex);
-        
+    if (TSREventRing_push(me, &e)) {
         postSignal(); /* signal that an event is present */
         return 1;
     }
     else {
-        Mutex_release(me->itsMutex);
         return 0;
     }
 }
@@ -46,16 +49,7 @@ int TSREventQueue_post(TSREventQueue* const me, Event e) {
 /* pull should only be called when there is an event waiting */
 Event TSREventQueue_pull(TSREventQueue* const me) {
     Event e = {0}; /* Initialize with default values */
-    
-    Mutex_lock(me->itsMutex);
-    
-    if (!TSREventQueue_isEmpty(me)) {
-        e = me->q[me->tail];
-        me->tail = (me->tail + 1) % QSIZE;
-        me->size -= 1;
-    }
-    
-    Mutex_release(me->itsMutex);
+    TSREventRing_pop(me, &e);
     return e;
 }
 
@@ -8,8 +8,7 @@ struct Mutex;
 typedef struct TSREventQueue TSREventQueue;
 
 struct TSREventQueue {
-    Event q[100];
-    int size;
+    Event q[QSIZE];
     int head;
     int tail;
     struct Mutex* itsMutex;
@@ -2,7 +2,9 @@
 #define TOKENIZER_COMMON_PKG_H
 
 /* this is the size of the event queue */
+#ifndef QSIZE
 #define QSIZE 100
+#endif
 
 typedef enum EventType {
     EVDIGIT,
@@ -32,7 +34,7 @@ typedef enum TSUBSTATETYPE {
 
 /* helper function returns the digit */
 /* held by a char */
-int digit(char c) {
+static inline int digit(char c) {
     return c-'0';
 }
 
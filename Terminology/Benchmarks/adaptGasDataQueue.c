@@ -0,0 +1,47 @@
+#include "GasDataQueue.h"
+
+#include "queueBenchmark.h"
+
+/* GasDataQueue copies each element in, and remove() hands it back in a
+   new heap block, which the adapter frees. Its size is GAS_QUEUE_SIZE,
+   which the benchmark Makefile sets. */
+
+static void *gasCreate(int capacity)
+{
+    (void)capacity;
+    return GasDataQueue_Create();
+}
+
+static int gasCapacity(void *q)
+{
+    (void)q;
+    return GAS_QUEUE_SIZE;
+}
+
+static int gasInsert(void *q, int value)
+{
+    GasData g;
+    g.conc = 0.21;
+    g.flowInCCPerMin = (unsigned int)value;
+    g.gType = O2_GAS;
+    return GasDataQueue_insert((GasDataQueue *)q, g);
+}
+
+static int gasRemove(void *q, int *value)
+{
+    GasData *g = GasDataQueue_remove((GasDataQueue *)q);
+    if (g == NULL)
+        return 0;
+    *value = (int)g->flowInCCPerMin;
+    free(g);
+    return 1;
+}
+
+static void gasDestroy(void *q)
+{
+    GasDataQueue_Destroy((GasDataQueue *)q);
+}
+
+const QueueAdapter gasDataQueueAdapter = {
+    "GasDataQueue", sizeof(GasData), 0, 0, ~0u,
+    gasCreate, gasCapacity, gasInsert, gasRemove, gasDestroy};
@@ -0,0 +1,156 @@
+#include "queue.h"
+
+#include "cachedQueue.h"
+
+#include "priorityQueue.h"
+
+#include "queueBenchmark.h"
+
+/* Queue (classic and SPSC modes), CachedQueue (spill file, mapped
+   ring file and background writer modes) and PriorityQueue */
+
+static void *queueCreate(int capacity)
+{
+    return Queue_CreateWithCapacity(capacity);
+}
+
+static void *queueCreateSPSC(int capacity)
+{
+    return Queue_CreateSPSCWithCapacity(capacity);
+}
+
+static int queueCapacity(void *q)
+{
+    return Queue_getCapacity((Queue *)q);
+}
+
+static int queueInsert(void *q, int value)
+{
+    if (Queue_isFull((Queue *)q))
+        return 0;
+    Queue_insert((Queue *)q, value);
+    return 1;
+}
+
+static int queueRemove(void *q, int *value)
+{
+    return Queue_removeN((Queue *)q, value, 1);
+}
+
+static int queueInsertSPSC(void *q, int value)
+{
+    return Queue_insertNSPSC((Queue *)q, &value, 1);
+}
+
+static int queueRemoveSPSC(void *q, int *value)
+{
+    return Queue_removeNSPSC((Queue *)q, value, 1);
+}
+
+static void queueDestroy(void *q)
+{
+    Queue_Destroy((Queue *)q);
+}
+
+const QueueAdapter queueAdapter = {
+    "Queue", sizeof(int), 0, 0, ~0u,
+    queueCreate, queueCapacity, queueInsert, queueRemove, queueDestroy};
+
+const QueueAdapter queueSPSCAdapter = {
+    "Queue SPSC", sizeof(int), 1, 0, ~0u,
+    queueCreateSPSC, queueCapacity, queueInsertSPSC, queueRemoveSPSC, queueDestroy};
+
+/* a CachedQueue never fills up: the overflow goes to disk */
+static void *cachedQueueCreate(int capacity)
+{
+    (void)capacity;
+    return CachedQueue_Create("queuebench.dat", 0);
+}
+
+static void *cachedQueueCreateMapped(int capacity)
+{
+    (void)capacity;
+    return CachedQueue_CreateMapped("queuebench.map");
+}
+
+static void *cachedQueueCreateAsync(int capacity)
+{
+    (void)capacity;
+    return CachedQueue_CreateAsync("queuebench.async", 0);
+}
+
+static int cachedQueueCapacity(void *q)
+{
+    (void)q;
+    return -1; /* unbounded */
+}
+
+static int cachedQueueInsert(void *q, int value)
+{
+    CachedQueue *me = (CachedQueue *)q;
+    me->vtbl->insert(me, value);
+    return 1;
+}
+
+static int cachedQueueRemove(void *q, int *value)
+{
+    return CachedQueue_removeN((CachedQueue *)q, value, 1);
+}
+
+static void cachedQueueDestroy(void *q)
+{
+    CachedQueue_Destroy((CachedQueue *)q);
+}
+
+const QueueAdapter cachedQueueAdapter = {
+    "CachedQueue", sizeof(int), 0, 0, ~0u,
+    cachedQueueCreate, cachedQueueCapacity, cachedQueueInsert, cachedQueueRemove,
+    cachedQueueDestroy};
+
+const QueueAdapter cachedQueueMappedAdapter = {
+    "CachedQueue mapped", sizeof(int), 0, 0, ~0u,
+    cachedQueueCreateMapped, cachedQueueCapacity, cachedQueueInsert, cachedQueueRemove,
+    cachedQueueDestroy};
+
+const QueueAdapter cachedQueueAsyncAdapter = {
+    "CachedQueue async", sizeof(int), 0, 0, ~0u,
+    cachedQueueCreateAsync, cachedQueueCapacity, cachedQueueInsert, cachedQueueRemove,
+    cachedQueueDestroy};
+
+/* the elements are spread over the levels by value, so every level is
+   busy; capacity is split between the levels */
+static void *priorityQueueCreate(int capacity)
+{
+    int perLevel = capacity / PRIORITYQUEUE_LEVELS;
+    return PriorityQueue_CreateWithCapacity(PRIORITYQUEUE_LEVELS, perLevel > 0 ? perLevel : 1);
+}
+
+static int priorityQueueCapacity(void *q)
+{
+    PriorityQueue *me = (PriorityQueue *)q;
+    return me->levels * PriorityRing_capacity(&me->level[0]);
+}
+
+static int priorityQueueInsert(void *q, int value)
+{
+    return PriorityQueue_insert((PriorityQueue *)q, value, value & (PRIORITYQUEUE_LEVELS - 1));
+}
+
+static int priorityQueueRemove(void *q, int *value)
+{
+    PriorityQueue *me = (PriorityQueue *)q;
+    if (PriorityQueue_isEmpty(me))
+        return 0;
+    *value = PriorityQueue_remove(me);
+    return 1;
+}
+
+static void priorityQueueDestroy(void *q)
+{
+    PriorityQueue_Destroy((PriorityQueue *)q);
+}
+
+const QueueAdapter priorityQueueAdapter = {
+    "PriorityQueue", sizeof(int), 0, 0, ~0u,
+    priorityQueueCreate, priorityQueueCapacity, priorityQueueInsert, priorityQueueRemove,
+    priorityQueueDestroy};
@@ -0,0 +1,63 @@
+#include <stdlib.h>
+
+#include "RingBuffer.h"
+
+#include "queueBenchmark.h"
+
+/* The ring core every queue above is built on, with bigger elements, to
+   show how the cost grows with the element size. The capacity is set
+   at run time like Queue's. */
+
+#define RING_ADAPTER(Name, Bytes)                                              \
+    typedef struct Name##Element {                                             \
+        int value;                                                             \
+        char payload[(Bytes) - sizeof(int)];                                   \
+    } Name##Element;                                                           \
+    typedef struct Name {                                                      \
+        int head;                                                              \
+        int tail;                                                              \
+        int slots;                                                             \
+        Name##Element buffer[];                                                \
+    } Name;                                                                    \
+    RING_BUFFER_DEFINE(Name##Ring, Name, Name##Element, buffer, me->slots,     \
+                       RING_UNLOCKED)                                          \
+    static void *Name##Create(int capacity) {                                  \
+        Name *me = (Name *)malloc(sizeof(Name) +                               \
+                                  (size_t)(capacity + 1) * sizeof(Name##Element)); \
+        if (me != NULL) {                                                      \
+            me->head = 0;                                                      \
+            me->tail = 0;                                                      \
+            me->slots = capacity + 1;                                          \
+        }                                                                      \
+        return me;                                                             \
+    }                                                                          \
+    static int Name##Capacity(void *q) {                                       \
+        return Name##Ring_capacity((Name *)q);                                 \
+    }                                                                          \
+    static int Name##Insert(void *q, int value) {                              \
+        Name##Element e;                                                       \
+        e.value = value;                                                       \
+        e.payload[0] = (char)value;                                            \
+        return Name##Ring_push((Name *)q, &e);                                 \
+    }                                                                          \
+    static int Name##Remove(void *q, int *value) {                             \
+        Name##Element e;                                                       \
+        if (!Name##Ring_pop((Name *)q, &e))                                    \
+            return 0;                                                          \
+        *value = e.value;                                                      \
+        return 1;                                                              \
+    }                                                                          \
+    static void Name##Destroy(void *q) {                                       \
+        free(q);                                                               \
+    }
+
+RING_ADAPTER(Ring64, 64)
+RING_ADAPTER(Ring256, 256)
+
+const QueueAdapter ring64Adapter = {
+    "RingBuffer 64-byte", sizeof(Ring64Element), 0, 0, ~0u,
+    Ring64Create, Ring64Capacity, Ring64Insert, Ring64Remove, Ring64Destroy};
+
+const QueueAdapter ring256Adapter = {
+    "RingBuffer 256-byte", sizeof(Ring256Element), 0, 0, ~0u,
+    Ring256Create, Ring256Capacity, Ring256Insert, Ring256Remove, Ring256Destroy};
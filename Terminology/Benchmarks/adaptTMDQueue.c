@@ -0,0 +1,76 @@
+#include "TMDQueue.h"
+
+#include "queueBenchmark.h"
+
+/* TMDQueue is a leaky queue read by index: data are never removed, the
+   oldest sample is overwritten instead. The adapter reads it the way a
+   client does, with its own cursor that skips ahead to the oldest
+   sample when the writer has lapped it. */
+
+typedef struct TMDReader TMDReader;
+struct TMDReader
+{
+    TMDQueue *queue;
+    int next;  /* index of the next sample to read */
+    long seen; /* samples inserted so far, to tell empty from lapped */
+    long read;
+};
+
+static void *tmdCreate(int capacity)
+{
+    TMDReader *me = (TMDReader *)malloc(sizeof(TMDReader));
+    (void)capacity;
+    if (me != NULL)
+    {
+        me->queue = TMDQueue_Create();
+        me->next = 0;
+        me->seen = 0;
+        me->read = 0;
+    }
+    return me;
+}
+
+static int tmdCapacity(void *q)
+{
+    (void)q;
+    return QUEUE_SIZE - 1;
+}
+
+static int tmdInsert(void *q, int value)
+{
+    TMDReader *me = (TMDReader *)q;
+    TimeMarkedData tmd;
+    tmd.timeInterval = me->seen++;
+    tmd.dataValue = value;
+    tmd.itsTMDQueue = me->queue;
+    TMDQueue_insert(me->queue, tmd);
+    return 1;
+}
+
+static int tmdRemove(void *q, int *value)
+{
+    TMDReader *me = (TMDReader *)q;
+    if (me->read == me->seen)
+        return 0;
+    if (me->seen - me->read > QUEUE_SIZE - 1)
+    {
+        /* lapped: continue with the oldest sample still there */
+        me->read = me->seen - (QUEUE_SIZE - 1);
+        me->next = me->queue->tail;
+    }
+    *value = TMDQueue_remove(me->queue, me->next).dataValue;
+    me->next = TMDQueue_getNextIndex(me->queue, me->next);
+    me->read++;
+    return 1;
+}
+
+static void tmdDestroy(void *q)
+{
+    TMDReader *me = (TMDReader *)q;
+    TMDQueue_Destroy(me->queue);
+    free(me);
+}
+
+const QueueAdapter tmdQueueAdapter = {
+    "TMDQueue", sizeof(TimeMarkedData), 0, 1, ~0u,
+    tmdCreate, tmdCapacity, tmdInsert, tmdRemove, tmdDestroy};
@@ -0,0 +1,63 @@
+#include <stdlib.h>
+
+#include "TSREventQueue.h"
+
+#include "Mutex.h"
+
+#include "queueBenchmark.h"
+
+/* TSREventQueue holds QSIZE - 1 events (QSIZE is set by the benchmark
+   Makefile) behind its Mutex. An event carries a single char, so only
+   the low 7 bits of a value come back. post() signals the receptor
+   task; here nobody waits, so the signal does nothing. */
+
+void postSignal(void)
+{
+}
+
+void waitOnSignal(void)
+{
+}
+
+static void *tsrCreate(int capacity)
+{
+    TSREventQueue *me = TSREventQueue_Create();
+    (void)capacity;
+    if (me != NULL)
+        TSREventQueue_setItsMutex(me, Mutex_Create());
+    return me;
+}
+
+static int tsrCapacity(void *q)
+{
+    (void)q;
+    return QSIZE - 1;
+}
+
+static int tsrInsert(void *q, int value)
+{
+    Event e;
+    e.eType = EVDIGIT;
+    e.ed.c = (char)(value & 0x7f);
+    return TSREventQueue_post((TSREventQueue *)q, e);
+}
+
+static int tsrRemove(void *q, int *value)
+{
+    TSREventQueue *me = (TSREventQueue *)q;
+    if (TSREventQueue_isEmpty(me))
+        return 0;
+    *value = TSREventQueue_pull(me).ed.c;
+    return 1;
+}
+
+static void tsrDestroy(void *q)
+{
+    TSREventQueue *me = (TSREventQueue *)q;
+    Mutex_Destroy(TSREventQueue_getItsMutex(me));
+    TSREventQueue_Destroy(me);
+}
+
+const QueueAdapter tsrEventQueueAdapter = {
+    "TSREventQueue", sizeof(Event), 0, 0, 0x7f,
+    tsrCreate, tsrCapacity, tsrInsert, tsrRemove, tsrDestroy};
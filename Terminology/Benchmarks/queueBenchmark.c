@@ -0,0 +1,390 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+
+#include <sched.h>
+
+#include <stdatomic.h>
+
+#include <stdio.h>
+
+#include <stdlib.h>
+
+#include <string.h>
+
+#include <time.h>
+
+#include <unistd.h>
+
+#include "queueBenchmark.h"
+
+/* Drives every queue implementation in the tree through the same three
+   runs:
+
+   pingpong    insert() then remove() on one thread, so the element never
+               leaves the cache: the cost of the calls themselves
+   fill/drain  insert() up to the capacity, then remove() everything, on
+               one thread: for large capacities the buffer no longer fits
+               in the cache and every element costs a miss
+   threaded    P producer and C consumer threads; every call is timed on
+               its own and the run reports throughput and the p50, p99
+               and p99.9 latency of insert() and remove()
+
+   usage: queue_benchmark [-n ops] [-c capacity] [-p producers]
+                          [-k consumers] [-q name]
+
+   -q runs only the queues whose name contains the given text. */
+
+static const QueueAdapter *const adapters[] = {
+    &queueAdapter,
+    &queueSPSCAdapter,
+    &cachedQueueAdapter,
+    &cachedQueueMappedAdapter,
+    &cachedQueueAsyncAdapter,
+    &priorityQueueAdapter,
+    &tmdQueueAdapter,
+    &gasDataQueueAdapter,
+    &tsrEventQueueAdapter,
+    &ring64Adapter,
+    &ring256Adapter,
+};
+
+#define NUM_ADAPTERS ((int)(sizeof(adapters) / sizeof(adapters[0])))
+
+typedef struct Options Options;
+struct Options
+{
+    long ops;      /* elements per run */
+    int capacity;  /* requested capacity */
+    int producers;
+    int consumers;
+    const char *filter;
+};
+
+/* state shared by the threads of one threaded run */
+typedef struct Run Run;
+struct Run
+{
+    const QueueAdapter *adapter;
+    void *q;
+    int locked; /* serialize every call with lock */
+    pthread_mutex_t lock;
+    long perProducer;
+    atomic_int producersLeft;
+    long removed;  /* under lock */
+    long checksum; /* under lock */
+};
+
+/* one producer or consumer thread */
+typedef struct Worker Worker;
+struct Worker
+{
+    Run *run;
+    pthread_t thread;
+    int id;
+    long *latency; /* ns per call */
+    long n;
+    long sum;
+};
+
+static inline long nanoseconds(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000L + t.tv_nsec;
+}
+
+static inline int runInsert(Run *run, int value)
+{
+    int ok;
+    if (!run->locked)
+        return run->adapter->insert(run->q, value);
+    pthread_mutex_lock(&run->lock);
+    ok = run->adapter->insert(run->q, value);
+    pthread_mutex_unlock(&run->lock);
+    return ok;
+}
+
+static inline int runRemove(Run *run, int *value)
+{
+    int ok;
+    if (!run->locked)
+        return run->adapter->remove(run->q, value);
+    pthread_mutex_lock(&run->lock);
+    ok = run->adapter->remove(run->q, value);
+    pthread_mutex_unlock(&run->lock);
+    return ok;
+}
+
+static void *producer(void *arg)
+{
+    Worker *me = (Worker *)arg;
+    Run *run = me->run;
+    long j, start, stop;
+    int value;
+
+    for (j = 0; j < run->perProducer; j++)
+    {
+        value = (int)(me->id * run->perProducer + j);
+        for (;;)
+        {
+            start = nanoseconds();
+            if (runInsert(run, value))
+                break;
+            sched_yield(); /* full: let a consumer in */
+        }
+        stop = nanoseconds();
+        me->latency[me->n++] = stop - start;
+        me->sum += (unsigned)value & run->adapter->valueMask;
+    }
+    atomic_fetch_sub(&run->producersLeft, 1);
+    return NULL;
+}
+
+static void *consumer(void *arg)
+{
+    Worker *me = (Worker *)arg;
+    Run *run = me->run;
+    long start, stop;
+    int value;
+
+    for (;;)
+    {
+        /* read before the attempt: once the producers are done, an empty
+           queue stays empty */
+        int done = atomic_load(&run->producersLeft) == 0;
+        start = nanoseconds();
+        if (runRemove(run, &value))
+        {
+            stop = nanoseconds();
+            me->latency[me->n++] = stop - start;
+            me->sum += (unsigned)value & run->adapter->valueMask;
+        }
+        else if (done)
+            break;
+        else
+            sched_yield(); /* empty: let a producer in */
+    }
+    pthread_mutex_lock(&run->lock);
+    run->removed += me->n;
+    run->checksum += me->sum;
+    pthread_mutex_unlock(&run->lock);
+    return NULL;
+}
+
+static int compareLong(const void *a, const void *b)
+{
+    long x = *(const long *)a, y = *(const long *)b;
+    return (x > y) - (x < y);
+}
+
+/* sorts the latencies of all workers into one array and prints the
+   percentiles */
+static void reportLatency(const char *what, Worker *workers, int count)
+{
+    long total = 0, at = 0;
+    long *all;
+    int i;
+
+    for (i = 0; i < count; i++)
+        total += workers[i].n;
+    if (total == 0)
+        return;
+    all = (long *)malloc((size_t)total * sizeof(long));
+    if (all == NULL)
+        return;
+    for (i = 0; i < count; i++)
+    {
+        memcpy(all + at, workers[i].latency, (size_t)workers[i].n * sizeof(long));
+        at += workers[i].n;
+    }
+    qsort(all, (size_t)total, sizeof(long), compareLong);
+    printf("    %-6s p50 %6ld ns  p99 %7ld ns  p99.9 %8ld ns\n", what,
+           all[total / 2], all[total * 99 / 100], all[total * 999 / 1000]);
+    free(all);
+}
+
+static double mops(long n, long ns)
+{
+    return ns > 0 ? n * 1e3 / ns : 0.0;
+}
+
+static void pingpong(const QueueAdapter *adapter, const Options *opt)
+{
+    void *q = adapter->create(opt->capacity);
+    long j, start, stop, sum = 0;
+    int value;
+
+    start = nanoseconds();
+    for (j = 0; j < opt->ops; j++)
+    {
+        adapter->insert(q, (int)j);
+        if (adapter->remove(q, &value))
+            sum += value;
+    }
+    stop = nanoseconds();
+    printf("  pingpong    %8.1f ns per insert+remove (checksum %ld)\n",
+           (double)(stop - start) / opt->ops, sum);
+    adapter->destroy(q);
+}
+
+static void fillDrain(const QueueAdapter *adapter, const Options *opt)
+{
+    void *q = adapter->create(opt->capacity);
+    int capacity = adapter->capacity(q);
+    long done = 0, n, insertNs = 0, removeNs = 0, start;
+    long sum = 0;
+    int value;
+
+    /* unbounded queues are filled to the requested capacity */
+    if (capacity < 0)
+        capacity = opt->capacity;
+    while (done < opt->ops)
+    {
+        start = nanoseconds();
+        for (n = 0; n < capacity && adapter->insert(q, (int)n); n++)
+            ;
+        insertNs += nanoseconds() - start;
+        start = nanoseconds();
+        while (adapter->remove(q, &value))
+            sum += value;
+        removeNs += nanoseconds() - start;
+        if (n == 0)
+            break;
+        done += n;
+    }
+    printf("  fill/drain  %8.1f Mops/s insert %8.1f Mops/s remove (%d x %d bytes)\n",
+           mops(done, insertNs), mops(done, removeNs), capacity, adapter->elementSize);
+    adapter->destroy(q);
+}
+
+static void threaded(const QueueAdapter *adapter, const Options *opt)
+{
+    Run run;
+    Worker *producers, *consumers;
+    long start, stop, expected = 0, sum = 0, total;
+    int i, ok = 1;
+
+    run.adapter = adapter;
+    run.q = adapter->create(opt->capacity);
+    run.locked = !(adapter->spsc && opt->producers == 1 && opt->consumers == 1);
+    pthread_mutex_init(&run.lock, NULL);
+    run.perProducer = opt->ops / opt->producers;
+    atomic_init(&run.producersLeft, opt->producers);
+    run.removed = 0;
+    run.checksum = 0;
+    total = run.perProducer * opt->producers;
+
+    producers = (Worker *)calloc((size_t)opt->producers, sizeof(Worker));
+    consumers = (Worker *)calloc((size_t)opt->consumers, sizeof(Worker));
+    for (i = 0; i < opt->producers; i++)
+    {
+        producers[i].latency = (long *)malloc((size_t)run.perProducer * sizeof(long));
+        ok = ok && producers[i].latency != NULL;
+    }
+    /* a consumer may get every element */
+    for (i = 0; i < opt->consumers; i++)
+    {
+        consumers[i].latency = (long *)malloc((size_t)(total + 1) * sizeof(long));
+        ok = ok && consumers[i].latency != NULL;
+    }
+    if (!ok)
+    {
+        printf("  threaded    out of memory\n");
+        goto done;
+    }
+
+    start = nanoseconds();
+    for (i = 0; i < opt->consumers; i++)
+    {
+        consumers[i].run = &run;
+        consumers[i].id = i;
+        pthread_create(&consumers[i].thread, NULL, consumer, &consumers[i]);
+    }
+    for (i = 0; i < opt->producers; i++)
+    {
+        producers[i].run = &run;
+        producers[i].id = i;
+        pthread_create(&producers[i].thread, NULL, producer, &producers[i]);
+    }
+    for (i = 0; i < opt->producers; i++)
+    {
+        pthread_join(producers[i].thread, NULL);
+        expected += producers[i].sum;
+    }
+    for (i = 0; i < opt->consumers; i++)
+        pthread_join(consumers[i].thread, NULL);
+    stop = nanoseconds();
+    sum = run.checksum;
+
+    printf("  threaded    %8.1f Mops/s, %dP/%dC%s", mops(total, stop - start),
+           opt->producers, opt->consumers, run.locked ? ", locked" : "");
+    if (adapter->leaky)
+        printf(", %ld of %ld lost\n", total - run.removed, total);
+    else
+        printf(", %s\n", run.removed == total && sum == expected ? "all elements arrived"
+                                                                 : "ELEMENTS LOST");
+    reportLatency("insert", producers, opt->producers);
+    reportLatency("remove", consumers, opt->consumers);
+
+done:
+    for (i = 0; i < opt->producers; i++)
+        free(producers[i].latency);
+    for (i = 0; i < opt->consumers; i++)
+        free(consumers[i].latency);
+    free(producers);
+    free(consumers);
+    pthread_mutex_destroy(&run.lock);
+    adapter->destroy(run.q);
+}
+
+int main(int argc, char *argv[])
+{
+    Options opt = {1000000, 1024, 1, 1, NULL};
+    int c, i;
+
+    while ((c = getopt(argc, argv, "n:c:p:k:q:")) != -1)
+    {
+        switch (c)
+        {
+        case 'n':
+            opt.ops = atol(optarg);
+            break;
+        case 'c':
+            opt.capacity = atoi(optarg);
+            break;
+        case 'p':
+            opt.producers = atoi(optarg);
+            break;
+        case 'k':
+            opt.consumers = atoi(optarg);
+            break;
+        case 'q':
+            opt.filter = optarg;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n ops] [-c capacity] [-p producers] "
+                            "[-k consumers] [-q name]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (opt.ops < 1 || opt.capacity < 1 || opt.producers < 1 || opt.consumers < 1)
+    {
+        fprintf(stderr, "%s: counts must be positive\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("%ld ops, capacity %d, %d producer(s), %d consumer(s)\n",
+           opt.ops, opt.capacity, opt.producers, opt.consumers);
+    for (i = 0; i < NUM_ADAPTERS; i++)
+    {
+        const QueueAdapter *adapter = adapters[i];
+        if (opt.filter != NULL && strstr(adapter->name, opt.filter) == NULL)
+            continue;
+        printf("%s (%d-byte elements)\n", adapter->name, adapter->elementSize);
+        pingpong(adapter, &opt);
+        fillDrain(adapter, &opt);
+        threaded(adapter, &opt);
+    }
+    return EXIT_SUCCESS;
+}
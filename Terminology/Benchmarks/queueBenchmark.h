@@ -0,0 +1,50 @@
+#ifndef QUEUEBENCHMARK_H_
+
+#define QUEUEBENCHMARK_H_
+
+/* One adapter per queue implementation. Each adapter lives in its own
+   translation unit that includes only that implementation's headers,
+   since the examples reuse names such as QUEUE_SIZE for different
+   things. */
+
+typedef struct QueueAdapter QueueAdapter;
+struct QueueAdapter
+{
+    const char *name;
+    int elementSize; /* bytes per queued element */
+    /* 1: safe without a lock for one producer and one consumer thread;
+       otherwise the driver serializes every call with a mutex when it
+       runs more than one thread */
+    int spsc;
+    /* 1: insert() never fails, the oldest element is overwritten
+       instead, so a slow consumer loses elements */
+    int leaky;
+    /* the bits of an inserted value that remove() gives back */
+    unsigned valueMask;
+    /* capacity is a hint; queues with a fixed size ignore it */
+    void *(*create)(int capacity);
+    int (*capacity)(void *q);
+    /* both return 1 on success, 0 if the queue is full or empty */
+    int (*insert)(void *q, int value);
+    int (*remove)(void *q, int *value);
+    void (*destroy)(void *q);
+};
+
+/* adaptQueue.c */
+extern const QueueAdapter queueAdapter;
+extern const QueueAdapter queueSPSCAdapter;
+extern const QueueAdapter cachedQueueAdapter;
+extern const QueueAdapter cachedQueueMappedAdapter;
+extern const QueueAdapter cachedQueueAsyncAdapter;
+extern const QueueAdapter priorityQueueAdapter;
+/* adaptTMDQueue.c */
+extern const QueueAdapter tmdQueueAdapter;
+/* adaptGasDataQueue.c */
+extern const QueueAdapter gasDataQueueAdapter;
+/* adaptTSREventQueue.c */
+extern const QueueAdapter tsrEventQueueAdapter;
+/* adaptRingBuffer.c: the shared ring core with larger elements */
+extern const QueueAdapter ring64Adapter;
+extern const QueueAdapter ring256Adapter;
+
+#endif /*QUEUEBENCHMARK_H_*/
@@ -0,0 +1,232 @@
+#ifndef RingBuffer_H
+#define RingBuffer_H
+
+/*
+Typed ring-buffer core shared by the queue classes (Queue, TMDQueue,
+GasDataQueue, TSREventQueue).
+
+    RING_BUFFER_DEFINE(Prefix, Owner, Type, Buffer, Capacity, Policy)
+
+generates static inline operations Prefix_xxx(Owner* const me, ...) -
+push, pop, pushN, popN, pushOverwrite, count, isEmpty, isFull - that
+work on fields the owning class already has:
+
+    int head;            next slot to write
+    int tail;            oldest element
+    Type Buffer[...];    storage for at least Capacity elements
+
+Capacity is evaluated inside the generated functions, so it may be a
+constant or an expression on me (for example me->capacity). One slot is
+kept free to tell full from empty, so the ring holds Capacity - 1
+elements. Indices wrap with a compare instead of a modulo.
+
+Policy selects how head and tail are shared:
+
+    RING_UNLOCKED  single thread, plain loads and stores
+    RING_LOCKED    every operation runs between Prefix_lock(me) and
+                   Prefix_unlock(me), which the owner defines before
+                   expanding the macro
+    RING_SPSC      one producer thread and one consumer thread without a
+                   lock. Capacity must be a power of two, indices wrap
+                   with a mask, and the owner also provides
+                   int headCache, tailCache (each side's last view of
+                   the other side's index). pushOverwrite() is not
+                   generated since the producer may not move tail, so
+                   a call to it does not compile.
+
+The header uses only GCC/Clang builtins, so it compiles as C99 and C++.
+*/
+
+#include <string.h>
+
+/* "leaky" insert: when full the oldest element is dropped. The producer
+   moves tail, so only the policies where one thread (or the lock) owns
+   both indices get it. */
+#define RING_OVERWRITE_DEFINE(Prefix, Owner, Type, Buffer, Capacity, Policy)   \
+    static inline void Prefix##_pushOverwrite(Owner* const me,                 \
+                                              const Type* value) {             \
+        int head, next;                                                        \
+        Policy##_LOCK(Prefix, me);                                             \
+        head = me->head;                                                       \
+        next = Policy##_NEXT(head, (Capacity));                                \
+        if (next == me->tail)                                                  \
+            me->tail = Policy##_NEXT(next, (Capacity));                        \
+        me->Buffer[head] = *value;                                             \
+        me->head = next;                                                       \
+        Policy##_UNLOCK(Prefix, me);                                           \
+    }
+
+/* RING_UNLOCKED */
+#define RING_UNLOCKED_LOCK(Prefix, me) ((void)0)
+#define RING_UNLOCKED_UNLOCK(Prefix, me) ((void)0)
+#define RING_UNLOCKED_LOAD(x) (x)
+#define RING_UNLOCKED_STORE(x, v) ((x) = (v))
+#define RING_UNLOCKED_NEXT(i, cap) ((i) + 1 == (cap) ? 0 : (i) + 1)
+#define RING_UNLOCKED_FULL(me, next) ((next) == (me)->tail)
+#define RING_UNLOCKED_EMPTY(me, tail) ((tail) == (me)->head)
+#define RING_UNLOCKED_TAIL(me) ((me)->tail)
+#define RING_UNLOCKED_HEAD(me) ((me)->head)
+#define RING_UNLOCKED_OVERWRITE RING_OVERWRITE_DEFINE
+
+/* RING_LOCKED */
+#define RING_LOCKED_LOCK(Prefix, me) Prefix##_lock(me)
+#define RING_LOCKED_UNLOCK(Prefix, me) Prefix##_unlock(me)
+#define RING_LOCKED_LOAD(x) (x)
+#define RING_LOCKED_STORE(x, v) ((x) = (v))
+#define RING_LOCKED_NEXT(i, cap) RING_UNLOCKED_NEXT(i, cap)
+#define RING_LOCKED_FULL(me, next) RING_UNLOCKED_FULL(me, next)
+#define RING_LOCKED_EMPTY(me, tail) RING_UNLOCKED_EMPTY(me, tail)
+#define RING_LOCKED_TAIL(me) RING_UNLOCKED_TAIL(me)
+#define RING_LOCKED_HEAD(me) RING_UNLOCKED_HEAD(me)
+#define RING_LOCKED_OVERWRITE RING_OVERWRITE_DEFINE
+
+/* RING_SPSC: the other side's index is only re-read (acquire) when the
+   cached copy says the ring is full or empty */
+#define RING_SPSC_LOCK(Prefix, me) ((void)0)
+#define RING_SPSC_UNLOCK(Prefix, me) ((void)0)
+#define RING_SPSC_LOAD(x) __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define RING_SPSC_STORE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+#define RING_SPSC_NEXT(i, cap) (((i) + 1) & ((cap) - 1))
+#define RING_SPSC_FULL(me, next) \
+    ((next) == (me)->tailCache && \
+     (next) == ((me)->tailCache = __atomic_load_n(&(me)->tail, __ATOMIC_ACQUIRE)))
+#define RING_SPSC_EMPTY(me, tail) \
+    ((tail) == (me)->headCache && \
+     (tail) == ((me)->headCache = __atomic_load_n(&(me)->head, __ATOMIC_ACQUIRE)))
+/* the bulk operations refresh the cached index once per call */
+#define RING_SPSC_TAIL(me) \
+    ((me)->tailCache = __atomic_load_n(&(me)->tail, __ATOMIC_ACQUIRE))
+#define RING_SPSC_HEAD(me) \
+    ((me)->headCache = __atomic_load_n(&(me)->head, __ATOMIC_ACQUIRE))
+/* no pushOverwrite(): the producer may not move tail */
+#define RING_SPSC_OVERWRITE(Prefix, Owner, Type, Buffer, Capacity, Policy)
+
+#define RING_BUFFER_DEFINE(Prefix, Owner, Type, Buffer, Capacity, Policy)      \
+                                                                               \
+    /* usable capacity */                                                      \
+    static inline int Prefix##_capacity(const Owner* const me) {               \
+        (void)me;                                                              \
+        return (Capacity) - 1;                                                 \
+    }                                                                          \
+                                                                               \
+    /* index following index */                                                \
+    static inline int Prefix##_next(const Owner* const me, int index) {        \
+        (void)me;                                                              \
+        return Policy##_NEXT(index, (Capacity));                               \
+    }                                                                          \
+                                                                               \
+    static inline int Prefix##_isEmpty(Owner* const me) {                      \
+        int empty;                                                             \
+        Policy##_LOCK(Prefix, me);                                             \
+        empty = Policy##_LOAD(me->head) == Policy##_LOAD(me->tail);            \
+        Policy##_UNLOCK(Prefix, me);                                           \
+        return empty;                                                          \
+    }                                                                          \
+                                                                               \
+    static inline int Prefix##_isFull(Owner* const me) {                       \
+        int full;                                                              \
+        Policy##_LOCK(Prefix, me);                                             \
+        full = Policy##_NEXT(Policy##_LOAD(me->head), (Capacity)) ==           \
+               Policy##_LOAD(me->tail);                                        \
+        Policy##_UNLOCK(Prefix, me);                                           \
+        return full;                                                           \
+    }                                                                          \
+                                                                               \
+    /* number of elements held */                                              \
+    static inline int Prefix##_count(Owner* const me) {                        \
+        int n;                                                                 \
+        Policy##_LOCK(Prefix, me);                                             \
+        n = Policy##_LOAD(me->head) - Policy##_LOAD(me->tail);                 \
+        Policy##_UNLOCK(Prefix, me);                                           \
+        return n < 0 ? n + (Capacity) : n;                                     \
+    }                                                                          \
+                                                                               \
+    /* copies *value in at head; returns 1, or 0 if the ring is full */        \
+    static inline int Prefix##_push(Owner* const me, const Type* value) {      \
+        int head, next;                                                        \
+        Policy##_LOCK(Prefix, me);                                             \
+        head = me->head;                                                       \
+        next = Policy##_NEXT(head, (Capacity));                                \
+        if (Policy##_FULL(me, next)) {                                         \
+            Policy##_UNLOCK(Prefix, me);                                       \
+            return 0;                                                          \
+        }                                                                      \
+        me->Buffer[head] = *value;                                             \
+        Policy##_STORE(me->head, next);                                        \
+        Policy##_UNLOCK(Prefix, me);                                           \
+        return 1;                                                              \
+    }                                                                          \
+                                                                               \
+    /* copies the oldest element to *value; returns 1, or 0 if empty */        \
+    static inline int Prefix##_pop(Owner* const me, Type* value) {             \
+        int tail;                                                              \
+        Policy##_LOCK(Prefix, me);                                             \
+        tail = me->tail;                                                       \
+        if (Policy##_EMPTY(me, tail)) {                                        \
+            Policy##_UNLOCK(Prefix, me);                                       \
+            return 0;                                                          \
+        }                                                                      \
+        *value = me->Buffer[tail];                                             \
+        Policy##_STORE(me->tail, Policy##_NEXT(tail, (Capacity)));             \
+        Policy##_UNLOCK(Prefix, me);                                           \
+        return 1;                                                              \
+    }                                                                          \
+                                                                               \
+    /* copies up to n elements in at head, in at most two contiguous     */ \
+    /* spans; returns the number copied                                  */ \
+    static inline int Prefix##_pushN(Owner* const me, const Type* values,     \
+                                     int n) {                                 \
+        int head, space, first;                                                \
+        Policy##_LOCK(Prefix, me);                                             \
+        head = me->head;                                                       \
+        space = Policy##_TAIL(me) - head - 1;                                  \
+        if (space < 0)                                                         \
+            space += (Capacity);                                               \
+        if (n > space)                                                         \
+            n = space;                                                         \
+        if (n > 0) {                                                           \
+            first = (Capacity) - head;                                         \
+            if (first > n)                                                     \
+                first = n;                                                     \
+            memcpy(&me->Buffer[head], values, (size_t)first * sizeof(Type));   \
+            memcpy(&me->Buffer[0], values + first,                             \
+                   (size_t)(n - first) * sizeof(Type));                        \
+            head += n;                                                         \
+            if (head >= (Capacity))                                            \
+                head -= (Capacity);                                            \
+            Policy##_STORE(me->head, head);                                    \
+        }                                                                      \
+        Policy##_UNLOCK(Prefix, me);                                           \
+        return n > 0 ? n : 0;                                                  \
+    }                                                                          \
+                                                                               \
+    /* copies up to max of the oldest elements out, in at most two        */ \
+    /* contiguous spans; returns the number copied                        */ \
+    static inline int Prefix##_popN(Owner* const me, Type* values, int max) { \
+        int tail, n, first;                                                    \
+        Policy##_LOCK(Prefix, me);                                             \
+        tail = me->tail;                                                       \
+        n = Policy##_HEAD(me) - tail;                                          \
+        if (n < 0)                                                             \
+            n += (Capacity);                                                   \
+        if (n > max)                                                           \
+            n = max;                                                           \
+        if (n > 0) {                                                           \
+            first = (Capacity) - tail;                                         \
+            if (first > n)                                                     \
+                first = n;                                                     \
+            memcpy(values, &me->Buffer[tail], (size_t)first * sizeof(Type));   \
+            memcpy(values + first, &me->Buffer[0],                             \
+                   (size_t)(n - first) * sizeof(Type));                        \
+            tail += n;                                                         \
+            if (tail >= (Capacity))                                            \
+                tail -= (Capacity);                                            \
+            Policy##_STORE(me->tail, tail);                                    \
+        }                                                                      \
+        Policy##_UNLOCK(Prefix, me);                                           \
+        return n > 0 ? n : 0;                                                  \
+    }                                                                          \
+                                                                               \
+    Policy##_OVERWRITE(Prefix, Owner, Type, Buffer, Capacity, Policy)
+
+#endif